@@ -0,0 +1,42 @@
+#ifndef AOT_CONTEXT_H
+#define AOT_CONTEXT_H
+
+#include <cstdint>
+#include <array>
+
+#include "chip8.h"
+#include "aotprogram.h"
+#include "opcodedecoder.h"
+
+// The only thing code generated by chip8_aot gets to see of the Chip8 it runs on.
+// Simple instructions are translated to plain C++ on the registers. Everything else goes through execute(), which runs
+// the interpreter's own handler, so there is only ever one implementation of the trickier instructions.
+class AotContext
+{
+public:
+    explicit AotContext(Chip8& chip)
+    : m_chip{ chip }
+    {
+    }
+
+    std::array<uint8_t, 16>& registers() { return m_chip.m_registers; }
+    uint16_t& indexRegister() { return m_chip.m_indexReg; }
+    uint8_t& delayTimer() { return m_chip.m_delayTimer; }
+    uint8_t& soundTimer() { return m_chip.m_soundTimer; }
+
+    const Chip8::QuirkFlags& quirks() const { return m_chip.m_isQuirkEnabled; }
+
+    uint16_t pc() const { return m_chip.m_pc; }
+
+    // Runs a single instruction exactly as if the interpreter had just fetched it from address
+    void execute(const uint16_t address, const uint16_t opcode)
+    {
+        m_chip.m_pc = Utility::toU16(address + 2);
+        m_chip.executeDecodedOpcode(OpcodeDecoder::lookup(opcode));
+    }
+
+private:
+    Chip8& m_chip;
+};
+
+#endif
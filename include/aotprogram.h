@@ -0,0 +1,92 @@
+#ifndef AOT_PROGRAM_H
+#define AOT_PROGRAM_H
+
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+// A ROM that chip8_aot has translated to C++ ahead of time. The generated translation unit defines one AotProgram and
+// registers it with AotRegistry when the executable starts, so linking it in is all that is needed to use it.
+
+class AotContext;
+
+struct AotBlockResult
+{
+    uint16_t nextPC{};
+    uint16_t numInstructionsExecuted{};
+};
+
+using AotBlockFunction = AotBlockResult (*)(AotContext& context);
+
+// A run of ROM code translated into one function. Blocks can leave early (e.g. on a taken skip), so a block runs at most
+// maxInstructions instructions but may run fewer
+struct AotBlock
+{
+    uint16_t startAddress{};
+
+    // One past the last byte of code the block was translated from
+    uint16_t endAddress{};
+
+    uint16_t maxInstructions{};
+
+    // The block is a single jump to itself, so running it again can never change anything
+    bool isIdleLoop{ false };
+
+    AotBlockFunction function{ nullptr };
+};
+
+struct AotProgram
+{
+    // The ROM the program was translated from, used to match it against whatever ROM gets loaded
+    std::span<const uint8_t> rom{};
+    uint16_t loadAddress{};
+
+    std::span<const AotBlock> blocks{};
+};
+
+namespace AotRegistry
+{
+    // Called by generated code during static initialisation. Returns true so it can be used to initialise a variable
+    bool registerProgram(const AotProgram& program);
+
+    // Returns nullptr if no linked in program was translated from exactly these bytes
+    const AotProgram* find(std::span<const uint8_t> rom);
+}
+
+// Per Chip8 bookkeeping for running an AotProgram: which block starts at each address, and which blocks are no longer
+// valid because the ROM rewrote code they were translated from. Invalidated blocks are never run again, so code that
+// rewrites itself goes through the interpreter from then on
+class AotRuntime
+{
+public:
+    // Pass nullptr to detach
+    void attach(const AotProgram* program, std::size_t memorySize);
+
+    const AotProgram* getProgram() const { return m_program; }
+
+    // Returns nullptr if there is no (valid) block starting at address
+    const AotBlock* findBlock(const uint16_t address) const
+    {
+        return address < m_blockAtAddress.size() ? m_blockAtAddress[address] : nullptr;
+    }
+
+    // Must be called for every write to memory
+    void notifyMemoryWrite(const std::size_t address, const uint8_t value)
+    {
+        if (m_program != nullptr && m_isCodeByte[address] && value != m_program->rom[address - m_program->loadAddress])
+        {
+            invalidateBlocksContaining(address);
+        }
+    }
+
+private:
+    void invalidateBlocksContaining(std::size_t address);
+
+    const AotProgram* m_program{ nullptr };
+
+    std::vector<const AotBlock*> m_blockAtAddress{};
+    std::vector<bool> m_isCodeByte{};
+};
+
+#endif
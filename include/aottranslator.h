@@ -0,0 +1,20 @@
+#ifndef AOT_TRANSLATOR_H
+#define AOT_TRANSLATOR_H
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+
+// Turns a ROM into the source of a C++ translation unit that defines and registers an AotProgram (see aotprogram.h).
+//
+// Code is found by following every path out of the program start address that can be worked out without running the ROM:
+// fall through, jumps, calls and their return addresses, and the targets of skips. Anything only reachable some other way
+// (BNNN, code the ROM writes at runtime, code outside the ROM) has no block, so the interpreter runs it instead.
+namespace AotTranslator
+{
+    // romName is only used for comments in the generated source
+    std::string translate(std::span<const uint8_t> rom, std::string_view romName);
+}
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef BASIC_BLOCK_CACHE_H
+#define BASIC_BLOCK_CACHE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include "opcodedecoder.h"
+
+// Caches ROM code as runs of already decoded instructions ("basic blocks"), so that the fetch and decode of an
+// instruction only has to happen once rather than every time it is executed.
+// A block always starts at the address it was built from and stops after the first instruction that
+// OpcodeDecoder::endsBasicBlock() returns true for. Apart from the last instruction, the only thing that can move the PC
+// somewhere other than the next instruction in the block is a conditional skip, which the executor has to handle.
+class BasicBlockCache
+{
+public:
+    // A block's decoded instructions, in order. They stay where they are until the cache is flushed, so a block can be
+    // held on to while it runs, even if other blocks are built in the meantime
+    using Block = std::span<const OpcodeDecoder::DecodedOpcode>;
+
+    explicit BasicBlockCache(std::size_t memorySize);
+
+    // Returns the block starting at address, building it first if needed. Returns an empty block if none can be built
+    // there (e.g. the instruction would run off the end of memory), in which case the caller should fall back to
+    // fetching and decoding the instruction itself
+    Block findOrBuild(std::span<const uint8_t> memory, const uint16_t address)
+    {
+        if (address < m_blockAtAddress.size() && !m_blockAtAddress[address].empty())
+        {
+            return m_blockAtAddress[address];
+        }
+
+        return findOrBuildSlow(memory, address);
+    }
+
+    // Must be called for every write to memory. Writing to a byte that belongs to a cached block flushes the cache.
+    // Lookups stop finding the old blocks straight away, but they are only freed by the next lookup that has to build
+    // one, so a block that is currently executing stays valid until it finishes
+    void notifyMemoryWrite(const std::size_t address)
+    {
+        if (m_isCodeByte[address] && !m_flushPending)
+        {
+            std::ranges::fill(m_blockAtAddress, Block{});
+            m_flushPending = true;
+        }
+    }
+
+    void clear();
+
+    // On by default. Lets the superinstructions be checked against running the same blocks without them. Changing it
+    // clears the cache, so every block is built again the new way
+    void setFusingSuperinstructions(bool isFusing);
+
+private:
+    static constexpr std::size_t s_maxInstructionsPerBlock{ 64 };
+
+    Block findOrBuildSlow(std::span<const uint8_t> memory, uint16_t address);
+    Block buildBlock(std::span<const uint8_t> memory, uint16_t address);
+
+    // Owns every block's instructions. Growing this moves the vectors, but not the instructions they hold
+    std::vector<std::vector<OpcodeDecoder::DecodedOpcode>> m_blocks{};
+
+    // The block starting at each address, or an empty one. Looked up before every block, so it holds the instructions
+    // directly rather than an index into m_blocks
+    std::vector<Block> m_blockAtAddress{};
+
+    // Whether a byte is part of any cached block, so that writes can be checked cheaply
+    std::vector<bool> m_isCodeByte{};
+
+    bool m_flushPending{ false };
+    bool m_isFusingSuperinstructions{ true };
+};
+
+#endif
@@ -4,19 +4,33 @@
 
 #include <cstdint>
 #include <cassert>
+#include <atomic>
 
 #include <iostream>
 #include <fstream>
 #include <array>
 #include <vector>
+#include <memory>
+#include <optional>
+#include <span>
+#include <utility>
 
 #include "exceptions/chipoobmemoryaccessexception.h"
 #include "utils/utility.h"
+#include "utils/pcg32.h"
 
 #include "types/enumarray.h"
+#include "opcodedecoder.h"
+#include "basicblockcache.h"
+#include "x64recompiler.h"
+#include "aotprogram.h"
+#include "executionprofiler.h"
 
 class Chip8
 {
+    // Lets code generated by chip8_aot reach the machine state
+    friend class AotContext;
+
 public:
     enum class KeyInputs
     {
@@ -48,6 +62,8 @@ public:
         bool jump{};
         bool displayWait{};
         bool haltOnOOBAccess{};
+
+        bool operator==(const QuirkFlags&) const = default;
     };
 
     struct RuntimeMetaData
@@ -56,6 +72,10 @@ public:
 
         uint64_t numInstructionsExecuted{ 0 };
 
+        // Budget the faster engines gave up on because the ROM was spinning in an idle loop or waiting on FX0A, which
+        // the interpreter would have spent executing. Added to numInstructionsExecuted it matches the interpreter's count
+        uint64_t numInstructionsSkippedIdle{ 0 };
+
         uint16_t fontStartAddress{};
         uint16_t fontEndAddress{};
 
@@ -63,6 +83,26 @@ public:
         uint16_t programEndAddress{};
     };
 
+    // How executeInstructions() runs the ROM. Observable behaviour is identical between them
+    enum class ExecutionEngine
+    {
+        // Fetches and decodes every instruction each time it is executed
+        interpreter,
+
+        // Decodes straight-line runs of code once, then runs them from BasicBlockCache using threaded dispatch
+        basicBlockCache,
+
+        // Runs X64Recompiler's native code where it can, and the interpreter everywhere else. Only available when
+        // X64Recompiler::isSupported()
+        jit,
+
+        // Runs the ROM from an AotProgram generated by chip8_aot and linked into the executable, using the interpreter
+        // for anything the program doesn't cover. Same as the interpreter if no program was linked in for the loaded ROM
+        aheadOfTime,
+
+        MAX_VALUE,
+    };
+
     struct InitialConfig
     {
         // Do not change
@@ -87,7 +127,151 @@ public:
     template <std::size_t r, std::size_t c>
     using Array2DU8 = std::array<std::array<uint8_t, c>, r>;
 
-    const Array2DU8<InitialConfig::numPixelsVertically, InitialConfig::numPixelsHorizontally>& getScreenBuffer() const;
+    // One bit per pixel, one 64 bit word per row. The leftmost pixel of a row is its most significant bit
+    using ScreenBuffer = std::array<uint64_t, InitialConfig::numPixelsVertically>;
+    static_assert(InitialConfig::numPixelsHorizontally == 64, "Each row of the screen has to fit exactly into a uint64_t");
+
+    // Everything that decides what the machine does next, and nothing that only decides how fast or with which engine it
+    // runs. Plain fixed size data, so taking one is a single copy with no allocation. See SaveStateFile for storing them
+    struct SaveState
+    {
+        std::array<uint8_t, InitialConfig::bitsOfMemory> memory{};
+        std::array<uint8_t, 16> registers{};
+        uint16_t pc{};
+        uint16_t indexRegister{};
+        uint8_t delayTimer{};
+        uint8_t soundTimer{};
+
+        std::array<uint16_t, InitialConfig::maxStackDepth> stack{};
+        uint8_t stackDepth{};
+
+        ScreenBuffer screen{};
+
+        EnumArray<KeyInputs, bool> keyDownThisFrame{};
+        EnumArray<KeyInputs, bool> keyDownLastFrame{};
+
+        QuirkFlags quirks{};
+        uint64_t randomState{};
+        bool executedDXYN{};
+        RuntimeMetaData runtimeMetaData{};
+    };
+
+    // How many times each part of the machine has changed. A viewer that keeps the numbers it last saw only has to look
+    // again at the parts whose numbers moved
+    struct DebugGenerations
+    {
+        static constexpr std::size_t memoryRegionSize{ 256 };
+
+        // Different for every Chip8, so that numbers kept from a machine that has since been replaced (by loading a ROM,
+        // say) are never mistaken for this one's
+        uint64_t machine{};
+
+        std::array<uint64_t, InitialConfig::bitsOfMemory / memoryRegionSize> memoryRegions{};
+
+        // V0-VF and I
+        uint64_t registers{};
+        uint64_t stack{};
+
+        bool operator==(const DebugGenerations&) const = default;
+    };
+
+    // Read only access to the machine for debuggers and viewers, with nothing copied. Only valid until the Chip8 next
+    // runs, and only on the thread running it
+    struct DebugView
+    {
+        std::span<const uint8_t> memory{};
+        std::span<const uint8_t> registers{};
+        uint16_t pc{};
+        uint16_t indexRegister{};
+        uint8_t delayTimer{};
+        uint8_t soundTimer{};
+        std::span<const uint16_t> stack{};
+        DebugGenerations generations{};
+    };
+
+    // Memory generations go up in writeToMemory() and loadState(), and the stack's whenever it is pushed or popped.
+    // Registers are also written by code the JIT and AOT engines generate, which can't count anything, so their
+    // generation goes up here instead, if they differ from how they were the last time this was called
+    DebugView getDebugView() const;
+
+    // Conditions that stop executeInstructions() partway through, for a debugger
+    struct Breakpoints
+    {
+        enum class Comparison
+        {
+            equal,
+            notEqual,
+            lessThan,
+            greaterThan,
+            MAX_VALUE,
+        };
+
+        // Stops on an instruction that reads or writes address, before it runs
+        struct Watchpoint
+        {
+            uint16_t address{};
+            bool onRead{ true };
+            bool onWrite{ true };
+
+            bool operator==(const Watchpoint&) const = default;
+        };
+
+        // Stops after the instruction that makes V[registerIndex] <comparison> value true, when it wasn't before
+        struct RegisterCondition
+        {
+            uint8_t registerIndex{};
+            Comparison comparison{ Comparison::equal };
+            uint8_t value{};
+
+            bool operator==(const RegisterCondition&) const = default;
+        };
+
+        // Stops before the instruction at each of these runs
+        std::vector<uint16_t> pcBreakpoints{};
+        std::vector<Watchpoint> watchpoints{};
+        std::vector<RegisterCondition> registerConditions{};
+
+        bool isEmpty() const { return pcBreakpoints.empty() && watchpoints.empty() && registerConditions.empty(); }
+
+        bool operator==(const Breakpoints&) const = default;
+    };
+
+    struct BreakHit
+    {
+        enum class Reason
+        {
+            pcBreakpoint,
+            readWatchpoint,
+            writeWatchpoint,
+            registerCondition,
+        };
+
+        Reason reason{};
+        uint16_t pc{};
+
+        // The watched address for watchpoints. For register conditions, the index of the condition in
+        // Breakpoints::registerConditions
+        uint16_t detail{};
+    };
+
+    // With no breakpoints set, every engine runs exactly as it would without them. With any set, executeInstructions()
+    // runs everything through the interpreter, checking each instruction, whichever engine is selected.
+    // Once execution has stopped before an instruction, it won't stop before that same instruction again straight away,
+    // so that execution can carry on from a breakpoint
+    void setBreakpoints(const Breakpoints& breakpoints);
+    const Breakpoints& getBreakpoints() const { return m_breakpoints; }
+
+    // What stopped the last executeInstructions() early, if anything did. Cleared by calling this
+    std::optional<BreakHit> takeBreakHit() { return std::exchange(m_breakHit, std::nullopt); }
+
+    // Off by default. Runs that the profiler wants counted go through the interpreter whichever engine is selected, see
+    // ExecutionProfiler
+    void setProfilerMode(ExecutionProfiler::Mode mode) { m_profiler.setMode(mode); }
+    const ExecutionProfiler& getProfiler() const { return m_profiler; }
+    void clearProfile() { m_profiler.clear(); }
+
+    const ScreenBuffer& getScreenBuffer() const;
+    bool isPixelOn(int x, int y) const;
 
     uint8_t getDelayTimer() const;
     uint8_t getSoundTimer() const;
@@ -103,24 +287,46 @@ public:
     bool isRomLoaded() const;
 
     int getTargetNumInstrPerSecond() const;
-    std::array<uint8_t, 4096> getMemoryContents() const;
-    std::array<uint8_t, 16> getRegisterContents() const;
+    std::span<const uint8_t> getMemoryContents() const { return m_memory; }
+    std::span<const uint8_t> getRegisterContents() const { return m_registers; }
     uint16_t getPCAddress() const;
     uint16_t getIndexRegisterContents() const;
 
-    EnumArray<KeyInputs, bool> getKeysDownThisFrame() const;
+    const EnumArray<KeyInputs, bool>& getKeysDownThisFrame() const { return m_keyDownThisFrame; }
 
     const std::vector<uint16_t>& getStackContents() const;
 
     void setTargetNumInstrPerSecond(int newTarget);
 
+    // CXNN draws from a generator owned by this Chip8, seeded from std::random_device unless told otherwise. Seeding it
+    // makes every run of a ROM with the same inputs identical, whichever engine runs it
+    void seedRandom(uint64_t seed);
+
+    ExecutionEngine getExecutionEngine() const;
+    void setExecutionEngine(ExecutionEngine engine);
+
+    // Only affects ExecutionEngine::basicBlockCache, see BasicBlockCache::setFusingSuperinstructions
+    void setSuperinstructionsEnabled(bool isEnabled) { m_blockCache.setFusingSuperinstructions(isEnabled); }
+
+    // Whether an AotProgram was linked in for the ROM that is currently loaded
+    bool hasAotProgram() const;
+
 
     void loadFile(const std::string& name);
 
+    SaveState saveState() const;
+
+    // Only memory that differs from the current contents counts as written, so code compiled by the block cache, JIT or
+    // AOT program for the rest of it stays valid. Every row that differs is marked dirty
+    void loadState(const SaveState& state);
+
     void performFDECycle();
     void executeInstructions(int count);
     void handleInvalidOpcode(const uint16_t opcode);
 
+    // Raw opcode stored at address, wrapping around memory like the PC does
+    uint16_t getOpcodeAt(uint16_t address) const;
+
     void decrementTimers();
 
     void setKeyUp(KeyInputs key);
@@ -131,23 +337,43 @@ public:
     void incrementPC() { m_pc += 2; };
 
 private:
-    // Given opcode with X, i.e. 0x3XNN, extracts only the X nibble
-    [[nodiscard]] uint16_t extractX(const uint16_t opcode) const { return Utility::toU16((opcode & 0x0F00) >> 8); }
+    using DecodedOpcode = OpcodeDecoder::DecodedOpcode;
+
+    uint16_t fetchOpcode();
+    void decodeAndExecute(uint16_t opcode);
+    void executeDecodedOpcode(DecodedOpcode instruction);
 
-    // Given opcode with Y, i.e. 0x5XY0, extracts only the Y nibble
-    [[nodiscard]] uint16_t extractY(const uint16_t opcode) const { return Utility::toU16((opcode & 0x00F0) >> 4); }
+    // Instantiated with and without breakpoint checks and profiling, so that they cost nothing when not wanted
+    template <bool checkBreakpoints, bool recordProfile>
+    void executeInstructionsInterpreted(int count);
 
-    // Given opcode with an N segment, i.e. 0xDXYN, extracts only the N nibble
-    [[nodiscard]] uint16_t extractN(const uint16_t opcode) const { return Utility::toU16(opcode & 0x000F); }
+    // performFDECycle() that also counts the instruction in m_profiler, and tells it about any call or return
+    void performProfiledFDECycle();
 
-    // Given opcode with an NN segment, i.e. 0x3XNN, extracts only the NN Byte
-    [[nodiscard]] uint16_t extractNN(const uint16_t opcode) const { return Utility::toU16(opcode & 0x00FF); }
+    // Brings m_profiler's idea of which routines are running up to date with the stack
+    void beginProfiledRun();
 
-    // Given opcode with an NNN segment, i.e. 0x1NNN, extracts only the NNN segment
-    [[nodiscard]] uint16_t extractNNN(const uint16_t opcode) const { return Utility::toU16(opcode & 0x0FFF); }
+    // True if a PC breakpoint or watchpoint means the instruction at the PC shouldn't run
+    bool shouldStopBeforeInstruction();
 
-    uint16_t fetchOpcode();
-    void decodeAndExecute(uint16_t opcode);
+    // True if a register condition became true. Checked after every instruction
+    bool shouldStopAfterInstruction();
+    bool isRegisterConditionTrue(const Breakpoints::RegisterCondition& condition) const;
+    void executeInstructionsFromBlockCache(int count);
+    void executeInstructionsWithRecompiler(int count);
+
+    // X64Recompiler::MachineState::notifyMemoryWritten. Compiled code writes to m_memory itself, and calls this after
+    static void notifyMemoryWrittenByCompiledCode(void* chip, uint32_t firstAddress, uint32_t numBytes);
+    void executeInstructionsFromAotProgram(int count);
+
+    // Fallback for the compiled engines. Runs one instruction through the interpreter, and returns true if it was an FX0A
+    // that is still waiting for a key
+    bool performFDECycleAndCheckForKeyWait();
+
+    // Runs cached blocks one after the other from the PC, until maxInstructions have run, an idle loop or a DXYN under
+    // the displayWait quirk ends the frame, or no block can be built at the PC. Returns how much of maxInstructions
+    // went, counting the rest of the budget an idle loop skipped
+    int executeBasicBlocks(int maxInstructions);
 
     bool wasKeyReleasedThisFrame() const;
 
@@ -155,44 +381,44 @@ private:
     KeyInputs findKeyReleasedThisFrame() const;
 
     // Opcodes
-    void executeOp00E0();
-    void executeOp00EE();
-    void executeOp1NNN(uint16_t opcode);
-    void executeOp2NNN(uint16_t opcode);
-    void executeOp3XNN(uint16_t opcode);
-    void executeOp4XNN(uint16_t opcode);
-    void executeOp5XY0(uint16_t opcode);
-    void executeOp6XNN(uint16_t opcode);
-    void executeOp7XNN(uint16_t opcode);
-    void executeOp8XY0(uint16_t opcode);
-    void executeOp8XY1(uint16_t opcode);
-    void executeOp8XY2(uint16_t opcode);
-    void executeOp8XY3(uint16_t opcode);
-    void executeOp8XY4(uint16_t opcode);
-    void executeOp8XY5(uint16_t opcode);
-    void executeOp8XY6(uint16_t opcode);
-    void executeOp8XY7(uint16_t opcode);
-    void executeOp8XYE(uint16_t opcode);
-    void executeOp9XY0(uint16_t opcode);
-    void executeOpANNN(uint16_t opcode);
-    void executeOpBNNN(uint16_t opcode);
-    void executeOpCXNN(uint16_t opcode);
-
-    // DXYN helper
-    void drawSprite(uint8_t xCoord, uint8_t yCoord, uint16_t spriteWidth, uint16_t spriteHeight, uint16_t currAddress);
-
-    void executeOpDXYN(uint16_t opcode);
-    void executeOpEX9E(uint16_t opcode);
-    void executeOpEXA1(uint16_t opcode);
-    void executeOpFX07(uint16_t opcode);
-    void executeOpFX0A(uint16_t opcode);
-    void executeOpFX15(uint16_t opcode);
-    void executeOpFX18(uint16_t opcode);
-    void executeOpFX1E(uint16_t opcode);
-    void executeOpFX29(uint16_t opcode);
-    void executeOpFX33(uint16_t opcode);
-    void executeOpFX55(uint16_t opcode);
-    void executeOpFX65(uint16_t opcode);
+    void executeOp00E0(DecodedOpcode instruction);
+    void executeOp00EE(DecodedOpcode instruction);
+    void executeOp1NNN(DecodedOpcode instruction);
+    void executeOp2NNN(DecodedOpcode instruction);
+    void executeOp3XNN(DecodedOpcode instruction);
+    void executeOp4XNN(DecodedOpcode instruction);
+    void executeOp5XY0(DecodedOpcode instruction);
+    void executeOp6XNN(DecodedOpcode instruction);
+    void executeOp7XNN(DecodedOpcode instruction);
+    void executeOp8XY0(DecodedOpcode instruction);
+    void executeOp8XY1(DecodedOpcode instruction);
+    void executeOp8XY2(DecodedOpcode instruction);
+    void executeOp8XY3(DecodedOpcode instruction);
+    void executeOp8XY4(DecodedOpcode instruction);
+    void executeOp8XY5(DecodedOpcode instruction);
+    void executeOp8XY6(DecodedOpcode instruction);
+    void executeOp8XY7(DecodedOpcode instruction);
+    void executeOp8XYE(DecodedOpcode instruction);
+    void executeOp9XY0(DecodedOpcode instruction);
+    void executeOpANNN(DecodedOpcode instruction);
+    void executeOpBNNN(DecodedOpcode instruction);
+    void executeOpCXNN(DecodedOpcode instruction);
+
+    // DXYN helper. Sprites are always 8 pixels wide
+    void drawSprite(uint8_t xCoord, uint8_t yCoord, uint16_t spriteHeight, uint16_t currAddress);
+
+    void executeOpDXYN(DecodedOpcode instruction);
+    void executeOpEX9E(DecodedOpcode instruction);
+    void executeOpEXA1(DecodedOpcode instruction);
+    void executeOpFX07(DecodedOpcode instruction);
+    void executeOpFX0A(DecodedOpcode instruction);
+    void executeOpFX15(DecodedOpcode instruction);
+    void executeOpFX18(DecodedOpcode instruction);
+    void executeOpFX1E(DecodedOpcode instruction);
+    void executeOpFX29(DecodedOpcode instruction);
+    void executeOpFX33(DecodedOpcode instruction);
+    void executeOpFX55(DecodedOpcode instruction);
+    void executeOpFX65(DecodedOpcode instruction);
 
     // Wrapper functions to access memory, so that OOB is checked for. Will add logging in the future
     template <typename T>
@@ -223,8 +449,14 @@ private:
 
         const std::size_t wrappedLocation{ location % m_memory.size() };
         m_memory[wrappedLocation] = value;
+
+        notifyMemoryWrite(wrappedLocation, value);
     }
 
+    // Tells every engine that caches decoded or compiled code that the byte at address is now value. isRestore is true
+    // when loadState() put it there, rather than the ROM writing over its own code
+    void notifyMemoryWrite(std::size_t address, uint8_t value, bool isRestore = false);
+
     // Input handling
     bool isAKeyPressed();
     Chip8::KeyInputs findFirstPressedKey();
@@ -247,7 +479,43 @@ private:
 
     std::vector<uint16_t> m_stack{};
 
-    Array2DU8 <InitialConfig::numPixelsVertically, InitialConfig::numPixelsHorizontally> m_screen{};
+    ExecutionEngine m_executionEngine{ ExecutionEngine::basicBlockCache };
+    BasicBlockCache m_blockCache{ InitialConfig::bitsOfMemory };
+
+    // Only created once the JIT is selected, since it has to map its own executable memory
+    std::unique_ptr<X64Recompiler> m_recompiler{};
+
+    AotRuntime m_aotRuntime{};
+
+    // Where CXNN's random numbers come from. Machine state just like the registers are
+    Pcg32 m_random;
+
+    ScreenBuffer m_screen{};
+
+    Breakpoints m_breakpoints{};
+    bool m_hasBreakpoints{ false };
+
+    // What is watched or breakpointed at each address, as a mask of s_breakOnExecute, s_breakOnRead and s_breakOnWrite.
+    // Empty while there are no breakpoints
+    static constexpr uint8_t s_breakOnExecute{ 0b001 };
+    static constexpr uint8_t s_breakOnRead{ 0b010 };
+    static constexpr uint8_t s_breakOnWrite{ 0b100 };
+    std::vector<uint8_t> m_breakFlagsAtAddress{};
+
+    // Register conditions only stop execution when they go from false to true
+    std::vector<bool> m_isRegisterConditionTrue{};
+
+    std::optional<uint16_t> m_resumeAddress{};
+    std::optional<BreakHit> m_breakHit{};
+
+    ExecutionProfiler m_profiler{ InitialConfig::bitsOfMemory };
+
+    inline static std::atomic<uint64_t> s_numMachinesCreated{ 0 };
+
+    // Mutable since getDebugView() is where register changes are noticed. See getDebugView()
+    mutable DebugGenerations m_debugGenerations{ .machine = ++s_numMachinesCreated };
+    mutable std::array<uint8_t, 16> m_registersAtLastDebugView{};
+    mutable uint16_t m_indexRegAtLastDebugView{ 0 };
 
     // Need to keep track of inputs from both current and last frame so that we can detect when a key was released
     EnumArray<KeyInputs, bool> m_keyDownThisFrame{};
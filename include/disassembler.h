@@ -0,0 +1,60 @@
+#ifndef DISASSEMBLER_H
+#define DISASSEMBLER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "opcodedecoder.h"
+
+// Turns opcodes into the usual CHIP-8 assembly mnemonics, e.g. 0xD125 into "DRW V1, V2, 5". Anything that isn't an
+// instruction comes out as a data word, "DW 0x8AB9"
+namespace Disassembler
+{
+    // Written straight into a fixed buffer, so disassembling never allocates
+    struct Line
+    {
+        std::array<char, 24> text{};
+        std::size_t length{ 0 };
+
+        std::string_view view() const { return { text.data(), length }; }
+    };
+
+    Line disassemble(const OpcodeDecoder::DecodedOpcode& instruction);
+
+    inline Line disassemble(const uint16_t opcode)
+    {
+        return disassemble(OpcodeDecoder::decode(opcode));
+    }
+}
+
+// Keeps the disassembly of every address it has been asked about, and only disassembles an address again once the two
+// bytes there are different to the ones it was disassembled from. Checking costs a two byte comparison, so a listing
+// can ask for every line it shows every frame
+class DisassemblyCache
+{
+public:
+    explicit DisassemblyCache(std::size_t memorySize);
+
+    // The opcode at address is read from memory wrapping around the end, like the PC does
+    std::string_view disassembleAt(std::span<const uint8_t> memory, uint16_t address);
+
+    // How many lines had to be disassembled (rather than found in the cache) since the last call
+    std::size_t takeNumDisassembled();
+
+private:
+    struct Entry
+    {
+        uint16_t opcode{};
+        bool isDisassembled{ false };
+        Disassembler::Line line{};
+    };
+
+    std::vector<Entry> m_entries{};
+    std::size_t m_numDisassembled{ 0 };
+};
+
+#endif
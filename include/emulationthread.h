@@ -0,0 +1,152 @@
+#ifndef EMULATION_THREAD_H
+#define EMULATION_THREAD_H
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "chip8.h"
+#include "inputhandler.h"
+#include "statemanager.h"
+#include "savestateslots.h"
+#include "rewindbuffer.h"
+#include "inputmovie.h"
+#include "utils/frametimer.h"
+#include "utils/spscqueue.h"
+#include "utils/triplebuffer.h"
+#include "types/emulatorcommand.h"
+#include "types/emulatorsnapshot.h"
+
+class FileInputException;
+
+// Runs the Chip8 on a thread of its own, at the target FPS, so that a slow frame on the UI thread (SDL, ImGui) never
+// holds the emulated machine up.
+// Nothing about the machine is shared: the UI thread sends EmulatorCommands in through a queue, and gets an
+// EmulatorSnapshot of each finished frame back through a triple buffer. Neither thread ever waits for the other
+class EmulationThread
+{
+public:
+    // Starts the thread straight away, with no ROM loaded
+    EmulationThread(int targetFPS, std::size_t rewindCapacityInBytes);
+
+    // Stops the thread and waits for it to finish its frame
+    ~EmulationThread() = default;
+
+    EmulationThread(const EmulationThread&) = delete;
+    EmulationThread& operator=(const EmulationThread&) = delete;
+    EmulationThread(EmulationThread&&) = delete;
+    EmulationThread& operator=(EmulationThread&&) = delete;
+
+    // UI thread only. Returns false, leaving command alone, if the queue is full
+    bool trySendCommand(EmulatorCommand&& command) { return m_commands.tryPush(std::move(command)); }
+
+    // UI thread only. Moves on to the newest snapshot, returning false if there isn't a newer one than last time
+    bool updateSnapshot() { return m_snapshots.update(); }
+    const EmulatorSnapshot& getSnapshot() const { return m_snapshots.getReadBuffer(); }
+
+    // UI thread only. Rethrows whatever ended the thread, if it ended
+    void rethrowIfFailed() const;
+
+private:
+    static constexpr std::size_t s_commandQueueCapacity{ 256 };
+
+    void run(std::stop_token stopToken);
+
+    void processCommands();
+    void applyCommand(const EmulatorCommands::SetInputs& command);
+    void applyCommand(const EmulatorCommands::LoadRom& command);
+    void applyCommand(const EmulatorCommands::SetQuirks& command);
+    void applyCommand(const EmulatorCommands::SetTargetNumInstrPerSecond& command);
+    void applyCommand(const EmulatorCommands::SetExecutionEngine& command);
+    void applyCommand(const EmulatorCommands::SetTargetFPS& command);
+    void applyCommand(const EmulatorCommands::SetFrameSpinWindow& command);
+    void applyCommand(const EmulatorCommands::SetRewindCapacity& command);
+    void applyCommand(const EmulatorCommands::SelectSaveSlot& command);
+    void applyCommand(const EmulatorCommands::SaveToSlot& command);
+    void applyCommand(const EmulatorCommands::LoadFromSlot& command);
+    void applyCommand(const EmulatorCommands::SetBreakpoints& command);
+    void applyCommand(const EmulatorCommands::SetProfilerMode& command);
+    void applyCommand(const EmulatorCommands::ClearProfile& command);
+    void applyCommand(const EmulatorCommands::ExportFoldedStacks& command);
+
+    bool isSystemKeyPressed(InputHandler::SystemKeyInputs key) const { return m_systemKeysPressed[key]; }
+
+    void handleEmulatorStateTransitions();
+    void handleSaveStateHotkeys();
+    void handleMovieHotkeys();
+
+    void saveToSlot(int slot);
+    void loadFromSlot(int slot);
+
+    // Emulates one frame, or while fast forwarding, as many as fit in before the next snapshot is due. Returns how many
+    // it emulated
+    int emulateFramesUntilPublish();
+    void emulateFrame();
+    void executeChipInstructions();
+    void rewindFrame();
+    void replayMovieFrame();
+    void stopRecordingMovie();
+    int calculateNumInstructionsNeededForFrame();
+
+    void publishSnapshot();
+    void updateFrameTimingInfo(int numFramesEmulated);
+
+    // Swaps in a new Chip8 with no ROM loaded, and with the current breakpoints and profiler mode
+    void resetChip();
+
+    // Drops into debug mode if the last lot of instructions stopped at a breakpoint, returning true if they did
+    bool handleBreakHit();
+
+    void handleOpcodeExecutionError(const std::runtime_error& exception);
+    void handleFileInputError(const FileInputException& exception);
+
+    std::unique_ptr<Chip8> m_chip{ std::make_unique<Chip8>() };
+
+    int m_targetFPS{};
+    FrameTimer m_frameTimer{};
+    StateManager m_stateManager{};
+    SaveStateSlots m_saveStateSlots{ "saves" };
+    RewindBuffer m_rewindBuffer{ 0 };
+
+    // Recording and playback both use this one file
+    static constexpr std::string_view s_moviePath{ "movies/movie.c8m" };
+    std::optional<InputMovie> m_movieBeingRecorded{};
+    std::optional<InputMoviePlayer> m_moviePlayer{};
+
+    // Latest keys from the UI thread. Presses are cleared after every frame, once something has had the chance to act
+    // on them
+    EnumArray<InputHandler::SystemKeyInputs, bool> m_systemKeysPressed{};
+    bool m_isRewindHeld{ false };
+    bool m_isFastForwardHeld{ false };
+    bool m_isFastForwardToggledOn{ false };
+
+    Chip8::Breakpoints m_breakpoints{};
+    std::optional<Chip8::BreakHit> m_lastBreakHit{};
+    ExecutionProfiler::Mode m_profilerMode{ ExecutionProfiler::Mode::off };
+    static constexpr std::string_view s_foldedStacksPath{ "profiles/profile.folded" };
+    std::string m_profileExportMessage{};
+
+    uint64_t m_numInstrExecutedThisFrame{ 0 };
+    float m_speedMultiplier{ 1.0f };
+
+    std::string m_saveStateErrorMessage{};
+    std::string m_currentErrorMessage{ "No ROM loaded. Open menu to load ROM." };
+
+    SpscQueue<EmulatorCommand, s_commandQueueCapacity> m_commands{};
+    TripleBuffer<EmulatorSnapshot> m_snapshots{};
+
+    std::exception_ptr m_failure{};
+    std::atomic<bool> m_hasFailed{ false };
+
+    // Last, so that the thread starts once everything it uses is constructed, and is joined before any of it is destroyed
+    std::jthread m_thread{};
+};
+
+#endif
@@ -3,23 +3,24 @@
 
 #include <cstdint>
 #include <memory>
+#include <vector>
 
 #include "utils/frametimer.h"
 #include "types/displaysettings.h"
-#include "statemanager.h"
+#include "types/emulatorcommand.h"
+#include "types/emulatorsnapshot.h"
 #include "inputhandler.h"
+#include "emulationthread.h"
 
 class Renderer;
 class ImguiRenderer;
 struct DisplaySettings;
 
-class Chip8;
 class AudioPlayer;
 
-class BadOpcodeException;
-class FileInputException;
-
 
+// The UI thread: reads SDL input, draws whatever the EmulationThread last published, and sends it commands for
+// everything the user does
 class Emulator
 {
 public:
@@ -38,36 +39,38 @@ private:
     void initialiseGUIRenderer();
 
     void processInputs();
-    void emulateFrame();
-    void updateAudioState();
+    void updateAudioState(const EmulatorSnapshot& snapshot);
 
-    void render();
+    void render(const EmulatorSnapshot& snapshot);
     void updateFrameTimingInfo();
 
-    void handleEmulatorStateTransitions();
-    void executeChipInstructions();
-    int calculateNumInstructionsNeededForFrame();
-
-    void handleOpcodeExecutionError(const std::runtime_error& exception);
-    void handleFileInputError(const FileInputException& exception);
+    // Frames are presented at the target FPS, or at the display's refresh rate if that is lower, since presenting any
+    // faster than the display refreshes would only be throwing frames away
+    int calculatePresentRate() const;
 
-    std::unique_ptr<Chip8> m_chip{};
+    void sendPendingCommands();
 
     std::unique_ptr<Renderer> m_renderer{};
     std::unique_ptr<ImguiRenderer> m_imguiRenderer{};
 
     FrameTimer m_frameTimer{ 60 };
     InputHandler m_inputHandler{};
-    StateManager m_stateManager{};
-
 
     std::unique_ptr<AudioPlayer> m_audioPlayer{};
     std::shared_ptr<DisplaySettings> m_displaySettings{};
 
     bool m_isRunning{};
-    uint64_t m_numInstrExecutedThisFrame{};
 
-    std::string m_currentErrorMessage{ "No ROM loaded. Open menu to load ROM." };
+    // Commands wait here until the end of the frame. Any that don't fit in the emulation thread's queue stay for the
+    // next frame, so that none are lost or sent out of order
+    std::vector<EmulatorCommand> m_pendingCommands{};
+    EmulatorCommands::SetInputs m_lastSentInputs{};
+
+    // The screen as it was last drawn, to find which rows of the next snapshot's screen changed
+    Chip8::ScreenBuffer m_lastDrawnScreen{};
+
+    // Last, so that the thread is stopped before anything else is destroyed
+    std::unique_ptr<EmulationThread> m_emulationThread{};
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,160 @@
+#ifndef EXECUTION_PROFILER_H
+#define EXECUTION_PROFILER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+#include <span>
+#include <vector>
+
+#include "opcodedecoder.h"
+#include "types/enumarray.h"
+
+// Counts how many instructions were executed at each address, and of each operation, to find where a ROM spends its
+// time. Only the interpreter can count instructions one at a time, so Chip8 runs through the interpreter whenever
+// isRecordingNextRun() says to. Its behaviour is identical to every other engine's, so profiling never changes what the
+// ROM does, only how fast it runs.
+// Subroutine calls are followed too, building a call tree that gives each routine's own and total instructions, and that
+// can be written out as folded stacks for flame graphs
+class ExecutionProfiler
+{
+public:
+    enum class Mode
+    {
+        off,
+
+        // Counts every instruction of roughly one run of executeInstructions() in s_meanRunsPerSample, and leaves the
+        // selected engine to run the rest at full speed. Cheap enough to leave on
+        sampled,
+
+        // Counts every instruction, and so always runs through the interpreter
+        exact,
+
+        MAX_VALUE,
+    };
+
+    // Roughly one frame in this many is counted in sampled mode
+    static constexpr int s_meanRunsPerSample{ 128 };
+
+    // Calls down paths the tree has no room left for are counted as part of the caller
+    static constexpr std::size_t s_maxCallTreeNodes{ 1 << 14 };
+
+    struct RoutineProfile
+    {
+        // Code that isn't inside any subroutine, i.e. called from nowhere, is the top level rather than a routine
+        bool isTopLevel{ false };
+        uint16_t address{};
+
+        // Instructions run in the routine itself, and in the routine or anything it called. A recursive routine's
+        // instructions only count once towards its own inclusive hits
+        uint64_t exclusiveHits{ 0 };
+        uint64_t inclusiveHits{ 0 };
+        uint64_t numCalls{ 0 };
+    };
+
+    explicit ExecutionProfiler(std::size_t memorySize);
+
+    Mode getMode() const { return m_mode; }
+    void setMode(Mode mode);
+
+    // Whether the next run of executeInstructions() should be counted. Called once per run
+    bool isRecordingNextRun()
+    {
+        switch (m_mode)
+        {
+        case Mode::exact: return true;
+        case Mode::sampled: return --m_runsUntilSample <= 0 && startNextSample();
+        default: return false;
+        }
+    }
+
+    void record(const uint16_t address, const OpcodeDecoder::Operation operation)
+    {
+        ++m_hitsAtAddress[address % m_hitsAtAddress.size()];
+        ++m_hitsPerOperation[operation];
+        ++m_totalHits;
+
+        ++m_callTree[m_currentNode].numHits;
+        ++m_routineStats[m_currentRoutine].exclusiveHits;
+    }
+
+    // The routines the Chip8's stack is in, outermost first. Needed before every recorded run, since the ROM may have
+    // called or returned any number of times while it wasn't being recorded
+    void beginRun(std::span<const uint16_t> routines);
+
+    // Whenever a recorded instruction pushes to or pops from the Chip8's stack
+    void enterRoutine(uint16_t address) { enterRoutine(address, true); }
+    void leaveRoutine();
+
+    // Every routine called so far, plus the top level. Fills routines rather than returning, so that it can be refilled
+    // every frame without allocating
+    void getRoutineProfiles(std::vector<RoutineProfile>& routines) const;
+
+    // One "main;sub_2A0;sub_310 1234" line per path through the call tree that ran any instructions, as read by
+    // flamegraph.pl, speedscope and similar
+    void writeFoldedStacks(std::ostream& output) const;
+
+    std::span<const uint64_t> getHitsAtAddress() const { return m_hitsAtAddress; }
+    const EnumArray<OpcodeDecoder::Operation, uint64_t>& getHitsPerOperation() const { return m_hitsPerOperation; }
+    uint64_t getTotalHits() const { return m_totalHits; }
+
+    void clear();
+
+private:
+    // Picks how many runs to leave until the next sample, and returns true
+    bool startNextSample();
+
+    // isCall is false when beginRun() is catching up with calls made while nothing was recorded
+    void enterRoutine(uint16_t address, bool isCall);
+    uint32_t findOrAddChild(uint32_t parent, uint16_t routine);
+
+    static constexpr uint32_t s_noNode{ UINT32_MAX };
+    static constexpr uint32_t s_rootNode{ 0 };
+
+    // Each node is one path of calls from the top level. Node 0 is the top level itself
+    struct CallTreeNode
+    {
+        uint16_t routine{};
+        uint32_t parent{ s_noNode };
+        uint32_t firstChild{ s_noNode };
+        uint32_t nextSibling{ s_noNode };
+        uint64_t numHits{ 0 };
+    };
+
+    // Indexed by routine address, with the top level at the end
+    struct RoutineStats
+    {
+        uint64_t exclusiveHits{ 0 };
+        uint64_t inclusiveHits{ 0 };
+        uint64_t numCalls{ 0 };
+
+        // Inclusive hits are added up when the outermost call returns, so recursion doesn't count them twice
+        uint32_t numActiveCalls{ 0 };
+        uint64_t totalHitsWhenCalled{ 0 };
+    };
+
+    struct CallPathEntry
+    {
+        uint16_t routine{};
+        uint32_t node{};
+    };
+
+    Mode m_mode{ Mode::off };
+
+    std::vector<uint64_t> m_hitsAtAddress{};
+    EnumArray<OpcodeDecoder::Operation, uint64_t> m_hitsPerOperation{};
+    uint64_t m_totalHits{ 0 };
+
+    std::vector<CallTreeNode> m_callTree{};
+    std::vector<RoutineStats> m_routineStats{};
+    std::vector<CallPathEntry> m_callPath{};
+    uint32_t m_currentNode{ s_rootNode };
+    std::size_t m_currentRoutine{};
+
+    // The gap between samples is random, so that a ROM doing something every so many frames can't always fall in
+    // (or always miss) the sampled ones. Not the Chip8's own generator, which is machine state
+    int m_runsUntilSample{ 1 };
+    uint32_t m_sampleGapRandomState{ 0x9E3779B9 };
+};
+
+#endif
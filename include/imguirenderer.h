@@ -1,7 +1,9 @@
 #ifndef IMGUI_RENDERER_H
 #define IMGUI_RENDERER_H
 
+#include <array>
 #include <memory>
+#include <string>
 #include <SDL.h>
 
 #include "types/displaysettings.h"
@@ -10,9 +12,16 @@
 #include "imgui_impl_sdl2.h"
 
 #include "statemanager.h"
+#include "savestateslots.h"
 #include <vector>
 #include "chip8.h"
+#include "disassembler.h"
+#include "types/emulatorcommand.h"
+#include "types/emulatorsnapshot.h"
 #include <format>
+#include <chrono>
+#include <span>
+#include <string_view>
 
 class Renderer;
 struct FrameInfo;
@@ -21,14 +30,40 @@ struct DisplaySettings;
 class ImguiRenderer
 {
 public:
+	enum class Window
+	{
+		generalInfo,
+		memoryViewer,
+		registerViewer,
+		stackViewer,
+		disassembly,
+		breakpoints,
+		profiler,
+		displaySettings,
+		chipSettings,
+		gameDisplay,
+		romSelect,
+		saveStates,
+		MAX_VALUE,
+	};
+
+	// CPU time spent building each window during the last drawAllImguiWindows(), in microseconds. Windows that weren't
+	// drawn that frame are 0. Doesn't include ImGui turning everything into draw calls at the end of the frame
+	using WindowTimes = EnumArray<Window, double>;
+
 	ImguiRenderer(SDL_Window* window, SDL_Renderer* renderer, std::shared_ptr<DisplaySettings> displaySettings,
 		const float displayScaleFactor);
     ~ImguiRenderer();
 
+	// Windows only ever read the snapshot. Anything the user changes about the emulator is appended to commands instead,
+	// for the EmulationThread to apply
 	void drawAllImguiWindows(std::shared_ptr<DisplaySettings> displaySettings, Renderer &renderer,
-						 Chip8 &chip, const StateManager &stateManager,
+						 const EmulatorSnapshot &snapshot, std::vector<EmulatorCommand> &commands,
 						 const FrameInfo &frameInfo, const bool isAudioLoaded);
 
+	const WindowTimes& getLastFrameWindowTimes() const { return m_windowTimes; }
+	static std::string_view getWindowName(Window window) { return s_windowNames[window]; }
+
     template <class... Args>
     void displayText(std::format_string<Args...> format, Args&&... args) const
     {
@@ -38,6 +73,14 @@ public:
 
 
 private:
+	template <typename DrawFunction>
+	void timeWindow(const Window window, DrawFunction&& drawWindow)
+	{
+		const auto startTime{ std::chrono::steady_clock::now() };
+		drawWindow();
+		m_windowTimes[window] = std::chrono::duration<double, std::micro>{ std::chrono::steady_clock::now() - startTime }.count();
+	}
+
 	void displayTextCentredInBounds(const std::string& text,
 				const float leftBoundX, const float rightBoundX) const;
 
@@ -47,7 +90,8 @@ private:
 	void drawTextScaleEditor(const float minTextScale, const float maxTextScale);
 
 
-	void drawIPSEditor(Chip8& chip) const;
+	void drawIPSEditor(const EmulatorSnapshot& snapshot, std::vector<EmulatorCommand>& commands) const;
+	void drawExecutionEngineEditor(const EmulatorSnapshot& snapshot, std::vector<EmulatorCommand>& commands) const;
 
 	void displayHelpMarker(std::string_view) const;
 
@@ -60,26 +104,74 @@ private:
 	const uint16_t programStartAddress, const uint16_t programEndAddress,
 	const uint16_t fontStartAddress, const uint16_t fontEndAddress) const;
 
-	void printMemoryRow(const std::array<uint8_t, 4096>& memoryContents, const std::size_t rowStartPos, const int numBytesToPrint,
-		const Chip8::RuntimeMetaData& runtimeData, const uint16_t chipPCValue) const;
+	static constexpr std::size_t s_bytesPerMemoryRow{ 16 };
+
+	// How many frames a byte or register that changed stays highlighted for
+	static constexpr int s_writeHighlightFrames{ 30 };
+
+	// One row of the memory viewer, formatted and kept between frames
+	struct MemoryRowText
+	{
+		std::array<uint8_t, s_bytesPerMemoryRow> bytes{};
+		std::array<char, s_bytesPerMemoryRow * 3> hex{};
+		std::array<char, s_bytesPerMemoryRow> ascii{};
+		std::size_t numBytes{ 0 };
+
+		// One bit per byte that changed, the last time any of them did, and the ImGui frame that was
+		uint16_t recentlyWrittenBytes{ 0 };
+		int writtenOnFrame{ -s_writeHighlightFrames };
+	};
+	static_assert(s_bytesPerMemoryRow <= 16, "Each byte of a row needs a bit in recentlyWrittenBytes");
+
+	struct RegisterText
+	{
+		uint8_t value{};
+		std::string text{};
+		int writtenOnFrame{ -s_writeHighlightFrames };
+	};
+
+	static bool isRecentlyWritten(int writtenOnFrame);
 
-	void printASCIIRepresentationOfMemoryRow(const std::array<uint8_t, 4096>& memoryContents,
-		const std::size_t rowStartPos, const int numBytesToPrint) const;
+	// Formats the rows again for every memory region whose generation moved since last frame, and no others
+	void updateMemoryRowText(std::span<const uint8_t> memoryContents, const Chip8::DebugGenerations& generations);
+	static void formatMemoryRow(MemoryRowText& row, std::span<const uint8_t> rowContents, bool highlightChanges);
 
-	void drawMemoryViewerWindow(const Chip8& chip) const;
+	// rowHits is empty unless the profiler heatmap is shown, in which case each byte gets a background as hot as its
+	// share of maxHits
+	void printMemoryRow(const MemoryRowText& row, const std::size_t rowStartAddress,
+		const Chip8::RuntimeMetaData& runtimeData, const uint16_t chipPCValue,
+		std::span<const uint64_t> rowHits, uint64_t maxHits) const;
 
-	void drawSpecialChipRegisterContents(const Chip8& chip) const;
-	void drawRegisterViewerWindow(const Chip8& chip) const;
+	void drawMemoryViewerWindow(const EmulatorSnapshot& snapshot);
 
-	void drawDisplaySettingsWindowAndApplyChanges();
+	void updateRegisterText(const Chip8::SaveState& chip, const Chip8::DebugGenerations& generations);
 
-	void drawChipSettingsWindow(Chip8::QuirkFlags& chipQuirkFlags, Chip8& chip) const;
+	void drawSpecialChipRegisterContents(const Chip8::SaveState& chip) const;
+	void drawRegisterViewerWindow(const Chip8::SaveState& chip, const Chip8::DebugGenerations& generations);
+
+	void drawDisplaySettingsWindowAndApplyChanges(const Renderer& renderer, const EmulatorSnapshot& snapshot);
+
+	void drawChipSettingsWindow(const EmulatorSnapshot& snapshot, std::vector<EmulatorCommand>& commands) const;
 
 	void drawGameDisplayWindow(SDL_Texture* gameFrame) const;
 
-	void drawStackDisplayWindow(const std::vector<uint16_t>& stackContents) const;
+	void drawStackDisplayWindow(std::span<const uint16_t> stackContents, std::size_t maxStackDepth) const;
+
+	// Lists memory as instructions, lined up with and scrolled to follow the PC. Only the lines in view are looked at,
+	// and only ones whose bytes changed are disassembled again
+	void drawDisassemblyWindow(const Chip8::SaveState& chip);
+
+	// The breakpoints live here, and the whole set is sent to the emulation thread whenever any of them change
+	void drawBreakpointsWindow(const EmulatorSnapshot& snapshot, std::vector<EmulatorCommand>& commands);
+	std::string describeBreakHit(const Chip8::BreakHit& hit) const;
 
-	void drawROMSelectWindow(Chip8& chip);
+	// Sortable tables of the most executed addresses, operations and subroutines, from the counts in the snapshot. Also
+	// starts and stops the frame timeline trace
+	void drawProfilerWindow(const EmulatorSnapshot& snapshot, std::vector<EmulatorCommand>& commands);
+
+	void drawROMSelectWindow(std::vector<EmulatorCommand>& commands);
+
+	void drawSaveStatesWindow(const EmulatorSnapshot& snapshot, std::vector<EmulatorCommand>& commands);
 
 
     int m_windowWidth{};
@@ -87,9 +179,60 @@ private:
 	std::shared_ptr<DisplaySettings> m_displaySettings{};
     float m_dpiScaleFactor{ 0 };
 
+	WindowTimes m_windowTimes{};
+
+	// Text the memory and register viewers drew last frame, and the DebugGenerations it was formatted at
+	std::vector<MemoryRowText> m_memoryRows{};
+	Chip8::DebugGenerations m_memoryRowGenerations{};
+	std::array<RegisterText, 16> m_registerText{};
+	Chip8::DebugGenerations m_registerTextGenerations{};
+
+	DisassemblyCache m_disassemblyCache{ Chip8::InitialConfig::bitsOfMemory };
+	bool m_isDisassemblyFollowingPC{ true };
+
+	Chip8::Breakpoints m_breakpoints{};
+	uint16_t m_newBreakpointAddress{ Chip8::InitialConfig::programStartAddress };
+	Chip8::Breakpoints::Watchpoint m_newWatchpoint{};
+	Chip8::Breakpoints::RegisterCondition m_newRegisterCondition{};
+
+	bool m_isHeatmapShown{ true };
+
+	// Only the most executed addresses are listed, so the table costs the same however long the profiler runs
+	static constexpr std::size_t s_maxHotSpots{ 64 };
+	std::vector<uint16_t> m_hotSpots{};
+	std::vector<OpcodeDecoder::Operation> m_hotOperations{};
+	std::vector<ExecutionProfiler::RoutineProfile> m_routines{};
+
+	static constexpr std::string_view s_tracePath{ "profiles/trace.json" };
+	std::string m_traceMessage{};
+
+	static constexpr EnumArray<Chip8::Breakpoints::Comparison, std::string_view> s_comparisonSymbols{ {
+		"==",
+		"!=",
+		"<",
+		">",
+	} };
+
+	static constexpr EnumArray<Window, std::string_view> s_windowNames{ {
+		"Emulator Info",
+		"Memory Viewer",
+		"Register Viewer",
+		"Stack Viewer",
+		"Disassembly",
+		"Breakpoints",
+		"Profiler",
+		"Display Settings",
+		"Chip Settings",
+		"Game Display",
+		"ROM Select",
+		"Save States",
+	} };
+
     static constexpr ImVec4 red{ 1.0f, 0.0f, 0.0f, 1.0f };
     static constexpr ImVec4 green{ 0.0f, 1.0f, 0.0f, 1.0f };
     static constexpr ImVec4 blue{ 0.0f, 0.0f, 1.0f, 1.0f };
+    static constexpr ImVec4 yellow{ 1.0f, 1.0f, 0.0f, 1.0f };
+    static constexpr ImVec4 heat{ 1.0f, 0.35f, 0.0f, 1.0f };
 
 	static constexpr ImVec4 defaultTextColour{ 1.0f, 1.0f, 1.0f, 1.0f };
 };
@@ -25,15 +25,37 @@ public:
 
         K_DEACTIVATE_DEBUG,
         K_TOGGLE_DEBUG_WINDOWS,
+
+        // Act on the selected save state slot
+        K_SAVE_STATE,
+        K_LOAD_STATE,
+        K_PREVIOUS_SAVE_SLOT,
+        K_NEXT_SAVE_SLOT,
+
+        // Rewinds one frame for every frame it is held down
+        K_REWIND,
+
+        K_TOGGLE_MOVIE_RECORDING,
+        K_TOGGLE_MOVIE_PLAYBACK,
+
+        // Fast forwards while held down
+        K_FAST_FORWARD,
+        K_TOGGLE_FAST_FORWARD,
         MAX_VALUE,
     };
 
-    void readSystemInputs();
+    void readInputs();
+
+    // Which CHIP-8 keypad keys are down, as of the last readInputs()
+    const EnumArray<Chip8::KeyInputs, bool>& getChipKeysDown() const { return m_isChipKeyDown; }
 
-    void readChipAndSystemInputs(Chip8& chip);
+    const EnumArray<SystemKeyInputs, bool>& getSystemKeysPressed() const { return m_isSystemKeyPressed; }
 
     bool isSystemKeyPressed(const SystemKeyInputs key) const { return m_isSystemKeyPressed[key]; }
 
+    // Whether the key is down right now, rather than whether it was pressed this frame. Never while ImGui has the keyboard
+    bool isSystemKeyHeld(SystemKeyInputs key) const;
+
     void resetSystemKeysState() { std::fill(m_isSystemKeyPressed.begin(),
                                              m_isSystemKeyPressed.end(), false); }
 
@@ -73,12 +95,26 @@ private:
 
         SDL_SCANCODE_0,        // Deactivate debug mode
 
-        SDL_SCANCODE_G         // Toggle debug windows
+        SDL_SCANCODE_G,        // Toggle debug windows
+
+        SDL_SCANCODE_F5,       // Save state to selected slot
+        SDL_SCANCODE_F9,       // Load state from selected slot
+        SDL_SCANCODE_F6,       // Select previous save slot
+        SDL_SCANCODE_F7,       // Select next save slot
+
+        SDL_SCANCODE_BACKSPACE,// Rewind (hold)
+
+        SDL_SCANCODE_F10,      // Start/stop recording an input movie
+        SDL_SCANCODE_F11,      // Start/stop playing back the input movie
+
+        SDL_SCANCODE_TAB,      // Fast forward (hold)
+        SDL_SCANCODE_GRAVE,    // Toggle fast forward
     }};
 
-    void checkForChipInput(const SDL_Event& event, Chip8& chip);
+    void checkForChipInput(const SDL_Event& event);
     void checkForSystemInput(const SDL_Event event);
 
+    EnumArray<Chip8::KeyInputs, bool> m_isChipKeyDown{};
     EnumArray<SystemKeyInputs, bool> m_isSystemKeyPressed{};
 };
 
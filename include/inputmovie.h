@@ -0,0 +1,79 @@
+#ifndef INPUT_MOVIE_H
+#define INPUT_MOVIE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "chip8.h"
+
+// A recording of every frame's keys, starting from a known machine state. Replaying it with InputMoviePlayer gives the
+// same machine, frame for frame, on any build and with any execution engine.
+//
+// The start state is a full SaveState, so it carries the ROM, the quirk set and the RNG, which is seeded with
+// getRandomSeed() when recording starts. Frames are stored as runs of identical (keys, instructions) frames, so a movie
+// is mostly the start state and grows by a few bytes for every change of input.
+//
+// File format: the magic "C8MV", a u16 version, the u64 seed, the start state as a u32 length followed by SaveStateFile's
+// encoding, then a u32 run count and each run as varint frames, u16 key mask and varint instructions per frame. All
+// little-endian. Reading anything else throws FileInputException.
+class InputMovie
+{
+public:
+    static constexpr uint16_t s_version{ 1 };
+
+    struct Run
+    {
+        uint32_t numFrames{};
+
+        // Bit n set means key n is down
+        uint16_t keysDown{};
+        uint32_t instructionsPerFrame{};
+    };
+
+    InputMovie(const Chip8::SaveState& startState, uint64_t randomSeed);
+
+    // Seeds chip's generator and starts a movie from its current state
+    static InputMovie startRecording(Chip8& chip, uint64_t randomSeed);
+
+    // Call once per frame, after the frame's keys have been set on chip and before it runs numInstructions
+    void recordFrame(const Chip8& chip, int numInstructions);
+
+    const Chip8::SaveState& getStartState() const { return m_startState; }
+    uint64_t getRandomSeed() const { return m_randomSeed; }
+    const std::vector<Run>& getRuns() const { return m_runs; }
+    std::size_t getNumFrames() const { return m_numFrames; }
+
+    void write(const std::filesystem::path& path) const;
+    static InputMovie read(const std::filesystem::path& path);
+
+private:
+    Chip8::SaveState m_startState{};
+    uint64_t m_randomSeed{};
+    std::vector<Run> m_runs{};
+    std::size_t m_numFrames{ 0 };
+};
+
+// Plays an InputMovie back by driving a Chip8 directly, one frame at a time
+class InputMoviePlayer
+{
+public:
+    // Puts chip into the movie's start state
+    InputMoviePlayer(InputMovie movie, Chip8& chip);
+
+    // Runs the next frame of the movie in the same order as Emulator::emulateFrame, with the recorded keys held down
+    void runFrame(Chip8& chip);
+
+    bool isFinished() const { return m_currentFrame == m_movie.getNumFrames(); }
+    std::size_t getCurrentFrame() const { return m_currentFrame; }
+    const InputMovie& getMovie() const { return m_movie; }
+
+private:
+    InputMovie m_movie;
+
+    std::size_t m_currentFrame{ 0 };
+    std::size_t m_currentRun{ 0 };
+    uint32_t m_framesIntoRun{ 0 };
+};
+
+#endif
@@ -0,0 +1,258 @@
+#ifndef OPCODE_DECODER_H
+#define OPCODE_DECODER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <string_view>
+
+#include "utils/utility.h"
+
+namespace OpcodeDecoder
+{
+    // One entry per instruction the CHIP-8 understands
+    enum class Operation : uint8_t
+    {
+        op00E0,
+        op00EE,
+        op1NNN,
+        op2NNN,
+        op3XNN,
+        op4XNN,
+        op5XY0,
+        op6XNN,
+        op7XNN,
+        op8XY0,
+        op8XY1,
+        op8XY2,
+        op8XY3,
+        op8XY4,
+        op8XY5,
+        op8XY6,
+        op8XY7,
+        op8XYE,
+        op9XY0,
+        opANNN,
+        opBNNN,
+        opCXNN,
+        opDXYN,
+        opEX9E,
+        opEXA1,
+        opFX07,
+        opFX0A,
+        opFX15,
+        opFX18,
+        opFX1E,
+        opFX29,
+        opFX33,
+        opFX55,
+        opFX65,
+
+        // Superinstructions. decode() never produces these, BasicBlockCache swaps them in for the first instruction of a
+        // hot sequence (picked using chip8_profile). The rest of the sequence stays in the block after it, so that the
+        // first instruction can still be run on its own when there isn't enough of the instruction budget left
+        fusedANNNDXYN,
+        fused7XNN3XNN,
+        fusedFX073XNN1NNN,
+
+        invalid,
+        MAX_VALUE,
+    };
+
+    // An opcode with every operand already pulled out, so handlers never have to mask/shift the raw opcode themselves.
+    // Small enough to be passed around by value
+    struct DecodedOpcode
+    {
+        Operation operation{ Operation::invalid };
+        uint8_t x{};
+        uint8_t y{};
+        uint8_t n{};
+        uint8_t nn{};
+        uint16_t nnn{};
+
+        // Kept around for error messages
+        uint16_t opcode{};
+    };
+
+    // Given opcode with X, i.e. 0x3XNN, extracts only the X nibble
+    constexpr uint8_t extractX(const uint16_t opcode) { return Utility::toU8((opcode & 0x0F00) >> 8); }
+
+    // Given opcode with Y, i.e. 0x5XY0, extracts only the Y nibble
+    constexpr uint8_t extractY(const uint16_t opcode) { return Utility::toU8((opcode & 0x00F0) >> 4); }
+
+    // Given opcode with an N segment, i.e. 0xDXYN, extracts only the N nibble
+    constexpr uint8_t extractN(const uint16_t opcode) { return Utility::toU8(opcode & 0x000F); }
+
+    // Given opcode with an NN segment, i.e. 0x3XNN, extracts only the NN Byte
+    constexpr uint8_t extractNN(const uint16_t opcode) { return Utility::toU8(opcode & 0x00FF); }
+
+    // Given opcode with an NNN segment, i.e. 0x1NNN, extracts only the NNN segment
+    constexpr uint16_t extractNNN(const uint16_t opcode) { return Utility::toU16(opcode & 0x0FFF); }
+
+    constexpr Operation decodeOperation(const uint16_t opcode)
+    {
+        switch (opcode & 0xF000)
+        {
+        case 0x0000:
+            switch (opcode & 0x00FF)
+            {
+            case 0x00E0: return Operation::op00E0;
+            case 0x00EE: return Operation::op00EE;
+            default:     return Operation::invalid;
+            }
+        case 0x1000: return Operation::op1NNN;
+        case 0x2000: return Operation::op2NNN;
+        case 0x3000: return Operation::op3XNN;
+        case 0x4000: return Operation::op4XNN;
+        case 0x5000: return Operation::op5XY0;
+        case 0x6000: return Operation::op6XNN;
+        case 0x7000: return Operation::op7XNN;
+        case 0x8000:
+            switch (opcode & 0x000F)
+            {
+            case 0x0000: return Operation::op8XY0;
+            case 0x0001: return Operation::op8XY1;
+            case 0x0002: return Operation::op8XY2;
+            case 0x0003: return Operation::op8XY3;
+            case 0x0004: return Operation::op8XY4;
+            case 0x0005: return Operation::op8XY5;
+            case 0x0006: return Operation::op8XY6;
+            case 0x0007: return Operation::op8XY7;
+            case 0x000E: return Operation::op8XYE;
+            default:     return Operation::invalid;
+            }
+        case 0x9000: return Operation::op9XY0;
+        case 0xA000: return Operation::opANNN;
+        case 0xB000: return Operation::opBNNN;
+        case 0xC000: return Operation::opCXNN;
+        case 0xD000: return Operation::opDXYN;
+        case 0xE000:
+            switch (opcode & 0x00FF)
+            {
+            case 0x009E: return Operation::opEX9E;
+            case 0x00A1: return Operation::opEXA1;
+            default:     return Operation::invalid;
+            }
+        case 0xF000:
+            switch (opcode & 0x00FF)
+            {
+            case 0x0007: return Operation::opFX07;
+            case 0x000A: return Operation::opFX0A;
+            case 0x0015: return Operation::opFX15;
+            case 0x0018: return Operation::opFX18;
+            case 0x001E: return Operation::opFX1E;
+            case 0x0029: return Operation::opFX29;
+            case 0x0033: return Operation::opFX33;
+            case 0x0055: return Operation::opFX55;
+            case 0x0065: return Operation::opFX65;
+            default:     return Operation::invalid;
+            }
+        default:
+            return Operation::invalid;
+        }
+    }
+
+    // Operands only, for callers that already know which operation the opcode is
+    constexpr DecodedOpcode extractOperands(const uint16_t opcode, const Operation operation = Operation::invalid)
+    {
+        return DecodedOpcode{
+            .operation = operation,
+            .x = extractX(opcode),
+            .y = extractY(opcode),
+            .n = extractN(opcode),
+            .nn = extractNN(opcode),
+            .nnn = extractNNN(opcode),
+            .opcode = opcode
+        };
+    }
+
+    constexpr DecodedOpcode decode(const uint16_t opcode)
+    {
+        return extractOperands(opcode, decodeOperation(opcode));
+    }
+
+    // Skips only ever move the PC past the next instruction, so code that groups instructions into straight-line runs
+    // can keep going after one as long as it handles the skipped instruction itself
+    constexpr bool isConditionalSkip(const Operation operation)
+    {
+        switch (operation)
+        {
+        case Operation::op3XNN:
+        case Operation::op4XNN:
+        case Operation::op5XY0:
+        case Operation::op9XY0:
+        case Operation::opEX9E:
+        case Operation::opEXA1:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // True for operations that may move the PC anywhere other than the next instruction (skips aside), write to memory
+    // (and so possibly to code), or that execution has to be able to stop after (DXYN with the display wait quirk).
+    // Anything that groups instructions into straight-line runs has to end a run after one of these
+    constexpr bool endsBasicBlock(const Operation operation)
+    {
+        switch (operation)
+        {
+        case Operation::op00EE:
+        case Operation::op1NNN:
+        case Operation::op2NNN:
+        case Operation::opBNNN:
+        case Operation::opDXYN:
+        case Operation::opFX0A:
+        case Operation::opFX33:
+        case Operation::opFX55:
+        case Operation::invalid:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // How many instructions a fused operation stands for (at most, FX07 + 3XNN + 1NNN only runs 2 if the skip is taken).
+    // 1 for anything else
+    constexpr int getFusedLength(const Operation operation)
+    {
+        switch (operation)
+        {
+        case Operation::fusedANNNDXYN:
+        case Operation::fused7XNN3XNN:
+            return 2;
+        case Operation::fusedFX073XNN1NNN:
+            return 3;
+        default:
+            return 1;
+        }
+    }
+
+    inline constexpr std::array<std::string_view, Utility::toUZ(Operation::MAX_VALUE)> s_operationNames {
+        "00E0", "00EE", "1NNN", "2NNN", "3XNN", "4XNN", "5XY0", "6XNN", "7XNN",
+        "8XY0", "8XY1", "8XY2", "8XY3", "8XY4", "8XY5", "8XY6", "8XY7", "8XYE",
+        "9XY0", "ANNN", "BNNN", "CXNN", "DXYN", "EX9E", "EXA1",
+        "FX07", "FX0A", "FX15", "FX18", "FX1E", "FX29", "FX33", "FX55", "FX65",
+        "ANNN+DXYN", "7XNN+3XNN", "FX07+3XNN+1NNN",
+        "Invalid",
+    };
+
+    // The opcode pattern, e.g. "DXYN"
+    constexpr std::string_view getOperationName(const Operation operation)
+    {
+        return s_operationNames[Utility::toUZ(operation)];
+    }
+
+    inline constexpr std::size_t s_numOpcodes{ 0x10000 };
+    using DecodeTable = std::array<DecodedOpcode, s_numOpcodes>;
+
+    // Every possible 16-bit opcode, decoded at compile time. Defined in opcodedecoder.cpp so that the table is only
+    // built once rather than in every translation unit that includes this header
+    extern const DecodeTable s_decodeTable;
+
+    inline const DecodedOpcode& lookup(const uint16_t opcode)
+    {
+        return s_decodeTable[opcode];
+    }
+}
+
+#endif
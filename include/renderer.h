@@ -9,6 +9,12 @@
 #include <memory>
 
 #include <algorithm>
+#include <array>
+#include <bit>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
 
 #include "utils/utility.h"
 #include "types/rgba.h"
@@ -19,10 +25,12 @@ class Renderer
 {
 public:
 
-    struct Pixel
+    // What the Renderer itself asked SDL to do in a frame. ImGui's own draw calls aren't included
+    struct DrawCallCounts
     {
-        SDL_Rect rect{};
-        RGBA colour{};
+        int drawCalls{ 0 };
+        int renderTargetSwitches{ 0 };
+        int textureUploads{ 0 };
     };
 
     Renderer();
@@ -37,68 +45,34 @@ public:
     Renderer(Renderer&&) = default;
     Renderer& operator=(Renderer&&) = default;
 
-    template<typename T, std::size_t R, std::size_t C>
-    using Array2D = std::array<std::array<T, C>, R>;
-
-    template<typename T, std::size_t R, std::size_t C>
-    void drawChipScreenBufferToFrame(const Array2D<T, R, C>& screenBuffer)
+    // Packed rows, laid out like Chip8::ScreenBuffer: one bit per pixel with the leftmost pixel in the most significant
+    // bit. The pixels live in a texture that is kept between frames, and only the rows set in dirtyRowMask (bit y for
+    // row y) are drawn into it again. Every other frame only costs copying that texture over.
+    // With DisplaySettings::useStreamingTexture the texture is 64x32 and rows are written straight into its pixels,
+    // otherwise it is frame sized and rows are drawn into it as rects
+    template<std::size_t R>
+    void drawChipScreenBufferToFrame(const std::array<uint64_t, R>& screenRows, const uint32_t dirtyRowMask)
     {
-        int gameFrameWidth{};
-        int gameFrameHeight{};
-
-        if (m_displaySettings -> renderGameToImGuiWindow)
-        {
-            SDL_SetRenderTarget(m_renderer.get(), m_currentGameFrame.get());
-
-            SDL_QueryTexture(m_currentGameFrame.get(), nullptr, nullptr,
-                &gameFrameWidth, &gameFrameHeight);
-        }
-        else
-        {
-            gameFrameWidth = m_displaySettings -> mainWindowWidth;
-            gameFrameHeight = m_displaySettings -> mainWindowHeight;
-        }
-
-        const int pixelWidth{ gameFrameWidth / Utility::toInt(C)};
-        const int pixelHeight{ gameFrameHeight / Utility::toInt(R) };
-
-        for (std::size_t y{ 0 }; y < R; ++y)
-        {
-            for (std::size_t x{ 0 }; x < C; ++x)
-            {
-                uint8_t pixelOn{ screenBuffer[y][x] };
-                RGBA pixelColour{ pixelOn ? m_displaySettings -> onPixelColour : m_displaySettings -> offPixelColour};
-
-                const int xCoordOnScreen{ Utility::toInt(x) * pixelWidth  };
-                const int yCoordOnScreen{ Utility::toInt(y) * pixelHeight };
-
-                assert(xCoordOnScreen <= m_displaySettings -> mainWindowWidth && xCoordOnScreen >= 0);
-                assert(yCoordOnScreen <= m_displaySettings -> mainWindowHeight && yCoordOnScreen >= 0);
-
-                Pixel pixel{ { xCoordOnScreen, yCoordOnScreen, pixelWidth, pixelHeight }
-                            , pixelColour };
-
-                renderPixel(pixel);
-            }
-        }
-        if (m_displaySettings -> gridOn)
-        {
-            drawGrid(pixelWidth, pixelHeight, C, R);
-        }
-
-        if (m_displaySettings -> renderGameToImGuiWindow)
-        {
-            SDL_SetRenderTarget(m_renderer.get(), nullptr);
-        }
+        static_assert(R <= 32, "Each row needs a bit in dirtyRowMask");
+        drawScreenRows(screenRows, dirtyRowMask);
     }
 
     void render()
     {
         SDL_RenderPresent(m_renderer.get());
+
+        m_lastFrameDrawCallCounts = m_drawCallCounts;
+        m_drawCallCounts = {};
     }
 
+    const DrawCallCounts& getLastFrameDrawCallCounts() const { return m_lastFrameDrawCallCounts; }
+
+    // The lines are drawn into a texture once, and only drawn again when the pixel size, frame size or grid colour
+    // changes. Otherwise this is one copy of that texture
     void drawGrid(const int pixelWidth, const int pixelHeight, int horizontalPixelAmount, int verticalPixelAmount);
 
+    // Each string is rendered by SDL_ttf the first time it is drawn and kept as a texture after that, so text that is
+    // drawn every frame only costs a copy
     void drawTextAt(const std::string_view text, const int xPos, const int yPos);
 
     SDL_Window* getWindow() { return m_window.get(); }
@@ -106,6 +80,9 @@ public:
 
     float getDisplayScaleFactor() { return m_displayScaleFactor; }
 
+    // Refresh rate of the display the window is on, or 0 if SDL doesn't know it
+    int getDisplayRefreshRate() const;
+
     SDL_Texture* getCurrentGameFrame() { return m_currentGameFrame.get(); };
 
     void clearDisplay() const;
@@ -120,6 +97,92 @@ private:
 
     std::unique_ptr<SDL_Texture, decltype(&SDL_DestroyTexture)> m_currentGameFrame { nullptr, SDL_DestroyTexture };
 
+    // Everything the contents of m_screenLayer depend on besides the screen itself. If any of it changes, every row is
+    // drawn again
+    struct ScreenLayerProperties
+    {
+        int pixelWidth{};
+        int pixelHeight{};
+        RGBA onPixelColour{};
+        RGBA offPixelColour{};
+        bool isStreamingTexture{ false };
+
+        bool operator==(const ScreenLayerProperties&) const = default;
+    };
+
+    std::unique_ptr<SDL_Texture, decltype(&SDL_DestroyTexture)> m_screenLayer{ nullptr, SDL_DestroyTexture };
+    ScreenLayerProperties m_screenLayerProperties{};
+    SDL_Point m_screenLayerSize{};
+
+    // Set the first time the streaming texture can't be locked. The rest of the session draws rects instead, whatever
+    // DisplaySettings::useStreamingTexture says
+    bool m_hasStreamingTextureFailed{ false };
+
+    // Everything the contents of m_gridLayer depend on. If any of it changes, the grid is drawn again
+    struct GridLayerProperties
+    {
+        int pixelWidth{};
+        int pixelHeight{};
+        int numColumns{};
+        int numRows{};
+        int frameWidth{};
+        int frameHeight{};
+        RGBA gridColour{};
+
+        bool operator==(const GridLayerProperties&) const = default;
+    };
+
+    std::unique_ptr<SDL_Texture, decltype(&SDL_DestroyTexture)> m_gridLayer{ nullptr, SDL_DestroyTexture };
+    GridLayerProperties m_gridLayerProperties{};
+
+    // Lets the text cache be searched with a string_view, without building a std::string every frame to do it
+    struct TextTextureKeyView
+    {
+        std::string_view text{};
+        RGBA colour{};
+        int fontSize{};
+
+        bool operator==(const TextTextureKeyView&) const = default;
+    };
+
+    struct TextTextureKey
+    {
+        std::string text{};
+        RGBA colour{};
+        int fontSize{};
+
+        operator TextTextureKeyView() const { return { text, colour, fontSize }; }
+    };
+
+    struct TextTextureKeyHash
+    {
+        using is_transparent = void;
+        std::size_t operator()(const TextTextureKeyView& key) const noexcept;
+    };
+
+    struct TextTextureKeyEqual
+    {
+        using is_transparent = void;
+        bool operator()(const TextTextureKeyView& lhs, const TextTextureKeyView& rhs) const { return lhs == rhs; }
+    };
+
+    struct TextTexture
+    {
+        std::unique_ptr<SDL_Texture, decltype(&SDL_DestroyTexture)> texture{ nullptr, SDL_DestroyTexture };
+        int width{};
+        int height{};
+    };
+
+    // Error messages can name any ROM path, so the cache is emptied once it holds this many rather than growing forever
+    static constexpr std::size_t s_maxCachedTextTextures{ 64 };
+    std::unordered_map<TextTextureKey, TextTexture, TextTextureKeyHash, TextTextureKeyEqual> m_textTextures{};
+
+    static constexpr int s_defaultFontSize{ 24 };
+
+    // Counted from const drawing functions too, it doesn't change what gets drawn
+    mutable DrawCallCounts m_drawCallCounts{};
+    DrawCallCounts m_lastFrameDrawCallCounts{};
+
     std::unique_ptr<TTF_Font, decltype(&TTF_CloseFont)> m_defaultFont{ nullptr, TTF_CloseFont };
 
 	std::string m_windowTitle{ "CHIP-8 Emulator" };
@@ -128,7 +191,24 @@ private:
     std::unique_ptr<SDL_Renderer, decltype(&SDL_DestroyRenderer)> m_renderer{ nullptr, SDL_DestroyRenderer };
 
 
-    void renderPixel(const Pixel& pixel) const;
+    void setRenderTarget(SDL_Texture* target) const;
+
+    void drawScreenRows(std::span<const uint64_t> screenRows, uint32_t dirtyRowMask);
+    void redrawScreenLayerRows(std::span<const uint64_t> screenRows, uint32_t rowMask) const;
+    // Returns false if the texture couldn't be locked, leaving it as it was
+    bool uploadScreenLayerRows(std::span<const uint64_t> screenRows, uint32_t rowMask) const;
+
+    // Returns true if the layer was (re)created or its colours changed, meaning every row has to be drawn again
+    bool prepareScreenLayer(const ScreenLayerProperties& properties, int numRows);
+
+    void prepareGridLayer(const GridLayerProperties& properties);
+
+    // Returns nullptr if SDL_ttf couldn't render the text, which it can't for an empty string
+    const TextTexture* findOrCreateTextTexture(std::string_view text, RGBA colour);
+
+    // Points rendering at wherever the game is drawn to, and returns the size of that area
+    SDL_Point beginGameFrame();
+    void endGameFrame();
 
     float calculateDisplayDPIScaleFactor()
     {
@@ -138,8 +218,9 @@ private:
 
         if (SDL_GetDisplayDPI(0, &diagonalDPI, &horizontalDPI, &verticalDPI))
         {
-            std::cerr << "SDL failed to fetch display DPI properly. SDL_Error: " << SDL_GetError() << std::endl;
-            std::exit(1);
+            // Some video drivers (e.g. SDL's dummy driver on machines without a display) have no idea what the DPI is
+            std::cerr << "SDL failed to fetch display DPI properly, assuming no scaling. SDL_Error: " << SDL_GetError() << std::endl;
+            return 1.0f;
         }
 
         const float dpiScaleFactor { diagonalDPI / m_defaultDPI };
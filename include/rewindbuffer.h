@@ -0,0 +1,91 @@
+#ifndef REWIND_BUFFER_H
+#define REWIND_BUFFER_H
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "chip8.h"
+
+// History of one Chip8::SaveState per frame, for rewinding. Everything lives in one arena allocated up front, used as
+// a ring: once it is full, the oldest frames are dropped to make room for new ones.
+//
+// Every keyframeInterval frames the whole state is stored. Every other frame is stored as the XOR of its state with the
+// frame before it, where almost every byte is 0. Both are run length encoded as (run of zero bytes, run of literal bytes)
+// pairs, so a typical frame takes tens of bytes and minutes of history fit in a few MB.
+//
+// Stepping back over a delta XORs it into the current state. Stepping back over a keyframe rebuilds the frame before it
+// from the previous keyframe, so no frame costs more than keyframeInterval deltas to reach.
+class RewindBuffer
+{
+public:
+    static constexpr int s_defaultKeyframeInterval{ 60 };
+
+    explicit RewindBuffer(std::size_t capacityInBytes, int keyframeInterval = s_defaultKeyframeInterval);
+
+    // Call once per emulated frame, with the state at the end of that frame
+    void push(const Chip8::SaveState& state);
+
+    // Drops the newest frame and writes the one before it to state. Returns false, leaving state alone, if there is no
+    // older frame to go back to
+    bool stepBack(Chip8::SaveState& state);
+
+    void clear();
+
+    // Clears the history, since the arena is reallocated
+    void setCapacity(std::size_t capacityInBytes);
+
+    std::size_t getCapacity() const { return m_arena.size(); }
+    std::size_t getUsedBytes() const { return m_usedBytes; }
+    std::size_t getNumFrames() const { return m_numRecords; }
+
+private:
+    using StateBytes = std::array<uint8_t, sizeof(Chip8::SaveState)>;
+
+    struct RecordHeader
+    {
+        uint32_t payloadSize{};
+        uint32_t previousRecordOffset{};
+        bool isKeyframe{};
+    };
+
+    static constexpr std::size_t s_headerSize{ sizeof(RecordHeader) };
+
+    // Encodes the XOR of state and base into m_encoded and returns how many bytes of it were used
+    std::size_t encode(const StateBytes& state, const StateBytes& base);
+
+    // XORs an encoded payload into state
+    static void decodeInto(std::span<const uint8_t> payload, StateBytes& state);
+
+    // Finds space for a record of recordSize bytes, evicting the oldest frames as needed. Returns false if a record that
+    // big can never fit
+    bool makeRoomFor(std::size_t recordSize, std::size_t& offset);
+    void evictOldest();
+
+    RecordHeader readHeader(std::size_t offset) const;
+    std::span<const uint8_t> getPayload(std::size_t offset) const;
+
+    std::vector<uint8_t> m_arena{};
+    int m_keyframeInterval{};
+
+    // Records sit one after another from m_oldestOffset. When the next one doesn't fit before the end of the arena it
+    // goes at offset 0 instead, and m_wrapOffset marks where the records before the wrap stop
+    std::size_t m_oldestOffset{ 0 };
+    std::size_t m_newestOffset{ 0 };
+    std::size_t m_writeOffset{ 0 };
+    std::size_t m_wrapOffset{ 0 };
+    bool m_isWrapped{ false };
+
+    std::size_t m_numRecords{ 0 };
+    std::size_t m_usedBytes{ 0 };
+    int m_framesSinceKeyframe{ 0 };
+
+    // State of the newest frame, which every new delta is taken against
+    StateBytes m_newestState{};
+
+    // Scratch space, sized for the worst case once so that pushing never allocates
+    std::vector<uint8_t> m_encoded{};
+    std::vector<std::size_t> m_deltasSinceKeyframe{};
+};
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef SAVE_STATE_FILE_H
+#define SAVE_STATE_FILE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+#include "chip8.h"
+
+// Binary encoding of Chip8::SaveState. Starts with the magic "C8SS" and a format version, then every field in a fixed
+// order, little-endian, with no padding. Only the used part of the stack is stored, and the keys, quirks and flags are
+// packed into bits, so a state is a little over 4.5 KB, almost all of which is memory.
+//
+// Anything that can't be read back exactly (wrong magic, another version, truncated, out of range values) throws
+// FileInputException rather than producing a partly restored machine.
+namespace SaveStateFile
+{
+    // Bump whenever the layout changes
+    constexpr uint16_t version{ 2 };
+
+    std::vector<uint8_t> serialize(const Chip8::SaveState& state);
+    Chip8::SaveState deserialize(std::span<const uint8_t> bytes);
+
+    void write(const std::filesystem::path& path, const Chip8::SaveState& state);
+    Chip8::SaveState read(const std::filesystem::path& path);
+}
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef SAVE_STATE_SLOTS_H
+#define SAVE_STATE_SLOTS_H
+
+#include <array>
+#include <filesystem>
+#include <optional>
+
+#include "chip8.h"
+
+// Numbered save state slots. Every slot keeps its state in memory, so loading one is only a Chip8::loadState, and is
+// also written through to a file in the save directory (see SaveStateFile) so it is still there next time
+class SaveStateSlots
+{
+public:
+    static constexpr int s_numSlots{ 10 };
+
+    // Picks up any slots already saved in directory
+    explicit SaveStateSlots(std::filesystem::path directory);
+
+    // Throws FileInputException if the slot's file can't be written. The slot still holds the state in that case
+    void save(int slot, const Chip8& chip);
+
+    // Returns false, leaving chip alone, if nothing was ever saved to the slot
+    bool load(int slot, Chip8& chip) const;
+
+    bool isOccupied(int slot) const;
+
+    int getSelectedSlot() const { return m_selectedSlot; }
+    void selectSlot(int slot);
+    void selectNextSlot();
+    void selectPreviousSlot();
+
+private:
+    std::filesystem::path getSlotPath(int slot) const;
+
+    std::filesystem::path m_directory{};
+    std::array<std::optional<Chip8::SaveState>, s_numSlots> m_slots{};
+    int m_selectedSlot{ 0 };
+};
+
+#endif
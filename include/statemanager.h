@@ -12,6 +12,9 @@ public:
 	{
 		running,
 		debug,
+
+		// Like running, but emulates as many frames as fit between two presented frames instead of one
+		fastForward,
 		numMainStates,
 	};
 
@@ -36,12 +39,13 @@ public:
 private:
 	static constexpr std::array<std::string_view, numMainStates> s_stateStrings {
 		"Running",
-		"Debug"
+		"Debug",
+		"Fast Forward",
 	};
 
 	static_assert(s_stateStrings.size() == numMainStates);
 
-	static constexpr std::array<std::string_view, numMainStates> s_debugModeStrings {
+	static constexpr std::array<std::string_view, numDebugModes> s_debugModeStrings {
 		"Step",
 		"Manual"
 	};
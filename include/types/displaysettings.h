@@ -12,10 +12,17 @@ struct DisplaySettings
     int gameDisplayTextureHeight{ 960 };
     int targetFPS{ 60 };
 
+    // How long before each frame's deadline FrameTimer stops sleeping and spins instead
+    int frameSpinWindowMicroSec{ 500 };
+
     bool showDebugWindows{ true };
     bool gridOn{ true };
     bool fullScreenEnabled { false };
     bool renderGameToImGuiWindow { false };
+    bool useStreamingTexture{ true };
+
+    // Most memory the rewind history may take up. Changing it throws the current history away
+    int rewindMemoryLimitMB{ 8 };
 
     RGBA onPixelColour{ RGBA::white()  };
     RGBA offPixelColour{ RGBA::black() };
@@ -0,0 +1,124 @@
+#ifndef EMULATOR_COMMAND_H
+#define EMULATOR_COMMAND_H
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <variant>
+
+#include "enumarray.h"
+#include "../chip8.h"
+#include "../inputhandler.h"
+
+// Everything the UI thread asks the emulation thread to do, sent through EmulationThread's command queue. The emulation
+// thread is the only one that ever touches the Chip8, so any change to it goes through one of these
+namespace EmulatorCommands
+{
+    // Sent whenever any of it changes, rather than every frame
+    struct SetInputs
+    {
+        EnumArray<Chip8::KeyInputs, bool> chipKeysDown{};
+
+        // Pressed since the last SetInputs. Presses from several of these are combined until the next emulated frame,
+        // so none are lost when the UI runs faster than the emulator
+        EnumArray<InputHandler::SystemKeyInputs, bool> systemKeysPressed{};
+
+        bool isRewindHeld{ false };
+        bool isFastForwardHeld{ false };
+
+        bool operator==(const SetInputs&) const = default;
+    };
+
+    // Keeps the selected execution engine, so that engines can be compared on the same ROM
+    struct LoadRom
+    {
+        std::string path{};
+    };
+
+    struct SetQuirks
+    {
+        Chip8::QuirkFlags quirks{};
+    };
+
+    struct SetTargetNumInstrPerSecond
+    {
+        int target{};
+    };
+
+    struct SetExecutionEngine
+    {
+        Chip8::ExecutionEngine engine{};
+    };
+
+    struct SetTargetFPS
+    {
+        int targetFPS{};
+    };
+
+    struct SetFrameSpinWindow
+    {
+        std::chrono::microseconds spinWindow{};
+    };
+
+    // Throws the rewind history away
+    struct SetRewindCapacity
+    {
+        std::size_t capacityInBytes{};
+    };
+
+    struct SelectSaveSlot
+    {
+        int slot{};
+    };
+
+    struct SaveToSlot
+    {
+        int slot{};
+    };
+
+    struct LoadFromSlot
+    {
+        int slot{};
+    };
+
+    // Replaces every breakpoint, including on whatever Chip8 the next ROM load makes
+    struct SetBreakpoints
+    {
+        Chip8::Breakpoints breakpoints{};
+    };
+
+    // Like breakpoints, carries over to whatever Chip8 the next ROM load makes, although what was counted doesn't
+    struct SetProfilerMode
+    {
+        ExecutionProfiler::Mode mode{};
+    };
+
+    struct ClearProfile
+    {
+    };
+
+    // Writes the profiler's call tree as folded stacks, for flame graph tools
+    struct ExportFoldedStacks
+    {
+    };
+}
+
+using EmulatorCommand = std::variant<
+    EmulatorCommands::SetInputs,
+    EmulatorCommands::LoadRom,
+    EmulatorCommands::SetQuirks,
+    EmulatorCommands::SetTargetNumInstrPerSecond,
+    EmulatorCommands::SetExecutionEngine,
+    EmulatorCommands::SetTargetFPS,
+    EmulatorCommands::SetFrameSpinWindow,
+    EmulatorCommands::SetRewindCapacity,
+    EmulatorCommands::SelectSaveSlot,
+    EmulatorCommands::SaveToSlot,
+    EmulatorCommands::LoadFromSlot,
+    EmulatorCommands::SetBreakpoints,
+    EmulatorCommands::SetProfilerMode,
+    EmulatorCommands::ClearProfile,
+    EmulatorCommands::ExportFoldedStacks
+>;
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef EMULATOR_SNAPSHOT_H
+#define EMULATOR_SNAPSHOT_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "../chip8.h"
+#include "../statemanager.h"
+#include "../savestateslots.h"
+#include "frameinfo.h"
+
+// Everything the UI thread shows about the emulator, copied out by the emulation thread at the end of a frame. Every
+// window draws from the same snapshot, so none of them can see a machine that is halfway through a frame, or show a
+// different frame to the window next to it. See EmulationThread
+struct EmulatorSnapshot
+{
+    Chip8::SaveState chip{};
+    Chip8::DebugGenerations debugGenerations{};
+    int targetNumInstrPerSecond{};
+    Chip8::ExecutionEngine executionEngine{};
+    bool hasAotProgram{ false };
+
+    StateManager stateManager{};
+
+    bool isRecordingMovie{ false };
+    bool isPlayingMovie{ false };
+
+    int selectedSaveSlot{ 0 };
+    std::array<bool, SaveStateSlots::s_numSlots> isSaveSlotOccupied{};
+
+    // Last save that failed to write, kept until the next successful one
+    std::string saveStateErrorMessage{};
+
+    std::size_t numRewindFrames{ 0 };
+    std::size_t rewindBytesUsed{ 0 };
+
+    // Over the emulation thread's last frame, which can be several emulated frames while fast forwarding
+    uint64_t numInstructionsExecuted{ 0 };
+    float speedMultiplier{ 1.0f };
+    FramePacingStats framePacing{};
+
+    // What last stopped the emulator and put it into debug mode, if a breakpoint did
+    std::optional<Chip8::BreakHit> lastBreakHit{};
+
+    // See ExecutionProfiler. The hits at each address are only copied once something has been counted
+    ExecutionProfiler::Mode profilerMode{ ExecutionProfiler::Mode::off };
+    std::vector<uint64_t> profileHitsAtAddress{};
+    EnumArray<OpcodeDecoder::Operation, uint64_t> profileHitsPerOperation{};
+    uint64_t profileTotalHits{ 0 };
+    std::vector<ExecutionProfiler::RoutineProfile> profileRoutines{};
+
+    // Where the last ExportFoldedStacks went, or why it couldn't be written
+    std::string profileExportMessage{};
+
+    // Why no ROM is running. Only shown while chip.runtimeMetaData.romIsLoaded is false
+    std::string errorMessage{};
+};
+
+#endif
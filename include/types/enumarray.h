@@ -36,6 +36,8 @@ struct EnumArray
         return underlyingData;
     }
 
+    constexpr bool operator==(const EnumArray&) const = default;
+
     auto begin() { return underlyingData.begin(); }
     auto end() { return underlyingData.end(); }
     auto begin() const { return underlyingData.begin(); }
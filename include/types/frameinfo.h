@@ -4,6 +4,17 @@
 #include <SDL2/SDL.h>
 #include <cstdint>
 
+// How close FrameTimer came to ending frames exactly on their deadlines
+struct FramePacingStats
+{
+    // How late frames ended, whether from waking up late or from the frame's own work running over
+    float averageOvershootUs{};
+    float maxOvershootUs{};
+
+    // Standard deviation of the time from one frame ending to the next. 0 would be perfectly even frames
+    float jitterUs{};
+};
+
 struct FrameInfo
 {
     int64_t startTimeMs{};
@@ -12,6 +23,12 @@ struct FrameInfo
 
     float fps{};
     uint64_t numInstructionsExecuted{ 0 };
+
+    // Emulated frames per second relative to the target FPS. Above 1 while fast forwarding
+    float speedMultiplier{ 1.0f };
+
+    FramePacingStats pacing{};
+    FramePacingStats emulationPacing{};
 };
 
 #endif
\ No newline at end of file
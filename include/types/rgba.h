@@ -52,6 +52,8 @@ struct RGBA
         };
     }
 
+    constexpr bool operator==(const RGBA&) const = default;
+
     static constexpr RGBA white()       { return RGBA{ 0xFF, 0xFF, 0xFF }; }
     static constexpr RGBA black()       { return RGBA{ 0x00, 0x00, 0x00 }; }
     static constexpr RGBA pureGreen()       { return RGBA{ 0x00, 0xFF, 0x00 }; }
@@ -0,0 +1,120 @@
+#ifndef BYTE_STREAM_H
+#define BYTE_STREAM_H
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "utility.h"
+#include "../exceptions/fileinputexception.h"
+
+// Little-endian encoding for the emulator's binary files, so they read back the same on any platform
+
+class ByteWriter
+{
+public:
+    explicit ByteWriter(std::vector<uint8_t>& bytes)
+    : m_bytes{ bytes }
+    {
+    }
+
+    template <typename T>
+    void write(const T value)
+    {
+        static_assert(std::is_unsigned_v<T>);
+        for (std::size_t byte{ 0 }; byte < sizeof(T); ++byte)
+        {
+            m_bytes.push_back(Utility::toU8(value >> (byte * 8)));
+        }
+    }
+
+    // 7 bits at a time, lowest first, with the top bit set on every byte but the last
+    void writeVarint(uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            m_bytes.push_back(Utility::toU8((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        m_bytes.push_back(Utility::toU8(value));
+    }
+
+    void writeBytes(const std::span<const uint8_t> bytes)
+    {
+        m_bytes.insert(m_bytes.end(), bytes.begin(), bytes.end());
+    }
+
+private:
+    std::vector<uint8_t>& m_bytes;
+};
+
+// Throws FileInputException on reading past the end, naming what was being read
+class ByteReader
+{
+public:
+    ByteReader(const std::span<const uint8_t> bytes, const std::string_view description)
+    : m_bytes{ bytes }
+    , m_description{ description }
+    {
+    }
+
+    template <typename T>
+    T read()
+    {
+        static_assert(std::is_unsigned_v<T>);
+        const std::span<const uint8_t> bytes{ take(sizeof(T)) };
+
+        T value{ 0 };
+        for (std::size_t byte{ 0 }; byte < sizeof(T); ++byte)
+        {
+            value |= static_cast<T>(T{ bytes[byte] } << (byte * 8));
+        }
+        return value;
+    }
+
+    uint64_t readVarint()
+    {
+        uint64_t value{ 0 };
+        for (int shift{ 0 }; shift < 64; shift += 7)
+        {
+            const uint8_t byte{ read<uint8_t>() };
+            value |= uint64_t{ byte & 0x7Fu } << shift;
+            if ((byte & 0x80) == 0)
+            {
+                return value;
+            }
+        }
+        throw FileInputException(std::string{ m_description } + " has a malformed number");
+    }
+
+    void readBytes(const std::span<uint8_t> destination)
+    {
+        const std::span<const uint8_t> bytes{ take(destination.size()) };
+        std::ranges::copy(bytes, destination.begin());
+    }
+
+    std::span<const uint8_t> take(const std::size_t count)
+    {
+        if (m_bytes.size() - m_position < count)
+        {
+            throw FileInputException(std::string{ m_description } + " is truncated");
+        }
+
+        const std::span<const uint8_t> bytes{ m_bytes.subspan(m_position, count) };
+        m_position += count;
+        return bytes;
+    }
+
+    bool isAtEnd() const { return m_position == m_bytes.size(); }
+
+private:
+    std::span<const uint8_t> m_bytes{};
+    std::string_view m_description{};
+    std::size_t m_position{ 0 };
+};
+
+#endif
@@ -2,28 +2,45 @@
 #define FRAME_TIMER_H
 
 #include <SDL2/SDL.h>
+#include <array>
 #include <cstdint>
 #include <memory>
 #include <chrono>
 
-struct FrameInfo;
+#include "../types/frameinfo.h"
+
 struct DisplaySettings;
 
+// Frames end on a fixed grid of absolute deadlines, one target frame time apart. Waiting for a deadline sleeps until
+// the spin window before it, then spins for the rest, since waking up from a sleep can be late by more than the window
 class FrameTimer
 {
 public:
+    static constexpr std::chrono::microseconds s_defaultSpinWindow{ 500 };
+
     explicit FrameTimer(const int targetFPS);
     FrameTimer();
 
     void startFrameTiming();
     void endFrameTiming();
 
+    // Waits for the frame's deadline. Every deadline is a target frame time after the last one rather than after the
+    // frame ended, so a frame that wakes late is made up for by the next, and the average rate doesn't drift
     void delayToReachTargetFrameTime();
 
+    // For frames that should take as long as they take, e.g. while fast forwarding
+    void finishFrameWithoutDelay();
+
     float getActualFPS() const;
     int getTargetFPS() const;
     void setTargetFPS(const int newTargetFPS);
 
+    // 0 only ever sleeps, which costs no CPU but leaves every frame at the mercy of the OS scheduler
+    void setSpinWindow(std::chrono::microseconds spinWindow);
+
+    // Over the last s_numPacingSamples frames that were delayed
+    FramePacingStats getPacingStats() const;
+
     uint32_t getFrameTimeMs() const;
 
     FrameInfo getFrameInfo() const;
@@ -44,9 +61,26 @@ private:
     using Microseconds = std::chrono::microseconds;
     Microseconds m_frameTimeMicroSec{};
     Microseconds m_targetFrameTimeMicroSec{};
+    Microseconds m_spinWindow{ s_defaultSpinWindow };
 
     using Milliseconds = std::chrono::milliseconds;
     using Seconds = std::chrono::seconds;
+
+    // A default constructed time point means the grid of deadlines starts again from the next delayed frame, e.g. after
+    // fast forwarding or changing the target FPS
+    Clock::time_point m_nextDeadline{};
+    Clock::time_point m_lastWakeTime{};
+
+    static constexpr std::size_t s_numPacingSamples{ 120 };
+    std::array<float, s_numPacingSamples> m_overshootSamplesMicroSec{};
+    std::array<float, s_numPacingSamples> m_intervalSamplesMicroSec{};
+    std::size_t m_numPacingSamples{ 0 };
+    std::size_t m_nextPacingSample{ 0 };
+
+    void updateActualFPS();
+    void waitUntil(Clock::time_point deadline) const;
+    void recordPacingSample(Clock::duration overshoot, Clock::duration interval);
+    void restartDeadlines();
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,57 @@
+#ifndef PCG32_H
+#define PCG32_H
+
+#include <bit>
+#include <cstdint>
+
+#include "utility.h"
+
+// PCG-XSH-RR (https://www.pcg-random.org): 64 bits of state, 32 bit outputs. Small and fast enough to sit inside every
+// Chip8, and the same seed always gives the same sequence, on any platform.
+// Only the one stream is used, so the whole generator is its 64 bit state.
+class Pcg32
+{
+public:
+    constexpr explicit Pcg32(const uint64_t initialSeed)
+    {
+        seed(initialSeed);
+    }
+
+    // Same seeding procedure as the reference implementation
+    constexpr void seed(const uint64_t newSeed)
+    {
+        m_state = 0;
+        next();
+        m_state += newSeed;
+        next();
+    }
+
+    constexpr uint32_t next()
+    {
+        const uint64_t oldState{ m_state };
+        m_state = oldState * s_multiplier + s_increment;
+
+        const uint32_t xorShifted{ static_cast<uint32_t>(((oldState >> 18) ^ oldState) >> 27) };
+        const int rotation{ static_cast<int>(oldState >> 59) };
+        return std::rotr(xorShifted, rotation);
+    }
+
+    // The high bits of a PCG output are the best ones
+    constexpr uint8_t nextByte()
+    {
+        return Utility::toU8(next() >> 24);
+    }
+
+    constexpr uint64_t getState() const { return m_state; }
+    constexpr void setState(const uint64_t state) { m_state = state; }
+
+    constexpr bool operator==(const Pcg32&) const = default;
+
+private:
+    static constexpr uint64_t s_multiplier{ 6364136223846793005u };
+    static constexpr uint64_t s_increment{ 1442695040888963407u };
+
+    uint64_t m_state{};
+};
+
+#endif
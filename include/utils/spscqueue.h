@@ -0,0 +1,71 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <optional>
+#include <utility>
+
+// Fixed size FIFO between one producer thread and one consumer thread. Neither side ever blocks or allocates: pushing to
+// a full queue and popping from an empty one just fail.
+// Each side keeps its own copy of the other side's position and only reloads the atomic when that copy says the queue is
+// full/empty, so most pushes and pops don't touch the other thread's cache line at all
+template <typename T, std::size_t Capacity>
+class SpscQueue
+{
+    static_assert(std::has_single_bit(Capacity), "Positions wrap with a mask, so Capacity has to be a power of 2");
+
+public:
+    // Producer side. Returns false, leaving value alone, if the queue is full
+    bool tryPush(T&& value)
+    {
+        const std::size_t tail{ m_tail.load(std::memory_order_relaxed) };
+        if (tail - m_producerCachedHead == Capacity)
+        {
+            m_producerCachedHead = m_head.load(std::memory_order_acquire);
+            if (tail - m_producerCachedHead == Capacity)
+            {
+                return false;
+            }
+        }
+
+        m_slots[tail & s_indexMask] = std::move(value);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side
+    std::optional<T> tryPop()
+    {
+        const std::size_t head{ m_head.load(std::memory_order_relaxed) };
+        if (head == m_consumerCachedTail)
+        {
+            m_consumerCachedTail = m_tail.load(std::memory_order_acquire);
+            if (head == m_consumerCachedTail)
+            {
+                return std::nullopt;
+            }
+        }
+
+        std::optional<T> value{ std::move(m_slots[head & s_indexMask]) };
+        m_head.store(head + 1, std::memory_order_release);
+        return value;
+    }
+
+private:
+    static constexpr std::size_t s_indexMask{ Capacity - 1 };
+    static constexpr std::size_t s_cacheLineSize{ 64 };
+
+    std::array<T, Capacity> m_slots{};
+
+    // Positions only ever go up, and are masked down to a slot when used
+    alignas(s_cacheLineSize) std::atomic<std::size_t> m_head{ 0 };
+    std::size_t m_consumerCachedTail{ 0 };
+
+    alignas(s_cacheLineSize) std::atomic<std::size_t> m_tail{ 0 };
+    std::size_t m_producerCachedHead{ 0 };
+};
+
+#endif
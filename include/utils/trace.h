@@ -0,0 +1,66 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+
+// Records a timeline of named scopes as Chrome trace event JSON, which chrome://tracing and Perfetto (ui.perfetto.dev)
+// can open, to see whether a slow frame went on emulation, ImGui or presenting. Scopes from every thread go into the
+// same timeline. While nothing is recording, a Scope costs one relaxed atomic load
+namespace Trace
+{
+    using Clock = std::chrono::steady_clock;
+
+    namespace Detail
+    {
+        inline std::atomic<bool> s_isRecording{ false };
+
+        void recordScope(const char* name, Clock::time_point start, Clock::time_point end);
+    }
+
+    inline bool isRecording()
+    {
+        return Detail::s_isRecording.load(std::memory_order_relaxed);
+    }
+
+    // Throws away anything recorded before
+    void startRecording();
+
+    // Writes everything recorded since startRecording() to path and returns how many scopes it wrote. Throws
+    // FileInputException if the file can't be written, after which the recording is gone either way
+    std::size_t stopRecording(const std::filesystem::path& path);
+
+    // What the calling thread is called in the timeline. Kept from one recording to the next
+    void setThreadName(std::string_view name);
+
+    // Times from construction to destruction. The name is kept as a pointer, so it should be a string literal
+    class Scope
+    {
+    public:
+        explicit Scope(const char* name)
+        : m_name{ isRecording() ? name : nullptr }
+        , m_start{ m_name ? Clock::now() : Clock::time_point{} }
+        {
+        }
+
+        ~Scope()
+        {
+            if (m_name)
+            {
+                Detail::recordScope(m_name, m_start, Clock::now());
+            }
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char* m_name;
+        Clock::time_point m_start;
+    };
+}
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "utility.h"
+
+// Hands the newest of a stream of values from one writer thread to one reader thread, without either of them ever
+// waiting on the other. The writer and the reader each own one of the three slots, and the third is swapped back and
+// forth between them through a single atomic. The reader always sees a whole value, and skips over any that the writer
+// replaced before it got round to looking.
+template <typename T>
+class TripleBuffer
+{
+public:
+    // Writer side. The slot still holds whatever was in it when it was last handed back, so write all of it
+    T& getWriteBuffer() { return m_slots[m_writeIndex]; }
+
+    void publish()
+    {
+        const uint8_t previousMiddle{ m_middle.exchange(Utility::toU8(m_writeIndex | s_freshBit), std::memory_order_acq_rel) };
+        m_writeIndex = previousMiddle & s_indexMask;
+    }
+
+    // Reader side. Returns false, leaving the read buffer as it was, if nothing was published since the last call
+    bool update()
+    {
+        if ((m_middle.load(std::memory_order_relaxed) & s_freshBit) == 0)
+        {
+            return false;
+        }
+
+        const uint8_t previousMiddle{ m_middle.exchange(m_readIndex, std::memory_order_acq_rel) };
+        m_readIndex = previousMiddle & s_indexMask;
+        return true;
+    }
+
+    const T& getReadBuffer() const { return m_slots[m_readIndex]; }
+
+private:
+    // Set in m_middle while it holds a value the reader hasn't taken yet
+    static constexpr uint8_t s_freshBit{ 0b100 };
+    static constexpr uint8_t s_indexMask{ 0b011 };
+
+    // Each side only touches its own index, and they sit on separate cache lines so that the two threads don't keep
+    // taking the same line off each other
+    static constexpr std::size_t s_cacheLineSize{ 64 };
+
+    std::array<T, 3> m_slots{};
+    alignas(s_cacheLineSize) uint8_t m_writeIndex{ 0 };
+    alignas(s_cacheLineSize) std::atomic<uint8_t> m_middle{ 1 };
+    alignas(s_cacheLineSize) uint8_t m_readIndex{ 2 };
+};
+
+#endif
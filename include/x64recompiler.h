@@ -0,0 +1,178 @@
+#ifndef X64_RECOMPILER_H
+#define X64_RECOMPILER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include "opcodedecoder.h"
+
+// Translates straight-line runs of CHIP-8 code into native x86-64 code, placed in mmap'd executable memory.
+//
+// V0-VF and I are kept in host registers for the whole of a block: loaded when it starts and stored back when it
+// leaves. The PC is never held anywhere, since it is known for every instruction while compiling. A block holds
+// everything but DXYN, FX0A, the stack, key skips, CXNN, 00E0 and BNNN, and stops *before* those so the caller can run
+// them on the interpreter. Skips and 1NNN end a block *after* themselves, and so do FX33 and FX55, which may have
+// written over code.
+//
+// FX33, FX55 and FX65 access memory directly when all of the access is inside it. When it isn't, the block leaves in
+// front of the instruction, so that the interpreter wraps it around or throws ChipOOBMemoryAccessException like it
+// always does. Nothing is ever thrown through compiled code.
+//
+// Compiled code is called as: BlockResult block(const MachineState* state)
+class X64Recompiler
+{
+public:
+    // Where compiled code finds the machine. Only valid for the duration of one call
+    struct MachineState
+    {
+        uint8_t* registers{ nullptr };
+        uint16_t* indexRegister{ nullptr };
+        uint8_t* memory{ nullptr };
+        uint8_t* delayTimer{ nullptr };
+        uint8_t* soundTimer{ nullptr };
+
+        // Called with owner after FX33 or FX55 wrote numBytes from firstAddress on. Must not throw
+        void (*notifyMemoryWritten)(void* owner, uint32_t firstAddress, uint32_t numBytes){ nullptr };
+        void* owner{ nullptr };
+
+        uint16_t fontsAddress{};
+    };
+
+    // Returned in eax. A block runs fewer than numInstructions if it left in front of a memory access it couldn't make
+    struct BlockResult
+    {
+        uint16_t nextPC{};
+        uint16_t numInstructionsExecuted{};
+    };
+
+    using BlockFunction = BlockResult (*)(const MachineState* state);
+
+    struct CompiledBlock
+    {
+        BlockFunction function{ nullptr };
+        uint16_t startAddress{};
+        uint16_t numInstructions{};
+
+        // The block is a single jump to itself, so running it again can never change anything
+        bool isIdleLoop{ false };
+    };
+
+    // The only quirks that change what the translated instructions do. Compiled code has them baked in
+    struct Quirks
+    {
+        bool resetVF{};
+        bool shift{};
+        bool index{};
+
+        bool operator==(const Quirks&) const = default;
+    };
+
+    // Whether this build can run compiled code at all (x86-64 with mmap available)
+    static bool isSupported();
+
+    explicit X64Recompiler(std::size_t memorySize);
+    ~X64Recompiler();
+
+    X64Recompiler(const X64Recompiler&) = delete;
+    X64Recompiler& operator=(const X64Recompiler&) = delete;
+    X64Recompiler(X64Recompiler&&) = delete;
+    X64Recompiler& operator=(X64Recompiler&&) = delete;
+
+    // Throws every compiled block away if quirks aren't the ones it was compiled with
+    void setQuirks(const Quirks& quirks)
+    {
+        if (quirks != m_compiledWithQuirks)
+        {
+            discardCompiledBlocks();
+            m_compiledWithQuirks = quirks;
+        }
+    }
+
+    // Returns nullptr if the instruction at address can't be compiled, in which case the caller has to interpret it.
+    // Addresses that can't be compiled are remembered, so the interpreter only pays for one lookup
+    const CompiledBlock* findOrCompile(const std::span<const uint8_t> memory, const uint16_t address)
+    {
+        if (address < m_blockIndexAtAddress.size())
+        {
+            const int32_t blockIndex{ m_blockIndexAtAddress[address] };
+            if (blockIndex >= 0)
+            {
+                return &m_blocks[Utility::toUZ(blockIndex)];
+            }
+            if (blockIndex == s_notCompilable)
+            {
+                return nullptr;
+            }
+        }
+
+        return compileAt(memory, address);
+    }
+
+    // Must be called for every write to memory. A write to compiled code throws every compiled block away, and the
+    // written byte is never compiled again, so code that rewrites itself stays on the interpreter from then on
+    void notifyMemoryWrite(const std::size_t address)
+    {
+        if (m_isCompiledByte[address])
+        {
+            m_isSelfModifiedByte[address] = true;
+            discardCompiledBlocks();
+        }
+    }
+
+    // For memory replaced by restoring a whole machine state rather than by the ROM itself. Compiled code for it is
+    // thrown away, and so are blocks that were cut short in front of it, since the byte can be compiled again: the state
+    // may well hold another ROM or an earlier version of this one
+    void notifyMemoryRestored(const std::size_t address)
+    {
+        if (m_isCompiledByte[address] || m_isSelfModifiedByte[address])
+        {
+            m_isSelfModifiedByte[address] = false;
+            discardCompiledBlocks();
+        }
+    }
+
+    void clear();
+
+private:
+    static constexpr std::size_t s_maxInstructionsPerBlock{ 64 };
+    static constexpr std::size_t s_codeArenaSize{ 1024 * 1024 };
+
+    static constexpr int32_t s_notCompiledYet{ -1 };
+    static constexpr int32_t s_notCompilable{ -2 };
+
+    // Nothing can be found any more, but the code stays in place until the next compileAt(): this can be called from
+    // compiled code, through MachineState::notifyMemoryWritten
+    void discardCompiledBlocks()
+    {
+        if (!m_flushPending)
+        {
+            std::ranges::fill(m_blockIndexAtAddress, s_notCompiledYet);
+            m_flushPending = true;
+        }
+    }
+
+    const CompiledBlock* compileAt(std::span<const uint8_t> memory, uint16_t address);
+    const CompiledBlock* compileBlock(std::span<const uint8_t> memory, uint16_t address);
+
+    // Copies the machine code into the executable arena, returns nullptr if it is full
+    BlockFunction installCode(const std::vector<uint8_t>& code);
+
+    uint8_t* m_codeArena{ nullptr };
+    std::size_t m_codeArenaUsed{ 0 };
+
+    std::vector<CompiledBlock> m_blocks{};
+
+    // Index into m_blocks of the block starting at each address, or one of s_notCompiledYet / s_notCompilable
+    std::vector<int32_t> m_blockIndexAtAddress{};
+
+    std::vector<bool> m_isCompiledByte{};
+    std::vector<bool> m_isSelfModifiedByte{};
+
+    Quirks m_compiledWithQuirks{};
+    bool m_flushPending{ false };
+};
+
+#endif
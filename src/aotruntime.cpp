@@ -0,0 +1,68 @@
+#include "aotprogram.h"
+
+#include <algorithm>
+
+namespace
+{
+    // Function local so that it exists before any generated translation unit registers with it
+    std::vector<AotProgram>& getRegisteredPrograms()
+    {
+        static std::vector<AotProgram> s_programs{};
+        return s_programs;
+    }
+}
+
+bool AotRegistry::registerProgram(const AotProgram& program)
+{
+    getRegisteredPrograms().push_back(program);
+    return true;
+}
+
+const AotProgram* AotRegistry::find(const std::span<const uint8_t> rom)
+{
+    for (const AotProgram& program : getRegisteredPrograms())
+    {
+        if (std::ranges::equal(program.rom, rom))
+        {
+            return &program;
+        }
+    }
+
+    return nullptr;
+}
+
+void AotRuntime::attach(const AotProgram* program, const std::size_t memorySize)
+{
+    m_program = program;
+    m_blockAtAddress.clear();
+    m_isCodeByte.clear();
+
+    if (m_program == nullptr)
+    {
+        return;
+    }
+
+    m_blockAtAddress.resize(memorySize, nullptr);
+    m_isCodeByte.resize(memorySize, false);
+
+    for (const AotBlock& block : m_program->blocks)
+    {
+        m_blockAtAddress[block.startAddress] = &block;
+
+        for (std::size_t address{ block.startAddress }; address < block.endAddress; ++address)
+        {
+            m_isCodeByte[address] = true;
+        }
+    }
+}
+
+void AotRuntime::invalidateBlocksContaining(const std::size_t address)
+{
+    for (const AotBlock& block : m_program->blocks)
+    {
+        if (block.startAddress <= address && address < block.endAddress)
+        {
+            m_blockAtAddress[block.startAddress] = nullptr;
+        }
+    }
+}
@@ -0,0 +1,293 @@
+#include "aottranslator.h"
+
+#include "chip8.h"
+#include "opcodedecoder.h"
+
+#include <algorithm>
+#include <format>
+#include <vector>
+
+namespace
+{
+    using OpcodeDecoder::Operation;
+    using OpcodeDecoder::DecodedOpcode;
+
+    constexpr uint16_t s_loadAddress{ Chip8::InitialConfig::programStartAddress };
+    constexpr std::size_t s_maxInstructionsPerBlock{ 64 };
+
+    struct TranslatedBlock
+    {
+        uint16_t startAddress{};
+        uint16_t endAddress{};
+        uint16_t maxInstructions{};
+        bool isIdleLoop{ false };
+        std::string body{};
+    };
+
+    std::string reg(const uint8_t regNum)
+    {
+        return std::format("V[0x{:X}]", regNum);
+    }
+
+    class Translator
+    {
+    public:
+        explicit Translator(const std::span<const uint8_t> rom)
+        : m_rom{ rom }
+        , m_isEntryPointQueued(Chip8::InitialConfig::bitsOfMemory, false)
+        {
+        }
+
+        std::vector<TranslatedBlock> translateReachableCode()
+        {
+            std::vector<TranslatedBlock> blocks{};
+
+            addEntryPoint(s_loadAddress);
+            while (!m_pendingEntryPoints.empty())
+            {
+                const uint16_t address{ m_pendingEntryPoints.back() };
+                m_pendingEntryPoints.pop_back();
+
+                TranslatedBlock block{ translateBlock(address) };
+                if (block.maxInstructions > 0)
+                {
+                    blocks.push_back(std::move(block));
+                }
+            }
+
+            std::ranges::sort(blocks, {}, &TranslatedBlock::startAddress);
+            return blocks;
+        }
+
+    private:
+        // Both bytes of the instruction have to come from the ROM
+        bool isInsideRom(const std::size_t address) const
+        {
+            return address >= s_loadAddress && address + 1 < s_loadAddress + m_rom.size();
+        }
+
+        void addEntryPoint(const std::size_t address)
+        {
+            if (isInsideRom(address) && !m_isEntryPointQueued[address])
+            {
+                m_isEntryPointQueued[address] = true;
+                m_pendingEntryPoints.push_back(Utility::toU16(address));
+            }
+        }
+
+        TranslatedBlock translateBlock(const uint16_t startAddress)
+        {
+            TranslatedBlock block{ .startAddress = startAddress };
+            std::string& body{ block.body };
+
+            uint16_t address{ startAddress };
+            uint16_t numInstructions{ 0 };
+            bool hasEnded{ false };
+
+            const auto addLine = [&body](const std::string& code, const uint16_t codeAddress, const uint16_t opcode) {
+                body += std::format("        {:<60} // 0x{:04X}: {:04X}\n", code, codeAddress, opcode);
+            };
+
+            const auto returnTo = [&numInstructions](const std::string& nextPC) {
+                return std::format("return {{ {}, {} }};", nextPC, numInstructions);
+            };
+
+            const auto execute = [](const uint16_t codeAddress, const uint16_t opcode) {
+                return std::format("ctx.execute(0x{:04X}, 0x{:04X});", codeAddress, opcode);
+            };
+
+            while (!hasEnded && numInstructions < s_maxInstructionsPerBlock && isInsideRom(address))
+            {
+                const uint16_t opcode{ Utility::toU16((m_rom[address - s_loadAddress] << 8) | m_rom[address - s_loadAddress + 1]) };
+                const DecodedOpcode instruction{ OpcodeDecoder::decode(opcode) };
+                const std::string vx{ reg(instruction.x) };
+                const std::string vy{ reg(instruction.y) };
+                const uint16_t nextAddress{ Utility::toU16(address + 2) };
+                const std::string skipTarget{ std::format("0x{:04X}", address + 4) };
+
+                ++numInstructions;
+
+                switch (instruction.operation)
+                {
+                case Operation::op6XNN:
+                    addLine(std::format("{} = 0x{:02X};", vx, instruction.nn), address, opcode);
+                    break;
+                case Operation::op7XNN:
+                    addLine(std::format("{0} = static_cast<uint8_t>({0} + 0x{1:02X});", vx, instruction.nn), address, opcode);
+                    break;
+                case Operation::op8XY0:
+                    addLine(std::format("{} = {};", vx, vy), address, opcode);
+                    break;
+                case Operation::op8XY1:
+                case Operation::op8XY2:
+                case Operation::op8XY3:
+                {
+                    const char* const bitwiseOperator{ instruction.operation == Operation::op8XY1 ? "|="
+                                                     : instruction.operation == Operation::op8XY2 ? "&=" : "^=" };
+                    addLine(std::format("{} {} {}; if (ctx.quirks().resetVF) {{ V[0xF] = 0; }}", vx, bitwiseOperator, vy),
+                        address, opcode);
+                    break;
+                }
+                case Operation::op8XY4:
+                    addLine(std::format("{{ const int sum{{ {0} + {1} }}; {0} = static_cast<uint8_t>(sum); V[0xF] = sum > 0xFF; }}",
+                        vx, vy), address, opcode);
+                    break;
+                case Operation::op8XY5:
+                case Operation::op8XY7:
+                {
+                    const bool isReversed{ instruction.operation == Operation::op8XY7 };
+                    const std::string& lhs{ isReversed ? vy : vx };
+                    const std::string& rhs{ isReversed ? vx : vy };
+                    addLine(std::format("{{ const bool noBorrow{{ {1} >= {2} }}; {0} = static_cast<uint8_t>({1} - {2}); V[0xF] = noBorrow; }}",
+                        vx, lhs, rhs), address, opcode);
+                    break;
+                }
+                case Operation::op8XY6:
+                    addLine(std::format("{{ const uint8_t value{{ ctx.quirks().shift ? {0} : {1} }}; {0} = static_cast<uint8_t>(value >> 1); V[0xF] = value & 0x01; }}",
+                        vx, vy), address, opcode);
+                    break;
+                case Operation::op8XYE:
+                    addLine(std::format("{{ const uint8_t value{{ ctx.quirks().shift ? {0} : {1} }}; {0} = static_cast<uint8_t>(value << 1); V[0xF] = value >> 7; }}",
+                        vx, vy), address, opcode);
+                    break;
+                case Operation::opANNN:
+                    addLine(std::format("ctx.indexRegister() = 0x{:03X};", instruction.nnn), address, opcode);
+                    break;
+                case Operation::opFX1E:
+                    addLine(std::format("ctx.indexRegister() = static_cast<uint16_t>(ctx.indexRegister() + {});", vx), address, opcode);
+                    break;
+                case Operation::opFX07:
+                    addLine(std::format("{} = ctx.delayTimer();", vx), address, opcode);
+                    break;
+                case Operation::opFX15:
+                    addLine(std::format("ctx.delayTimer() = {};", vx), address, opcode);
+                    break;
+                case Operation::opFX18:
+                    addLine(std::format("ctx.soundTimer() = {};", vx), address, opcode);
+                    break;
+
+                // A taken skip leaves the block, the instruction after the skipped one starts a block of its own
+                case Operation::op3XNN:
+                case Operation::op4XNN:
+                case Operation::op5XY0:
+                case Operation::op9XY0:
+                {
+                    const bool usesImmediate{ instruction.operation == Operation::op3XNN || instruction.operation == Operation::op4XNN };
+                    const bool skipsIfEqual{ instruction.operation == Operation::op3XNN || instruction.operation == Operation::op5XY0 };
+                    const std::string rhs{ usesImmediate ? std::format("0x{:02X}", instruction.nn) : vy };
+
+                    addLine(std::format("if ({} {} {}) {{ {} }}", vx, skipsIfEqual ? "==" : "!=", rhs, returnTo(skipTarget)),
+                        address, opcode);
+                    addEntryPoint(address + 4);
+                    break;
+                }
+
+                case Operation::op1NNN:
+                    addLine(returnTo(std::format("0x{:04X}", instruction.nnn)), address, opcode);
+                    block.isIdleLoop = numInstructions == 1 && instruction.nnn == startAddress;
+                    addEntryPoint(instruction.nnn);
+                    hasEnded = true;
+                    break;
+
+                // Handled by the interpreter, but don't affect the PC so the block carries on
+                case Operation::op00E0:
+                case Operation::opCXNN:
+                case Operation::opFX29:
+                case Operation::opFX65:
+                    addLine(execute(address, opcode), address, opcode);
+                    break;
+
+                // Handled by the interpreter, and either change the PC, write memory or have to be seen by the caller
+                case Operation::op2NNN:
+                    addEntryPoint(instruction.nnn);
+                    addEntryPoint(nextAddress);
+                    addLine(execute(address, opcode) + ' ' + returnTo("ctx.pc()"), address, opcode);
+                    hasEnded = true;
+                    break;
+                case Operation::opEX9E:
+                case Operation::opEXA1:
+                    addEntryPoint(address + 4);
+                    [[fallthrough]];
+                case Operation::opDXYN:
+                case Operation::opFX0A:
+                case Operation::opFX33:
+                case Operation::opFX55:
+                    addEntryPoint(nextAddress);
+                    addLine(execute(address, opcode) + ' ' + returnTo("ctx.pc()"), address, opcode);
+                    hasEnded = true;
+                    break;
+                default:
+                    // 00EE, BNNN and invalid opcodes. Where execution goes next is only known at runtime
+                    addLine(execute(address, opcode) + ' ' + returnTo("ctx.pc()"), address, opcode);
+                    hasEnded = true;
+                    break;
+                }
+
+                address = nextAddress;
+            }
+
+            if (!hasEnded)
+            {
+                // Ran into the end of the ROM or the block size limit
+                body += std::format("        {}\n", returnTo(std::format("0x{:04X}", address)));
+                addEntryPoint(address);
+            }
+
+            block.endAddress = address;
+            block.maxInstructions = numInstructions;
+            return block;
+        }
+
+        std::span<const uint8_t> m_rom{};
+
+        std::vector<bool> m_isEntryPointQueued{};
+        std::vector<uint16_t> m_pendingEntryPoints{};
+    };
+}
+
+std::string AotTranslator::translate(const std::span<const uint8_t> rom, const std::string_view romName)
+{
+    Translator translator{ rom };
+    const std::vector<TranslatedBlock> blocks{ translator.translateReachableCode() };
+
+    std::string source{};
+    source += std::format("// Generated by chip8_aot from {}. Do not edit, regenerate it instead\n\n", romName);
+    source += "#include \"aotcontext.h\"\n\n";
+    source += "#include <array>\n#include <cstdint>\n\n";
+    source += "namespace\n{\n";
+
+    source += std::format("    constexpr std::array<uint8_t, {}> s_rom{{\n", rom.size());
+    constexpr std::size_t bytesPerLine{ 16 };
+    for (std::size_t i{ 0 }; i < rom.size(); ++i)
+    {
+        source += i % bytesPerLine == 0 ? "        " : " ";
+        source += std::format("0x{:02X},", rom[i]);
+        if (i % bytesPerLine == bytesPerLine - 1 || i == rom.size() - 1)
+        {
+            source += '\n';
+        }
+    }
+    source += "    };\n\n";
+
+    for (const TranslatedBlock& block : blocks)
+    {
+        source += std::format("    AotBlockResult block{:04X}([[maybe_unused]] AotContext& ctx)\n    {{\n", block.startAddress);
+        source += "        [[maybe_unused]] auto& V{ ctx.registers() };\n";
+        source += block.body;
+        source += "    }\n\n";
+    }
+
+    source += std::format("    constexpr std::array<AotBlock, {}> s_blocks{{ {{\n", blocks.size());
+    for (const TranslatedBlock& block : blocks)
+    {
+        source += std::format("        {{ 0x{0:04X}, 0x{1:04X}, {2}, {3}, block{0:04X} }},\n",
+            block.startAddress, block.endAddress, block.maxInstructions, block.isIdleLoop);
+    }
+    source += "    } };\n\n";
+
+    source += std::format("    [[maybe_unused]] const bool s_isRegistered{{ AotRegistry::registerProgram(AotProgram{{ s_rom, 0x{:04X}, s_blocks }}) }};\n",
+        s_loadAddress);
+    source += "}\n";
+
+    return source;
+}
@@ -0,0 +1,112 @@
+#include "basicblockcache.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace
+{
+    using OpcodeDecoder::Operation;
+
+    // Swaps the first instruction of every sequence that has a superinstruction for it. See OpcodeDecoder::Operation
+    void fuseSuperinstructions(std::vector<OpcodeDecoder::DecodedOpcode>& instructions)
+    {
+        for (std::size_t i{ 0 }; i + 1 < instructions.size(); ++i)
+        {
+            OpcodeDecoder::DecodedOpcode& first{ instructions[i] };
+            const OpcodeDecoder::DecodedOpcode& second{ instructions[i + 1] };
+
+            if (first.operation == Operation::opANNN && second.operation == Operation::opDXYN)
+            {
+                first.operation = Operation::fusedANNNDXYN;
+            }
+            // Loop counters: increment a register, then check it against the end value
+            else if (first.operation == Operation::op7XNN && second.operation == Operation::op3XNN && first.x == second.x)
+            {
+                first.operation = Operation::fused7XNN3XNN;
+            }
+            // Waiting for the delay timer: read it, leave the loop once it hits the value, otherwise jump back
+            else if (first.operation == Operation::opFX07 && second.operation == Operation::op3XNN && first.x == second.x
+                && i + 2 < instructions.size() && instructions[i + 2].operation == Operation::op1NNN)
+            {
+                first.operation = Operation::fusedFX073XNN1NNN;
+            }
+        }
+    }
+}
+
+BasicBlockCache::BasicBlockCache(const std::size_t memorySize)
+: m_blockAtAddress(memorySize)
+, m_isCodeByte(memorySize, false)
+{
+}
+
+BasicBlockCache::Block BasicBlockCache::findOrBuildSlow(const std::span<const uint8_t> memory, const uint16_t address)
+{
+    if (m_flushPending)
+    {
+        clear();
+    }
+
+    if (address >= m_blockAtAddress.size())
+    {
+        return {};
+    }
+
+    return buildBlock(memory, address);
+}
+
+BasicBlockCache::Block BasicBlockCache::buildBlock(const std::span<const uint8_t> memory, const uint16_t address)
+{
+    std::vector<OpcodeDecoder::DecodedOpcode> instructions{};
+
+    std::size_t currAddress{ address };
+
+    // Both bytes of an instruction have to be inside memory, anything that wraps around is left to the interpreter
+    while (currAddress + 1 < memory.size() && instructions.size() < s_maxInstructionsPerBlock)
+    {
+        const uint16_t opcode{ Utility::toU16((memory[currAddress] << 8) | memory[currAddress + 1]) };
+        const OpcodeDecoder::DecodedOpcode& instruction{ OpcodeDecoder::lookup(opcode) };
+
+        instructions.push_back(instruction);
+        currAddress += 2;
+
+        if (OpcodeDecoder::endsBasicBlock(instruction.operation))
+        {
+            break;
+        }
+    }
+
+    if (instructions.empty())
+    {
+        return {};
+    }
+
+    if (m_isFusingSuperinstructions)
+    {
+        fuseSuperinstructions(instructions);
+    }
+
+    for (std::size_t codeAddress{ address }; codeAddress < currAddress; ++codeAddress)
+    {
+        m_isCodeByte[codeAddress] = true;
+    }
+
+    m_blocks.push_back(std::move(instructions));
+    m_blockAtAddress[address] = m_blocks.back();
+
+    return m_blockAtAddress[address];
+}
+
+void BasicBlockCache::clear()
+{
+    m_blocks.clear();
+    std::ranges::fill(m_blockAtAddress, Block{});
+    std::fill(m_isCodeByte.begin(), m_isCodeByte.end(), false);
+    m_flushPending = false;
+}
+
+void BasicBlockCache::setFusingSuperinstructions(const bool isFusing)
+{
+    m_isFusingSuperinstructions = isFusing;
+    clear();
+}
@@ -1,17 +1,29 @@
 #include "chip8.h"
+#include "aotcontext.h"
 
 #include "../include/exceptions/badopcodeexception.h"
 #include "../include/exceptions/fileinputexception.h"
 #include "../include/exceptions/chipstackerrorexception.h"
 
-#include "../include/utils/random.h"
-
 #include <ranges>
 #include <algorithm>
 #include <utility>
+#include <bit>
+#include <cstring>
+#include <random>
+
+namespace
+{
+    uint64_t generateRandomSeed()
+    {
+        std::random_device randomDevice{};
+        return (uint64_t{ randomDevice() } << 32) | randomDevice();
+    }
+}
 
 Chip8::Chip8(const QuirkFlags& quirks)
-: m_fontsLocation{ InitialConfig::fontsStartLocation }
+: m_random{ generateRandomSeed() }
+, m_fontsLocation{ InitialConfig::fontsStartLocation }
 , m_isQuirkEnabled{ quirks }
 , m_runtimeMetaData{}
 {
@@ -19,12 +31,38 @@ Chip8::Chip8(const QuirkFlags& quirks)
     loadFonts(m_fontsLocation);
 }
 
-const Chip8::Array2DU8<Chip8::InitialConfig::numPixelsVertically, Chip8::InitialConfig::numPixelsHorizontally>&
-    Chip8::getScreenBuffer() const
+const Chip8::ScreenBuffer& Chip8::getScreenBuffer() const
 {
     return m_screen;
 }
 
+bool Chip8::isPixelOn(const int x, const int y) const
+{
+    const uint64_t pixelMask{ uint64_t{ 1 } << (InitialConfig::numPixelsHorizontally - 1 - x) };
+    return (m_screen[Utility::toUZ(y)] & pixelMask) != 0;
+}
+
+Chip8::DebugView Chip8::getDebugView() const
+{
+    if (m_registers != m_registersAtLastDebugView || m_indexReg != m_indexRegAtLastDebugView)
+    {
+        ++m_debugGenerations.registers;
+        m_registersAtLastDebugView = m_registers;
+        m_indexRegAtLastDebugView = m_indexReg;
+    }
+
+    return DebugView{
+        .memory = m_memory,
+        .registers = m_registers,
+        .pc = m_pc,
+        .indexRegister = m_indexReg,
+        .delayTimer = m_delayTimer,
+        .soundTimer = m_soundTimer,
+        .stack = m_stack,
+        .generations = m_debugGenerations,
+    };
+}
+
 
 uint8_t Chip8::getDelayTimer() const { return m_delayTimer; }
 uint8_t Chip8::getSoundTimer() const { return m_soundTimer; }
@@ -43,16 +81,43 @@ bool Chip8::isRomLoaded() const { return m_runtimeMetaData.romIsLoaded; }
 
 int Chip8::getTargetNumInstrPerSecond() const { return m_targetNumInstrPerSecond; }
 
-std::array<uint8_t, 4096> Chip8::getMemoryContents() const { return m_memory; }
-std::array<uint8_t, 16> Chip8::getRegisterContents() const { return m_registers; }
 uint16_t Chip8::getPCAddress() const { return m_pc; }
 uint16_t Chip8::getIndexRegisterContents() const { return m_indexReg; }
-EnumArray<Chip8::KeyInputs, bool> Chip8::getKeysDownThisFrame() const { return m_keyDownThisFrame; };
 
 const std::vector<uint16_t>& Chip8::getStackContents() const { return m_stack; }
 
 void Chip8::setTargetNumInstrPerSecond(int newTarget) { m_targetNumInstrPerSecond = newTarget; }
 
+void Chip8::seedRandom(const uint64_t seed) { m_random.seed(seed); }
+
+Chip8::ExecutionEngine Chip8::getExecutionEngine() const { return m_executionEngine; }
+void Chip8::setExecutionEngine(const ExecutionEngine engine)
+{
+    if (engine == ExecutionEngine::jit)
+    {
+        if (!X64Recompiler::isSupported())
+        {
+            return;
+        }
+
+        if (!m_recompiler)
+        {
+            m_recompiler = std::make_unique<X64Recompiler>(InitialConfig::bitsOfMemory);
+        }
+    }
+
+    m_executionEngine = engine;
+}
+
+uint16_t Chip8::getOpcodeAt(const uint16_t address) const
+{
+    const uint16_t firstOpHalf{ m_memory[address % m_memory.size()] };
+    const uint16_t secondOpHalf{ m_memory[(address + 1u) % m_memory.size()] };
+    return Utility::toU16((firstOpHalf << 8) | secondOpHalf);
+}
+
+bool Chip8::hasAotProgram() const { return m_aotRuntime.getProgram() != nullptr; }
+
 
 void Chip8::handleInvalidOpcode(const uint16_t opcode)
 {
@@ -71,60 +136,185 @@ uint16_t Chip8::fetchOpcode()
     return opcode;
 }
 
+// The operation IDs are dense, so this switch becomes a single jump table
+void Chip8::executeDecodedOpcode(const DecodedOpcode instruction)
+{
+    using OpcodeDecoder::Operation;
+    switch (instruction.operation)
+    {
+    case Operation::op00E0:
+        executeOp00E0(instruction);
+        break;
+    case Operation::op00EE:
+        executeOp00EE(instruction);
+        break;
+    case Operation::op1NNN:
+        executeOp1NNN(instruction);
+        break;
+    case Operation::op2NNN:
+        executeOp2NNN(instruction);
+        break;
+    case Operation::op3XNN:
+        executeOp3XNN(instruction);
+        break;
+    case Operation::op4XNN:
+        executeOp4XNN(instruction);
+        break;
+    case Operation::op5XY0:
+        executeOp5XY0(instruction);
+        break;
+    case Operation::op6XNN:
+        executeOp6XNN(instruction);
+        break;
+    case Operation::op7XNN:
+        executeOp7XNN(instruction);
+        break;
+    case Operation::op8XY0:
+        executeOp8XY0(instruction);
+        break;
+    case Operation::op8XY1:
+        executeOp8XY1(instruction);
+        break;
+    case Operation::op8XY2:
+        executeOp8XY2(instruction);
+        break;
+    case Operation::op8XY3:
+        executeOp8XY3(instruction);
+        break;
+    case Operation::op8XY4:
+        executeOp8XY4(instruction);
+        break;
+    case Operation::op8XY5:
+        executeOp8XY5(instruction);
+        break;
+    case Operation::op8XY6:
+        executeOp8XY6(instruction);
+        break;
+    case Operation::op8XY7:
+        executeOp8XY7(instruction);
+        break;
+    case Operation::op8XYE:
+        executeOp8XYE(instruction);
+        break;
+    case Operation::op9XY0:
+        executeOp9XY0(instruction);
+        break;
+    case Operation::opANNN:
+        executeOpANNN(instruction);
+        break;
+    case Operation::opBNNN:
+        executeOpBNNN(instruction);
+        break;
+    case Operation::opCXNN:
+        executeOpCXNN(instruction);
+        break;
+    case Operation::opDXYN:
+        executeOpDXYN(instruction);
+        break;
+    case Operation::opEX9E:
+        executeOpEX9E(instruction);
+        break;
+    case Operation::opEXA1:
+        executeOpEXA1(instruction);
+        break;
+    case Operation::opFX07:
+        executeOpFX07(instruction);
+        break;
+    case Operation::opFX0A:
+        executeOpFX0A(instruction);
+        break;
+    case Operation::opFX15:
+        executeOpFX15(instruction);
+        break;
+    case Operation::opFX18:
+        executeOpFX18(instruction);
+        break;
+    case Operation::opFX1E:
+        executeOpFX1E(instruction);
+        break;
+    case Operation::opFX29:
+        executeOpFX29(instruction);
+        break;
+    case Operation::opFX33:
+        executeOpFX33(instruction);
+        break;
+    case Operation::opFX55:
+        executeOpFX55(instruction);
+        break;
+    case Operation::opFX65:
+        executeOpFX65(instruction);
+        break;
+    case Operation::fusedANNNDXYN:
+    case Operation::fused7XNN3XNN:
+    case Operation::fusedFX073XNN1NNN:
+        // On its own a superinstruction is just the first instruction of its sequence
+        executeDecodedOpcode(OpcodeDecoder::lookup(instruction.opcode));
+        break;
+    default:
+        handleInvalidOpcode(instruction.opcode);
+        break;
+    }
+}
+
 void Chip8::decodeAndExecute(const uint16_t opcode)
 {
+#ifdef CHIP8_USE_OPCODE_TABLE
+    executeDecodedOpcode(OpcodeDecoder::lookup(opcode));
+#else
+    const DecodedOpcode instruction{ OpcodeDecoder::extractOperands(opcode) };
+
     switch (opcode & 0xF000)
     {
     case 0x1000:
-        executeOp1NNN(opcode);
+        executeOp1NNN(instruction);
         break;
     case 0x2000:
-            executeOp2NNN(opcode);
+        executeOp2NNN(instruction);
         break;
     case 0x3000:
-        executeOp3XNN(opcode);
+        executeOp3XNN(instruction);
         break;
     case 0x4000:
-        executeOp4XNN(opcode);
+        executeOp4XNN(instruction);
         break;
     case 0x5000:
-        executeOp5XY0(opcode);
+        executeOp5XY0(instruction);
         break;
     case 0x6000:
-        executeOp6XNN(opcode);
+        executeOp6XNN(instruction);
         break;
     case 0x7000:
-        executeOp7XNN(opcode);
+        executeOp7XNN(instruction);
         break;
     case 0x8000:
         switch (opcode & 0x000F)
         {
         case 0x0000:
-            executeOp8XY0(opcode);
+            executeOp8XY0(instruction);
             break;
         case 0x0001:
-            executeOp8XY1(opcode);
+            executeOp8XY1(instruction);
             break;
         case 0x0002:
-            executeOp8XY2(opcode);
+            executeOp8XY2(instruction);
             break;
         case 0x0003:
-            executeOp8XY3(opcode);
+            executeOp8XY3(instruction);
             break;
         case 0x0004:
-            executeOp8XY4(opcode);
+            executeOp8XY4(instruction);
             break;
         case 0x0005:
-            executeOp8XY5(opcode);
+            executeOp8XY5(instruction);
             break;
         case 0x0006:
-            executeOp8XY6(opcode);
+            executeOp8XY6(instruction);
             break;
         case 0x0007:
-            executeOp8XY7(opcode);
+            executeOp8XY7(instruction);
             break;
         case 0x000E:
-            executeOp8XYE(opcode);
+            executeOp8XYE(instruction);
             break;
         default:
             handleInvalidOpcode(opcode);
@@ -132,29 +322,29 @@ void Chip8::decodeAndExecute(const uint16_t opcode)
         break;
 
     case 0x9000:
-        executeOp9XY0(opcode);
+        executeOp9XY0(instruction);
         break;
     case 0xA000:
-        executeOpANNN(opcode);
+        executeOpANNN(instruction);
         break;
     case 0xB000:
-        executeOpBNNN(opcode);
+        executeOpBNNN(instruction);
         break;
     case 0xC000:
-        executeOpCXNN(opcode);
+        executeOpCXNN(instruction);
         break;
     case 0xD000:
-        executeOpDXYN(opcode);
+        executeOpDXYN(instruction);
         break;
 
     case 0xE000:
         switch (opcode & 0x00FF)
         {
         case 0x009E:
-            executeOpEX9E(opcode);
+            executeOpEX9E(instruction);
             break;
         case 0x00A1:
-            executeOpEXA1(opcode);
+            executeOpEXA1(instruction);
             break;
         default:
             handleInvalidOpcode(opcode);
@@ -166,31 +356,31 @@ void Chip8::decodeAndExecute(const uint16_t opcode)
         switch (opcode & 0x00FF)
         {
         case 0x0007:
-            executeOpFX07(opcode);
+            executeOpFX07(instruction);
             break;
         case 0x000A:
-            executeOpFX0A(opcode);
+            executeOpFX0A(instruction);
             break;
         case 0x0015:
-            executeOpFX15(opcode);
+            executeOpFX15(instruction);
             break;
         case 0x0018:
-            executeOpFX18(opcode);
+            executeOpFX18(instruction);
             break;
         case 0x001E:
-            executeOpFX1E(opcode);
+            executeOpFX1E(instruction);
             break;
         case 0x0029:
-            executeOpFX29(opcode);
+            executeOpFX29(instruction);
             break;
         case 0x0033:
-            executeOpFX33(opcode);
+            executeOpFX33(instruction);
             break;
         case 0x0055:
-            executeOpFX55(opcode);
+            executeOpFX55(instruction);
             break;
         case 0x0065:
-            executeOpFX65(opcode);
+            executeOpFX65(instruction);
             break;
         default:
             handleInvalidOpcode(opcode);
@@ -202,10 +392,10 @@ void Chip8::decodeAndExecute(const uint16_t opcode)
         switch (opcode & 0x00FF)
         {
         case 0x00E0:
-            executeOp00E0();
+            executeOp00E0(instruction);
             break;
         case 0x00EE:
-            executeOp00EE();
+            executeOp00EE(instruction);
             break;
         default:
             handleInvalidOpcode(opcode);
@@ -218,6 +408,8 @@ void Chip8::decodeAndExecute(const uint16_t opcode)
         break;
     }
 
+#endif
+
     m_runtimeMetaData.numInstructionsExecuted += 1;
 }
 
@@ -269,11 +461,109 @@ void Chip8::performFDECycle()
     decodeAndExecute(opcode);
 }
 
+void Chip8::performProfiledFDECycle()
+{
+    const uint16_t address{ m_pc };
+    const std::size_t stackDepth{ m_stack.size() };
+    const uint16_t opcode{ fetchOpcode() };
+    m_profiler.record(address, OpcodeDecoder::lookup(opcode).operation);
+    decodeAndExecute(opcode);
+
+    // After a push the PC is at the start of the routine just called
+    if (m_stack.size() > stackDepth)
+    {
+        m_profiler.enterRoutine(m_pc);
+    }
+    else if (m_stack.size() < stackDepth)
+    {
+        m_profiler.leaveRoutine();
+    }
+}
+
+void Chip8::beginProfiledRun()
+{
+    // The stack only holds return addresses, so each routine comes from the 2NNN just before where it returns to
+    std::array<uint16_t, InitialConfig::maxStackDepth> routines{};
+    const std::size_t depth{ std::min(m_stack.size(), routines.size()) };
+    for (std::size_t i{ 0 }; i < depth; ++i)
+    {
+        const uint16_t callOpcode{ getOpcodeAt(Utility::toU16(m_stack[i] - 2)) };
+        routines[i] = (callOpcode & 0xF000) == 0x2000 ? Utility::toU16(callOpcode & 0x0FFF) : m_stack[i];
+    }
+
+    m_profiler.beginRun(std::span{ routines }.first(depth));
+}
+
 void Chip8::executeInstructions(int count)
+{
+    const bool isProfiling{ m_profiler.isRecordingNextRun() };
+    if (isProfiling)
+    {
+        beginProfiledRun();
+    }
+
+    if (m_hasBreakpoints && isProfiling)
+    {
+        executeInstructionsInterpreted<true, true>(count);
+        return;
+    }
+    if (m_hasBreakpoints)
+    {
+        executeInstructionsInterpreted<true, false>(count);
+        return;
+    }
+    if (isProfiling)
+    {
+        executeInstructionsInterpreted<false, true>(count);
+        return;
+    }
+
+    switch (m_executionEngine)
+    {
+    case ExecutionEngine::basicBlockCache:
+        executeInstructionsFromBlockCache(count);
+        break;
+    case ExecutionEngine::jit:
+        executeInstructionsWithRecompiler(count);
+        break;
+    case ExecutionEngine::aheadOfTime:
+        executeInstructionsFromAotProgram(count);
+        break;
+    default:
+        executeInstructionsInterpreted<false, false>(count);
+        break;
+    }
+}
+
+template <bool checkBreakpoints, bool recordProfile>
+void Chip8::executeInstructionsInterpreted(int count)
 {
     for (int i{ 0 } ; i < count ; ++i)
     {
-        performFDECycle();
+        if constexpr (checkBreakpoints)
+        {
+            if (shouldStopBeforeInstruction())
+            {
+                break;
+            }
+        }
+
+        if constexpr (recordProfile)
+        {
+            performProfiledFDECycle();
+        }
+        else
+        {
+            performFDECycle();
+        }
+
+        if constexpr (checkBreakpoints)
+        {
+            if (shouldStopAfterInstruction())
+            {
+                break;
+            }
+        }
 
         if (m_isQuirkEnabled.displayWait && executedDXYN())
         {
@@ -283,21 +573,631 @@ void Chip8::executeInstructions(int count)
     }
 }
 
+void Chip8::executeInstructionsFromBlockCache(int count)
+{
+    int numInstructionsLeft{ count };
+    while (numInstructionsLeft > 0)
+    {
+        numInstructionsLeft -= executeBasicBlocks(numInstructionsLeft);
+
+        if (m_isQuirkEnabled.displayWait && executedDXYN())
+        {
+            resetDXYNFlag();
+            break;
+        }
+
+        // No block could be built at the PC
+        if (numInstructionsLeft > 0)
+        {
+            performFDECycle();
+            --numInstructionsLeft;
+        }
+    }
+}
+
+/*
+Compiled blocks never contain a DXYN, FX0A, stack or key access, so all of those (and anything the recompiler couldn't
+translate) go through performFDECycle() one instruction at a time. So does a memory access that a block stopped in
+front of because it wraps around or is out of bounds.
+
+A block is only run if the whole of it fits into what is left of the budget, so instruction counts stay exact.
+*/
+void Chip8::executeInstructionsWithRecompiler(int count)
+{
+    m_recompiler->setQuirks({
+        .resetVF = m_isQuirkEnabled.resetVF,
+        .shift = m_isQuirkEnabled.shift,
+        .index = m_isQuirkEnabled.index,
+    });
+
+    const X64Recompiler::MachineState state{
+        .registers = m_registers.data(),
+        .indexRegister = &m_indexReg,
+        .memory = m_memory.data(),
+        .delayTimer = &m_delayTimer,
+        .soundTimer = &m_soundTimer,
+        .notifyMemoryWritten = &Chip8::notifyMemoryWrittenByCompiledCode,
+        .owner = this,
+        .fontsAddress = m_fontsLocation,
+    };
+
+    int numInstructionsLeft{ count };
+    while (numInstructionsLeft > 0)
+    {
+        const X64Recompiler::CompiledBlock* block{ m_recompiler->findOrCompile(m_memory, m_pc) };
+        if (block != nullptr && block->numInstructions <= numInstructionsLeft)
+        {
+            const X64Recompiler::BlockResult result{ block->function(&state) };
+            m_pc = result.nextPC;
+            m_runtimeMetaData.numInstructionsExecuted += result.numInstructionsExecuted;
+            numInstructionsLeft -= result.numInstructionsExecuted;
+
+            if (block->isIdleLoop)
+            {
+                m_runtimeMetaData.numInstructionsSkippedIdle += Utility::toUZ(numInstructionsLeft);
+                numInstructionsLeft = 0;
+            }
+
+            // Otherwise it stopped in front of a memory access it couldn't make, which is left to the interpreter
+            if (result.numInstructionsExecuted == block->numInstructions)
+            {
+                continue;
+            }
+        }
+
+        --numInstructionsLeft;
+        if (performFDECycleAndCheckForKeyWait())
+        {
+            m_runtimeMetaData.numInstructionsSkippedIdle += Utility::toUZ(numInstructionsLeft);
+            numInstructionsLeft = 0;
+        }
+
+        if (m_isQuirkEnabled.displayWait && executedDXYN())
+        {
+            resetDXYNFlag();
+            break;
+        }
+    }
+}
+
+void Chip8::notifyMemoryWrittenByCompiledCode(void* const chip, const uint32_t firstAddress, const uint32_t numBytes)
+{
+    Chip8& self{ *static_cast<Chip8*>(chip) };
+    for (std::size_t address{ firstAddress }; address < firstAddress + numBytes; ++address)
+    {
+        self.notifyMemoryWrite(address, self.m_memory[address]);
+    }
+}
+
+/*
+Same structure as executeInstructionsWithRecompiler(). A block leaves the machine in exactly the state the interpreter
+would have, it just skips fetching, decoding and dispatching each instruction.
+*/
+void Chip8::executeInstructionsFromAotProgram(int count)
+{
+    AotContext context{ *this };
+
+    int numInstructionsLeft{ count };
+    while (numInstructionsLeft > 0)
+    {
+        const AotBlock* block{ m_aotRuntime.findBlock(m_pc) };
+        if (block != nullptr && block->maxInstructions <= numInstructionsLeft)
+        {
+            const AotBlockResult result{ block->function(context) };
+            m_pc = result.nextPC;
+            m_runtimeMetaData.numInstructionsExecuted += result.numInstructionsExecuted;
+            numInstructionsLeft -= result.numInstructionsExecuted;
+
+            if (block->isIdleLoop)
+            {
+                m_runtimeMetaData.numInstructionsSkippedIdle += Utility::toUZ(numInstructionsLeft);
+                numInstructionsLeft = 0;
+            }
+        }
+        else
+        {
+            --numInstructionsLeft;
+            if (performFDECycleAndCheckForKeyWait())
+            {
+                m_runtimeMetaData.numInstructionsSkippedIdle += Utility::toUZ(numInstructionsLeft);
+                numInstructionsLeft = 0;
+            }
+        }
+
+        // DXYN always ends a block
+        if (m_isQuirkEnabled.displayWait && executedDXYN())
+        {
+            resetDXYNFlag();
+            break;
+        }
+    }
+}
+
+namespace
+{
+    struct MemoryAccess
+    {
+        uint16_t firstAddress{};
+        std::size_t length{ 0 };
+        bool isWrite{ false };
+    };
+
+    // Which bytes an instruction is about to read or write with I where it is now. Instruction fetches don't count
+    MemoryAccess findMemoryAccess(const OpcodeDecoder::DecodedOpcode& instruction, const uint16_t indexRegister)
+    {
+        using OpcodeDecoder::Operation;
+
+        switch (instruction.operation)
+        {
+        case Operation::opDXYN: return { indexRegister, instruction.n, false };
+        case Operation::opFX33: return { indexRegister, 3, true };
+        case Operation::opFX55: return { indexRegister, instruction.x + 1u, true };
+        case Operation::opFX65: return { indexRegister, instruction.x + 1u, false };
+        default:                return {};
+        }
+    }
+}
+
+void Chip8::setBreakpoints(const Breakpoints& breakpoints)
+{
+    m_breakpoints = breakpoints;
+    m_hasBreakpoints = !breakpoints.isEmpty();
+    m_resumeAddress.reset();
+
+    m_breakFlagsAtAddress.assign(m_hasBreakpoints ? m_memory.size() : 0, 0);
+    for (const uint16_t address : breakpoints.pcBreakpoints)
+    {
+        m_breakFlagsAtAddress[address % m_memory.size()] |= s_breakOnExecute;
+    }
+    for (const Breakpoints::Watchpoint& watchpoint : breakpoints.watchpoints)
+    {
+        uint8_t& flags{ m_breakFlagsAtAddress[watchpoint.address % m_memory.size()] };
+        flags |= watchpoint.onRead ? s_breakOnRead : uint8_t{ 0 };
+        flags |= watchpoint.onWrite ? s_breakOnWrite : uint8_t{ 0 };
+    }
+
+    // A condition that already holds when it is set doesn't stop anything until it stops holding and holds again
+    m_isRegisterConditionTrue.clear();
+    for (const Breakpoints::RegisterCondition& condition : breakpoints.registerConditions)
+    {
+        m_isRegisterConditionTrue.push_back(isRegisterConditionTrue(condition));
+    }
+}
+
+bool Chip8::shouldStopBeforeInstruction()
+{
+    const uint16_t pc{ m_pc };
+    if (std::exchange(m_resumeAddress, std::nullopt) == pc)
+    {
+        return false;
+    }
+
+    const auto stop{ [this, pc](const BreakHit::Reason reason, const uint16_t detail) {
+        m_breakHit = BreakHit{ .reason = reason, .pc = pc, .detail = detail };
+        m_resumeAddress = pc;
+        return true;
+    } };
+
+    if (m_breakFlagsAtAddress[pc % m_memory.size()] & s_breakOnExecute)
+    {
+        return stop(BreakHit::Reason::pcBreakpoint, pc);
+    }
+
+    const MemoryAccess access{ findMemoryAccess(OpcodeDecoder::lookup(getOpcodeAt(pc)), m_indexReg) };
+    const uint8_t watchedFlag{ access.isWrite ? s_breakOnWrite : s_breakOnRead };
+    for (std::size_t offset{ 0 }; offset < access.length; ++offset)
+    {
+        const std::size_t address{ (access.firstAddress + offset) % m_memory.size() };
+        if (m_breakFlagsAtAddress[address] & watchedFlag)
+        {
+            const BreakHit::Reason reason{ access.isWrite ? BreakHit::Reason::writeWatchpoint : BreakHit::Reason::readWatchpoint };
+            return stop(reason, Utility::toU16(address));
+        }
+    }
+
+    return false;
+}
+
+bool Chip8::shouldStopAfterInstruction()
+{
+    bool shouldStop{ false };
+    for (std::size_t i{ 0 }; i < m_breakpoints.registerConditions.size(); ++i)
+    {
+        const bool isTrue{ isRegisterConditionTrue(m_breakpoints.registerConditions[i]) };
+        if (isTrue && !m_isRegisterConditionTrue[i] && !shouldStop)
+        {
+            m_breakHit = BreakHit{ .reason = BreakHit::Reason::registerCondition, .pc = m_pc, .detail = Utility::toU16(i) };
+            shouldStop = true;
+        }
+        m_isRegisterConditionTrue[i] = isTrue;
+    }
+
+    return shouldStop;
+}
+
+bool Chip8::isRegisterConditionTrue(const Breakpoints::RegisterCondition& condition) const
+{
+    const uint8_t value{ m_registers[condition.registerIndex % m_registers.size()] };
+
+    switch (condition.comparison)
+    {
+    case Breakpoints::Comparison::equal:       return value == condition.value;
+    case Breakpoints::Comparison::notEqual:    return value != condition.value;
+    case Breakpoints::Comparison::lessThan:    return value < condition.value;
+    case Breakpoints::Comparison::greaterThan: return value > condition.value;
+    default:                                   return false;
+    }
+}
+
+bool Chip8::performFDECycleAndCheckForKeyWait()
+{
+    const uint16_t pcBeforeInstruction{ m_pc };
+    const uint16_t opcode{ fetchOpcode() };
+    decodeAndExecute(opcode);
+
+    // An FX0A that is still waiting for a key can't stop waiting until the next frame
+    return m_pc == pcBeforeInstruction && OpcodeDecoder::lookup(opcode).operation == OpcodeDecoder::Operation::opFX0A;
+}
+
+/*
+Goes straight from the end of one block into the next without returning, so the cost of moving between blocks is one
+lookup in the cache. That matters more than anything inside a block: ROMs spend most of their time in loops only a few
+instructions long.
+
+Each instruction updates the PC exactly like performFDECycle() would. The instruction count is only added up once at the
+end, or when a handler throws, so if one throws half way through a block the machine is still left in the same state
+the interpreter would have left it in.
+
+A block is cut short to what is left of the budget, which can't be less than the number of instructions it executes,
+so the budget only has to be checked once per block. Skips stay inside the block: if one is taken, the instruction after
+it is stepped over here rather than ending the block. A jump to itself or an FX0A that is still waiting, and a DXYN
+under the displayWait quirk, end the frame from their own handlers, so moving to the next block doesn't check for them.
+
+With GCC/Clang this uses threaded dispatch: every handler ends with its own indirect jump straight to the handler of the
+next instruction, instead of all instructions going back through one shared switch. Other compilers fall back to a loop
+over executeDecodedOpcode(), which runs each superinstruction as just the first instruction of its sequence.
+*/
+int Chip8::executeBasicBlocks(const int maxInstructions)
+{
+    const DecodedOpcode* instruction{ nullptr };
+    const DecodedOpcode* blockEnd{ nullptr };
+    int numExecuted{ 0 };
+    int numSkippedIdle{ 0 };
+
+    try
+    {
+#if defined(__GNUC__)
+        uint16_t pc{ m_pc };
+
+        static const void* const s_threadedHandlers[] {
+            &&threaded00E0,
+            &&threaded00EE,
+            &&threaded1NNN,
+            &&threaded2NNN,
+            &&threaded3XNN,
+            &&threaded4XNN,
+            &&threaded5XY0,
+            &&threaded6XNN,
+            &&threaded7XNN,
+            &&threaded8XY0,
+            &&threaded8XY1,
+            &&threaded8XY2,
+            &&threaded8XY3,
+            &&threaded8XY4,
+            &&threaded8XY5,
+            &&threaded8XY6,
+            &&threaded8XY7,
+            &&threaded8XYE,
+            &&threaded9XY0,
+            &&threadedANNN,
+            &&threadedBNNN,
+            &&threadedCXNN,
+            &&threadedDXYN,
+            &&threadedEX9E,
+            &&threadedEXA1,
+            &&threadedFX07,
+            &&threadedFX0A,
+            &&threadedFX15,
+            &&threadedFX18,
+            &&threadedFX1E,
+            &&threadedFX29,
+            &&threadedFX33,
+            &&threadedFX55,
+            &&threadedFX65,
+            &&threadedFusedANNNDXYN,
+            &&threadedFused7XNN3XNN,
+            &&threadedFusedFX073XNN1NNN,
+            &&threadedInvalid,
+        };
+        static_assert(std::size(s_threadedHandlers) == Utility::toUZ(OpcodeDecoder::Operation::MAX_VALUE));
+
+        goto blockFinished;
+
+// The PC is kept in pc and only ever written to m_pc, never read back, unless the instruction might have moved it.
+// Otherwise every instruction would have to wait for the previous one's write to m_pc to land
+#define CHIP8_DISPATCH_NEXT()                                                           \
+        if (instruction == blockEnd)                                                    \
+        {                                                                               \
+            goto blockFinished;                                                         \
+        }                                                                               \
+        pc += 2;                                                                        \
+        m_pc = pc;                                                                      \
+        goto *s_threadedHandlers[Utility::toUZ(instruction->operation)];
+
+#define CHIP8_THREADED_HANDLER(opName)                                                  \
+    threaded##opName:                                                                   \
+        executeOp##opName(*instruction);                                                \
+        ++numExecuted;                                                                  \
+        ++instruction;                                                                  \
+        CHIP8_DISPATCH_NEXT()
+
+#define CHIP8_THREADED_JUMP_HANDLER(opName)                                             \
+    threaded##opName:                                                                   \
+        executeOp##opName(*instruction);                                                \
+        pc = m_pc;                                                                      \
+        ++numExecuted;                                                                  \
+        ++instruction;                                                                  \
+        CHIP8_DISPATCH_NEXT()
+
+// Under the displayWait quirk, a frame ends with its first DXYN
+#define CHIP8_THREADED_DRAW_HANDLER(opName)                                             \
+    threaded##opName:                                                                   \
+        executeOp##opName(*instruction);                                                \
+        ++numExecuted;                                                                  \
+        if (executedDXYN())                                                             \
+        {                                                                               \
+            goto allBlocksFinished;                                                     \
+        }                                                                               \
+        ++instruction;                                                                  \
+        CHIP8_DISPATCH_NEXT()
+
+#define CHIP8_THREADED_SKIP_HANDLER(opName)                                             \
+    threaded##opName:                                                                   \
+        executeOp##opName(*instruction);                                                \
+        ++numExecuted;                                                                  \
+        ++instruction;                                                                  \
+        if (m_pc != pc)                                                                 \
+        {                                                                               \
+            pc = m_pc;                                                                  \
+            if (instruction != blockEnd)                                                \
+            {                                                                           \
+                ++instruction;                                                          \
+            }                                                                           \
+        }                                                                               \
+        CHIP8_DISPATCH_NEXT()
+
+    blockFinished:
+        if (numExecuted == maxInstructions)
+        {
+            goto allBlocksFinished;
+        }
+
+        {
+            const BasicBlockCache::Block block{ m_blockCache.findOrBuild(m_memory, pc) };
+            if (block.empty())
+            {
+                goto allBlocksFinished;
+            }
+            instruction = block.data();
+            blockEnd = instruction + std::min(block.size(), Utility::toUZ(maxInstructions - numExecuted));
+        }
+        CHIP8_DISPATCH_NEXT()
+
+        CHIP8_THREADED_HANDLER(00E0)
+        CHIP8_THREADED_JUMP_HANDLER(00EE)
+
+    threaded1NNN:
+        ++numExecuted;
+        if (instruction->nnn == pc - 2)
+        {
+            m_pc = instruction->nnn;
+            goto idleLoop;
+        }
+        pc = instruction->nnn;
+        m_pc = pc;
+        ++instruction;
+        CHIP8_DISPATCH_NEXT()
+
+        CHIP8_THREADED_JUMP_HANDLER(2NNN)
+        CHIP8_THREADED_SKIP_HANDLER(3XNN)
+        CHIP8_THREADED_SKIP_HANDLER(4XNN)
+        CHIP8_THREADED_SKIP_HANDLER(5XY0)
+        CHIP8_THREADED_HANDLER(6XNN)
+        CHIP8_THREADED_HANDLER(7XNN)
+        CHIP8_THREADED_HANDLER(8XY0)
+        CHIP8_THREADED_HANDLER(8XY1)
+        CHIP8_THREADED_HANDLER(8XY2)
+        CHIP8_THREADED_HANDLER(8XY3)
+        CHIP8_THREADED_HANDLER(8XY4)
+        CHIP8_THREADED_HANDLER(8XY5)
+        CHIP8_THREADED_HANDLER(8XY6)
+        CHIP8_THREADED_HANDLER(8XY7)
+        CHIP8_THREADED_HANDLER(8XYE)
+        CHIP8_THREADED_SKIP_HANDLER(9XY0)
+        CHIP8_THREADED_HANDLER(ANNN)
+        CHIP8_THREADED_JUMP_HANDLER(BNNN)
+        CHIP8_THREADED_HANDLER(CXNN)
+        CHIP8_THREADED_DRAW_HANDLER(DXYN)
+        CHIP8_THREADED_SKIP_HANDLER(EX9E)
+        CHIP8_THREADED_SKIP_HANDLER(EXA1)
+        CHIP8_THREADED_HANDLER(FX07)
+
+        // Moves the PC back onto itself for as long as it is waiting for a key
+    threadedFX0A:
+        executeOpFX0A(*instruction);
+        ++numExecuted;
+        if (m_pc != pc)
+        {
+            goto idleLoop;
+        }
+        ++instruction;
+        CHIP8_DISPATCH_NEXT()
+
+        CHIP8_THREADED_HANDLER(FX15)
+        CHIP8_THREADED_HANDLER(FX18)
+        CHIP8_THREADED_HANDLER(FX1E)
+        CHIP8_THREADED_HANDLER(FX29)
+        CHIP8_THREADED_HANDLER(FX33)
+        CHIP8_THREADED_HANDLER(FX55)
+        CHIP8_THREADED_HANDLER(FX65)
+
+        // The superinstructions (see OpcodeDecoder::Operation) are entered with the PC already moved past their first
+        // instruction, like any other handler. Each instruction of the sequence still moves the PC and counts as
+        // executed one at a time, all that is saved is the dispatch in between. If the block was cut short before the
+        // end of the sequence, only the first instruction is run
+    threadedFusedANNNDXYN:
+        if (blockEnd - instruction < 2)
+        {
+            goto threadedUnfused;
+        }
+        m_indexReg = instruction[0].nnn;
+        ++numExecuted;
+
+        pc += 2;
+        m_pc = pc;
+        executeOpDXYN(instruction[1]);
+        ++numExecuted;
+        if (executedDXYN())
+        {
+            goto allBlocksFinished;
+        }
+
+        instruction += 2;
+        CHIP8_DISPATCH_NEXT()
+
+    threadedFused7XNN3XNN:
+        if (blockEnd - instruction < 2)
+        {
+            goto threadedUnfused;
+        }
+        m_registers[instruction[0].x] += instruction[0].nn;
+
+        pc += 2;
+        m_pc = pc;
+        numExecuted += 2;
+        instruction += 2;
+
+        if (m_registers[instruction[-1].x] == instruction[-1].nn)
+        {
+            pc += 2;
+            m_pc = pc;
+            if (instruction != blockEnd)
+            {
+                ++instruction;
+            }
+        }
+        CHIP8_DISPATCH_NEXT()
+
+    threadedFusedFX073XNN1NNN:
+        if (blockEnd - instruction < 3)
+        {
+            goto threadedUnfused;
+        }
+        m_registers[instruction[0].x] = m_delayTimer;
+
+        if (m_registers[instruction[1].x] == instruction[1].nn)
+        {
+            // Skips the jump, which is the last instruction of the block
+            pc += 4;
+            numExecuted += 2;
+        }
+        else
+        {
+            pc = instruction[2].nnn;
+            numExecuted += 3;
+        }
+        m_pc = pc;
+
+        instruction += 3;
+        CHIP8_DISPATCH_NEXT()
+
+    threadedUnfused:
+        executeDecodedOpcode(OpcodeDecoder::lookup(instruction->opcode));
+        ++numExecuted;
+        ++instruction;
+        CHIP8_DISPATCH_NEXT()
+
+    threadedInvalid:
+        handleInvalidOpcode(instruction->opcode);
+
+        // Nothing can change until the next frame, so running the rest of the budget would just spin on the same
+        // instruction. Count those instructions as skipped rather than executing them
+    idleLoop:
+        numSkippedIdle = maxInstructions - numExecuted;
+        goto allBlocksFinished;
+
+#undef CHIP8_THREADED_SKIP_HANDLER
+#undef CHIP8_THREADED_DRAW_HANDLER
+#undef CHIP8_THREADED_JUMP_HANDLER
+#undef CHIP8_THREADED_HANDLER
+#undef CHIP8_DISPATCH_NEXT
+
+#else
+        while (numExecuted < maxInstructions && numSkippedIdle == 0 && !executedDXYN())
+        {
+            const BasicBlockCache::Block block{ m_blockCache.findOrBuild(m_memory, m_pc) };
+            if (block.empty())
+            {
+                break;
+            }
+            instruction = block.data();
+            blockEnd = instruction + std::min(block.size(), Utility::toUZ(maxInstructions - numExecuted));
+
+            while (instruction != blockEnd)
+            {
+                incrementPC();
+
+                const uint16_t pcBeforeExecution{ m_pc };
+                executeDecodedOpcode(*instruction);
+                ++numExecuted;
+
+                using OpcodeDecoder::Operation;
+                const Operation operation{ instruction->operation };
+                const bool isJumpToItself{ operation == Operation::op1NNN && m_pc == pcBeforeExecution - 2 };
+                const bool isWaitingForKey{ operation == Operation::opFX0A && m_pc != pcBeforeExecution };
+                if (isJumpToItself || isWaitingForKey)
+                {
+                    numSkippedIdle = maxInstructions - numExecuted;
+                    break;
+                }
+
+                const bool skipTaken{ OpcodeDecoder::isConditionalSkip(operation) && m_pc != pcBeforeExecution };
+                ++instruction;
+                if (skipTaken && instruction != blockEnd)
+                {
+                    ++instruction;
+                }
+            }
+        }
+#endif
+    }
+    catch (...)
+    {
+        m_runtimeMetaData.numInstructionsExecuted += Utility::toUZ(numExecuted);
+        throw;
+    }
+
+#if defined(__GNUC__)
+allBlocksFinished:
+#endif
+    m_runtimeMetaData.numInstructionsExecuted += Utility::toUZ(numExecuted);
+    m_runtimeMetaData.numInstructionsSkippedIdle += Utility::toUZ(numSkippedIdle);
+
+    return numExecuted + numSkippedIdle;
+}
+
 /*
     All opcodes in the order they are mentioned in:
     The wikipedia page: https://en.wikipedia.org/wiki/CHIP-8
     CG's reference: http://devernay.free.fr/hacks/chip8/C8TECH10.HTM
 */
-void Chip8::executeOp00E0()
+void Chip8::executeOp00E0(DecodedOpcode)
 {
-    const int valueForOffPixel{ 0 };
-    for (auto& row : m_screen)
-    {
-        std::ranges::fill(row, valueForOffPixel);
-    }
+    const uint64_t valueForOffRow{ 0 };
+    std::ranges::fill(m_screen, valueForOffRow);
 }
 
-void Chip8::executeOp00EE()
+void Chip8::executeOp00EE(DecodedOpcode)
 {
     if (std::size(m_stack) == 0)
     {
@@ -308,17 +1208,18 @@ void Chip8::executeOp00EE()
 
     m_pc = m_stack.back();
     m_stack.pop_back();
+    ++m_debugGenerations.stack;
 }
 
-void Chip8::executeOp1NNN(const uint16_t opcode)
+void Chip8::executeOp1NNN(const DecodedOpcode instruction)
 {
-    const uint16_t address{ extractNNN(opcode) };
+    const uint16_t address{ instruction.nnn };
     m_pc = address;
 }
 
-void Chip8::executeOp2NNN(const uint16_t opcode)
+void Chip8::executeOp2NNN(const DecodedOpcode instruction)
 {
-    const uint16_t address{ extractNNN(opcode) };
+    const uint16_t address{ instruction.nnn };
 
     if (std::size(m_stack) >= InitialConfig::maxStackDepth)
     {
@@ -328,13 +1229,14 @@ void Chip8::executeOp2NNN(const uint16_t opcode)
     }
 
     m_stack.push_back(m_pc);
+    ++m_debugGenerations.stack;
     m_pc = address;
 }
 
-void Chip8::executeOp3XNN(const uint16_t opcode)
+void Chip8::executeOp3XNN(const DecodedOpcode instruction)
 {
-    const uint16_t regNum{ extractX(opcode) };
-    const uint8_t valueToCompare{ Utility::toU8(extractNN(opcode)) };
+    const uint16_t regNum{ instruction.x };
+    const uint8_t valueToCompare{ instruction.nn };
 
     if (m_registers[regNum] == valueToCompare)
     {
@@ -342,10 +1244,10 @@ void Chip8::executeOp3XNN(const uint16_t opcode)
     }
 }
 
-void Chip8::executeOp4XNN(const uint16_t opcode)
+void Chip8::executeOp4XNN(const DecodedOpcode instruction)
 {
-    const uint16_t regNum{ extractX(opcode) };
-    const uint8_t valueToCompare{ Utility::toU8(extractNN(opcode)) };
+    const uint16_t regNum{ instruction.x };
+    const uint8_t valueToCompare{ instruction.nn };
 
     if (m_registers[regNum] != valueToCompare)
     {
@@ -353,10 +1255,10 @@ void Chip8::executeOp4XNN(const uint16_t opcode)
     }
 }
 
-void Chip8::executeOp5XY0(const uint16_t opcode)
+void Chip8::executeOp5XY0(const DecodedOpcode instruction)
 {
-    const  uint16_t regX{ extractX(opcode) };
-    const uint16_t regY{ extractY(opcode) };
+    const  uint16_t regX{ instruction.x };
+    const uint16_t regY{ instruction.y };
 
     if (m_registers[regX] == m_registers[regY])
     {
@@ -364,25 +1266,25 @@ void Chip8::executeOp5XY0(const uint16_t opcode)
     }
 }
 
-void Chip8::executeOp6XNN(const uint16_t opcode)
+void Chip8::executeOp6XNN(const DecodedOpcode instruction)
 {
-    const uint16_t regNum{ extractX(opcode) };
-    const uint8_t valueToPut{ Utility::toU8(extractNN(opcode)) };
+    const uint16_t regNum{ instruction.x };
+    const uint8_t valueToPut{ instruction.nn };
     m_registers[regNum] = valueToPut;
 }
 
-void Chip8::executeOp7XNN(const uint16_t opcode)
+void Chip8::executeOp7XNN(const DecodedOpcode instruction)
 {
-    const uint16_t regNum{ extractX(opcode) };
-    const uint8_t valueToAdd{ Utility::toU8(extractNN(opcode)) };
+    const uint16_t regNum{ instruction.x };
+    const uint8_t valueToAdd{ instruction.nn };
 
     m_registers[regNum] += valueToAdd;
 }
 
-void Chip8::executeOp8XY0(const uint16_t opcode)
+void Chip8::executeOp8XY0(const DecodedOpcode instruction)
 {
-    const uint16_t regX{ extractX(opcode) };
-    const uint16_t regY{ extractY(opcode) };
+    const uint16_t regX{ instruction.x };
+    const uint16_t regY{ instruction.y };
 
     m_registers[regX] = m_registers[regY];
 }
@@ -398,10 +1300,10 @@ Register VF is left untouched through the operation
 --With the quirk *enabled*:
 Register VF is always set to 0 at the end of the instruction
 */
-void Chip8::executeOp8XY1(const uint16_t opcode)
+void Chip8::executeOp8XY1(const DecodedOpcode instruction)
 {
-    const uint16_t regX{ extractX(opcode) };
-    const uint16_t regY{ extractY(opcode) };
+    const uint16_t regX{ instruction.x };
+    const uint16_t regY{ instruction.y };
 
     m_registers[regX] |= m_registers[regY];
 
@@ -411,10 +1313,10 @@ void Chip8::executeOp8XY1(const uint16_t opcode)
     }
 }
 
-void Chip8::executeOp8XY2(const uint16_t opcode)
+void Chip8::executeOp8XY2(const DecodedOpcode instruction)
 {
-    const uint16_t regX{ extractX(opcode) };
-    const uint16_t regY{ extractY(opcode) };
+    const uint16_t regX{ instruction.x };
+    const uint16_t regY{ instruction.y };
 
     m_registers[regX] &= m_registers[regY];
 
@@ -424,10 +1326,10 @@ void Chip8::executeOp8XY2(const uint16_t opcode)
     }
 }
 
-void Chip8::executeOp8XY3(const uint16_t opcode)
+void Chip8::executeOp8XY3(const DecodedOpcode instruction)
 {
-    const uint16_t regX{ extractX(opcode) };
-    const uint16_t regY{ extractY(opcode) };
+    const uint16_t regX{ instruction.x };
+    const uint16_t regY{ instruction.y };
 
     m_registers[regX] ^= m_registers[regY];
 
@@ -437,10 +1339,10 @@ void Chip8::executeOp8XY3(const uint16_t opcode)
     }
 }
 
-void Chip8::executeOp8XY4(const uint16_t opcode)
+void Chip8::executeOp8XY4(const DecodedOpcode instruction)
 {
-    const uint16_t regX{ extractX(opcode) };
-    const uint16_t regY{ extractY(opcode) };
+    const uint16_t regX{ instruction.x };
+    const uint16_t regY{ instruction.y };
 
     const uint16_t sum{ Utility::toU16(m_registers[regX] + m_registers[regY]) };
 
@@ -449,10 +1351,10 @@ void Chip8::executeOp8XY4(const uint16_t opcode)
     m_registers[0xF] = sum > 255;
 }
 
-void Chip8::executeOp8XY5(const uint16_t opcode)
+void Chip8::executeOp8XY5(const DecodedOpcode instruction)
 {
-    const uint16_t regX{ extractX(opcode) };
-    const uint16_t regY{ extractY(opcode) };
+    const uint16_t regX{ instruction.x };
+    const uint16_t regY{ instruction.y };
 
     const uint8_t subtractionResult{ Utility::toU8(m_registers[regX] - m_registers[regY]) };
 
@@ -476,13 +1378,13 @@ So we ignore Y entirely (In CHIP8 code, the assumption is usually that X == Y at
 Note: Register VF needs to be assigned to at the very end incase register VF happens to be register X. Otherwise, instead of storing whether or not overflow occured,
 it would store the result of the shift which is not intended.
 */
-void Chip8::executeOp8XY6(const uint16_t opcode)
+void Chip8::executeOp8XY6(const DecodedOpcode instruction)
 {
-    const uint16_t regX{ extractX(opcode) };
+    const uint16_t regX{ instruction.x };
 
     if (!m_isQuirkEnabled.shift)
     {
-        const uint16_t regY{ extractY(opcode) };
+        const uint16_t regY{ instruction.y };
         m_registers[regX] = m_registers[regY];
     }
 
@@ -492,10 +1394,10 @@ void Chip8::executeOp8XY6(const uint16_t opcode)
     m_registers[0xF] = bitShiftedOut;
 }
 
-void Chip8::executeOp8XY7(const uint16_t opcode)
+void Chip8::executeOp8XY7(const DecodedOpcode instruction)
 {
-    const uint16_t regX{ extractX(opcode) };
-    const uint16_t regY{ extractY(opcode) };
+    const uint16_t regX{ instruction.x };
+    const uint16_t regY{ instruction.y };
 
     const uint8_t subtractionResult{ Utility::toU8(m_registers[regY] - m_registers[regX]) };
 
@@ -519,13 +1421,13 @@ Note: Register VF needs to be assigned to at the very end incase register VF hap
 it would store the result of the shift which is not intended.
 */
 
-void Chip8::executeOp8XYE(const uint16_t opcode)
+void Chip8::executeOp8XYE(const DecodedOpcode instruction)
 {
-    const uint16_t regX{ extractX(opcode) };
+    const uint16_t regX{ instruction.x };
 
     if (!m_isQuirkEnabled.shift)
     {
-        const uint16_t regY{ extractY(opcode) };
+        const uint16_t regY{ instruction.y };
         m_registers[regX] = m_registers[regY];
     }
 
@@ -536,10 +1438,10 @@ void Chip8::executeOp8XYE(const uint16_t opcode)
     m_registers[0xF] = bitShiftedOut;
 }
 
-void Chip8::executeOp9XY0(const uint16_t opcode)
+void Chip8::executeOp9XY0(const DecodedOpcode instruction)
 {
-    const uint16_t regX{ extractX(opcode) };
-    const uint16_t regY{ extractY(opcode) };
+    const uint16_t regX{ instruction.x };
+    const uint16_t regY{ instruction.y };
 
     if (m_registers[regX] != m_registers[regY])
     {
@@ -547,9 +1449,9 @@ void Chip8::executeOp9XY0(const uint16_t opcode)
     }
 }
 
-void Chip8::executeOpANNN(const uint16_t opcode)
+void Chip8::executeOpANNN(const DecodedOpcode instruction)
 {
-    const uint16_t addressToSet{ extractNNN(opcode)};
+    const uint16_t addressToSet{ instruction.nnn};
 
     m_indexReg = addressToSet;
 }
@@ -565,28 +1467,28 @@ PC is set to the address NNN + register X, where X is the first nibble in NNN i.
                                                                           |
                                                                         this one
 */
-void Chip8::executeOpBNNN(const uint16_t opcode)
+void Chip8::executeOpBNNN(const DecodedOpcode instruction)
 {
     if (!m_isQuirkEnabled.jump)
     {
-        const uint16_t address{ extractNNN(opcode) };
+        const uint16_t address{ instruction.nnn };
         m_pc = Utility::toU16(address + m_registers[0x0]);
     }
     else
     {
-		const uint16_t regX{ extractX(opcode) };
-		const uint16_t address{ extractNNN(opcode) };
+		const uint16_t regX{ instruction.x };
+		const uint16_t address{ instruction.nnn };
 		m_pc = Utility::toU16(address + m_registers[regX]);
     }
 }
 
-void Chip8::executeOpCXNN(const uint16_t opcode)
+void Chip8::executeOpCXNN(const DecodedOpcode instruction)
 {
-    const uint16_t regX{ extractX(opcode) };
+    const uint16_t regX{ instruction.x };
 
-    const uint8_t valueToAnd{ Utility::toU8(extractNN(opcode)) };
+    const uint8_t valueToAnd{ instruction.nn };
 
-    const uint8_t randomByte{ Utility::toU8(Random::get(0, 255)) };
+    const uint8_t randomByte{ m_random.nextByte() };
 
     m_registers[regX] = Utility::toU8(randomByte & valueToAnd);
 }
@@ -613,64 +1515,71 @@ Do not alter the DXYN flag, as we dont need to remember if we did this instructi
 Set flag to true so that we can detect that we did a DXYN elsewhere in the code and act accordingly (stop doing further instructions, immediately render the next screen)
 */
 
-void Chip8::drawSprite(const uint8_t xCoord, const uint8_t yCoord, uint16_t spriteWidth, uint16_t spriteHeight, uint16_t currAddress)
+/*
+A sprite row is lined up with the screen row it lands on in one go: shifted into place when pixels past the right edge
+are clipped, rotated into place when they wrap around to the left edge. Checking for collisions is then a single AND, and
+drawing the row a single XOR.
+
+Every row of the sprite is read from memory even if it ends up off-screen, so out of bounds reads are still caught.
+*/
+void Chip8::drawSprite(const uint8_t xCoord, const uint8_t yCoord, const uint16_t spriteHeight, uint16_t currAddress)
 {
+    constexpr int spriteWidth{ 8 };
+    constexpr int shiftToLeftEdge{ InitialConfig::numPixelsHorizontally - spriteWidth };
+
     bool pixelWasTurnedOff{ false };
     for (std::size_t yOffset{ 0 }; yOffset < spriteHeight; ++yOffset)
     {
-        uint8_t nextByte{ readMemory(currAddress) };
+        const uint8_t nextByte{ readMemory(currAddress) };
         ++currAddress;
-        for (std::size_t xOffset{ 0 }; xOffset < spriteWidth; ++xOffset)
-        {
-            const uint8_t currBit{ Utility::toU8(nextByte >> (7 - xOffset) & 1) };
 
-            uint16_t nextPixelX{ Utility::toU16((xCoord + xOffset)) };
-            uint16_t nextPixelY{ Utility::toU16((yCoord + yOffset)) };
-
-            if (m_isQuirkEnabled.wrapScreen)
-            {
-                nextPixelX %= m_width;
-                nextPixelY %= m_height;
-            }
-
-            // Skip rendering off-screen pixels if screenwrap quirk is off
-            if (!m_isQuirkEnabled.wrapScreen && (nextPixelX > m_width - 1 || nextPixelY > m_height - 1))
-            {
-                break;
-            }
+        std::size_t nextPixelY{ yCoord + yOffset };
+        if (m_isQuirkEnabled.wrapScreen)
+        {
+            nextPixelY %= m_height;
+        }
+        else if (nextPixelY > m_height - 1u)
+        {
+            // Skip rendering off-screen rows if screenwrap quirk is off
+            continue;
+        }
 
-            if (currBit == 1 && m_screen[nextPixelY][nextPixelX] == 1)
-                pixelWasTurnedOff = true;
+        const uint64_t spriteRowAtLeftEdge{ uint64_t{ nextByte } << shiftToLeftEdge };
+        const uint64_t spriteRow{ m_isQuirkEnabled.wrapScreen ? std::rotr(spriteRowAtLeftEdge, xCoord)
+                                                              : spriteRowAtLeftEdge >> xCoord };
 
-            m_screen[nextPixelY][nextPixelX] ^= currBit;
+        if ((m_screen[nextPixelY] & spriteRow) != 0)
+        {
+            pixelWasTurnedOff = true;
         }
+
+        m_screen[nextPixelY] ^= spriteRow;
     }
     m_registers[0xF] = pixelWasTurnedOff;
 }
 
-void Chip8::executeOpDXYN(const uint16_t opcode)
+void Chip8::executeOpDXYN(const DecodedOpcode instruction)
 {
     if (m_isQuirkEnabled.displayWait)
     {
         m_executedDXYNFlag = true;
     }
-    const uint16_t registerX{ Utility::toU16(extractX(opcode)) };
-    const uint16_t registerY{ Utility::toU16(extractY(opcode)) };
+    const uint16_t registerX{ instruction.x };
+    const uint16_t registerY{ instruction.y };
 
     const uint8_t xCoord{ Utility::toU8(m_registers[registerX] % InitialConfig::numPixelsHorizontally) };
     const uint8_t yCoord{ Utility::toU8(m_registers[registerY] % InitialConfig::numPixelsVertically) };
 
-    uint16_t spriteWidth{ 8 };
-    uint16_t spriteHeight{ Utility::toU16(extractN(opcode)) };
+    uint16_t spriteHeight{ instruction.n };
 
     uint16_t currAddress{ m_indexReg };
 
-    drawSprite(xCoord, yCoord, spriteWidth, spriteHeight, currAddress);
+    drawSprite(xCoord, yCoord, spriteHeight, currAddress);
 }
 
-void Chip8::executeOpEX9E(const uint16_t opcode)
+void Chip8::executeOpEX9E(const DecodedOpcode instruction)
 {
-    const uint16_t regX{ extractX(opcode) };
+    const uint16_t regX{ instruction.x };
 
     const uint8_t keyToCheck{ m_registers[regX] };
     const uint8_t keyToCheckSanitised{ Utility::toU8(keyToCheck & 0x0F) };
@@ -682,9 +1591,9 @@ void Chip8::executeOpEX9E(const uint16_t opcode)
     }
 }
 
-void Chip8::executeOpEXA1(const uint16_t opcode)
+void Chip8::executeOpEXA1(const DecodedOpcode instruction)
 {
-    const uint16_t regX{ extractX(opcode) };
+    const uint16_t regX{ instruction.x };
 
     const uint8_t keyToCheck{ m_registers[regX] };
     const uint8_t keyToCheckSanitised{ Utility::toU8(keyToCheck & 0x0F) };
@@ -696,14 +1605,14 @@ void Chip8::executeOpEXA1(const uint16_t opcode)
     }
 }
 
-void Chip8::executeOpFX07(const uint16_t opcode)
+void Chip8::executeOpFX07(const DecodedOpcode instruction)
 {
-    const uint16_t regX{ extractX(opcode) };
+    const uint16_t regX{ instruction.x };
 
     m_registers[regX] = m_delayTimer;
 }
 
-void Chip8::executeOpFX0A(const uint16_t opcode)
+void Chip8::executeOpFX0A(const DecodedOpcode instruction)
 {
     if (!wasKeyReleasedThisFrame())
     {
@@ -711,36 +1620,36 @@ void Chip8::executeOpFX0A(const uint16_t opcode)
         return;
     }
 
-    const uint16_t regX{ extractX(opcode) };
+    const uint16_t regX{ instruction.x };
     const KeyInputs keyReleased{ findKeyReleasedThisFrame() };
 
     m_registers[regX] = Utility::toU8(std::to_underlying(keyReleased));
 }
 
-void Chip8::executeOpFX15(const uint16_t opcode)
+void Chip8::executeOpFX15(const DecodedOpcode instruction)
 {
-    uint16_t regX{ extractX(opcode) };
+    uint16_t regX{ instruction.x };
 
     m_delayTimer = m_registers[regX];
 }
 
-void Chip8::executeOpFX18(const uint16_t opcode)
+void Chip8::executeOpFX18(const DecodedOpcode instruction)
 {
-    const uint16_t regX{ extractX(opcode) };
+    const uint16_t regX{ instruction.x };
 
     m_soundTimer = m_registers[regX];
 }
 
-void Chip8::executeOpFX1E(const uint16_t opcode)
+void Chip8::executeOpFX1E(const DecodedOpcode instruction)
 {
-    const uint16_t regX{ extractX(opcode) };
+    const uint16_t regX{ instruction.x };
 
     m_indexReg += m_registers[regX];
 }
 
-void Chip8::executeOpFX29(const uint16_t opcode)
+void Chip8::executeOpFX29(const DecodedOpcode instruction)
 {
-    const uint16_t regX{ extractX(opcode) };
+    const uint16_t regX{ instruction.x };
 
     const uint16_t character{ m_registers[regX] };
     const uint16_t characterSanitised{ Utility::toU16(character & 0x000F) };
@@ -751,9 +1660,9 @@ void Chip8::executeOpFX29(const uint16_t opcode)
     m_indexReg = spriteLocation;
 }
 
-void Chip8::executeOpFX33(const uint16_t opcode)
+void Chip8::executeOpFX33(const DecodedOpcode instruction)
 {
-    const uint16_t regX{ extractX(opcode) };
+    const uint16_t regX{ instruction.x };
 
     const uint8_t hundredsDigit{ Utility::toU8((m_registers[regX] % 1000) / 100) };
     writeToMemory(m_indexReg, hundredsDigit);
@@ -774,9 +1683,9 @@ The index register is not affected during the instruction
 --With the quirk *enabled*:
 As we access/store information in a register, we increment the index register once for every register accessed/written to
 */
-void Chip8::executeOpFX55(const uint16_t opcode)
+void Chip8::executeOpFX55(const DecodedOpcode instruction)
 {
-    const uint16_t regX{ extractX(opcode) };
+    const uint16_t regX{ instruction.x };
 
     uint16_t currMemLocation{ m_indexReg };
 
@@ -792,9 +1701,9 @@ void Chip8::executeOpFX55(const uint16_t opcode)
     }
 }
 
-void Chip8::executeOpFX65(const uint16_t opcode)
+void Chip8::executeOpFX65(const DecodedOpcode instruction)
 {
-    const uint16_t regX{ extractX(opcode) };
+    const uint16_t regX{ instruction.x };
 
     uint16_t currMemLocation{ m_indexReg };
 
@@ -856,10 +1765,104 @@ void Chip8::loadFile(const std::string& name)
     m_runtimeMetaData.programEndAddress = currAddress - 1;
     m_runtimeMetaData.romIsLoaded = true;
 
+    if (currAddress <= m_memory.size())
+    {
+        const std::span<const uint8_t> rom{ m_memory.begin() + m_runtimeMetaData.programStartAddress, m_memory.begin() + currAddress };
+        m_aotRuntime.attach(AotRegistry::find(rom), m_memory.size());
+    }
+
     std::cout << "Done loading\n";
     ROM.close();
 }
 
+Chip8::SaveState Chip8::saveState() const
+{
+    SaveState state{
+        .memory = m_memory,
+        .registers = m_registers,
+        .pc = m_pc,
+        .indexRegister = m_indexReg,
+        .delayTimer = m_delayTimer,
+        .soundTimer = m_soundTimer,
+        .stack = {},
+        .stackDepth = Utility::toU8(m_stack.size()),
+        .screen = m_screen,
+        .keyDownThisFrame = m_keyDownThisFrame,
+        .keyDownLastFrame = m_keyDownLastFrame,
+        .quirks = m_isQuirkEnabled,
+        .randomState = m_random.getState(),
+        .executedDXYN = m_executedDXYNFlag,
+        .runtimeMetaData = m_runtimeMetaData,
+    };
+    std::ranges::copy(m_stack, state.stack.begin());
+
+    return state;
+}
+
+void Chip8::loadState(const SaveState& state)
+{
+    assert(state.stackDepth <= InitialConfig::maxStackDepth);
+
+    // Two states of the same ROM usually share almost all of their memory, so look for the chunks that differ with
+    // memcmp before going through them a byte at a time
+    constexpr std::size_t chunkSize{ 256 };
+    static_assert(InitialConfig::bitsOfMemory % chunkSize == 0);
+    if (std::memcmp(m_memory.data(), state.memory.data(), m_memory.size()) != 0)
+    {
+        for (std::size_t chunkStart{ 0 }; chunkStart < m_memory.size(); chunkStart += chunkSize)
+        {
+            if (std::memcmp(&m_memory[chunkStart], &state.memory[chunkStart], chunkSize) == 0)
+            {
+                continue;
+            }
+
+            for (std::size_t address{ chunkStart }; address < chunkStart + chunkSize; ++address)
+            {
+                if (m_memory[address] != state.memory[address])
+                {
+                    m_memory[address] = state.memory[address];
+                    notifyMemoryWrite(address, state.memory[address], true);
+                }
+            }
+        }
+    }
+
+    m_screen = state.screen;
+
+    m_registers = state.registers;
+    m_pc = state.pc;
+    m_indexReg = state.indexRegister;
+    m_delayTimer = state.delayTimer;
+    m_soundTimer = state.soundTimer;
+
+    // Capacity was reserved up front, so this never allocates
+    m_stack.assign(state.stack.begin(), state.stack.begin() + state.stackDepth);
+    ++m_debugGenerations.stack;
+
+    m_keyDownThisFrame = state.keyDownThisFrame;
+    m_keyDownLastFrame = state.keyDownLastFrame;
+    m_isQuirkEnabled = state.quirks;
+    m_random.setState(state.randomState);
+    m_executedDXYNFlag = state.executedDXYN;
+    m_runtimeMetaData = state.runtimeMetaData;
+}
+
+void Chip8::notifyMemoryWrite(const std::size_t address, const uint8_t value, const bool isRestore)
+{
+    ++m_debugGenerations.memoryRegions[address / DebugGenerations::memoryRegionSize];
+
+    m_blockCache.notifyMemoryWrite(address);
+    if (m_recompiler && isRestore)
+    {
+        m_recompiler->notifyMemoryRestored(address);
+    }
+    else if (m_recompiler)
+    {
+        m_recompiler->notifyMemoryWrite(address);
+    }
+    m_aotRuntime.notifyMemoryWrite(address, value);
+}
+
 void Chip8::setKeyDown(KeyInputs key)
 {
     m_keyDownThisFrame[key] = true;
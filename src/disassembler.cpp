@@ -0,0 +1,102 @@
+#include "disassembler.h"
+
+#include <format>
+#include <utility>
+
+namespace Disassembler
+{
+    namespace
+    {
+        template <class... Args>
+        Line formatLine(std::format_string<Args...> format, Args&&... args)
+        {
+            Line line{};
+            const auto result{ std::format_to_n(line.text.data(), Utility::toInt(line.text.size()), format,
+                                                std::forward<Args>(args)...) };
+            line.length = Utility::toUZ(result.out - line.text.data());
+            return line;
+        }
+    }
+
+    Line disassemble(const OpcodeDecoder::DecodedOpcode& instruction)
+    {
+        using OpcodeDecoder::Operation;
+
+        const uint8_t x{ instruction.x };
+        const uint8_t y{ instruction.y };
+
+        switch (instruction.operation)
+        {
+        case Operation::op00E0: return formatLine("CLS");
+        case Operation::op00EE: return formatLine("RET");
+        case Operation::op1NNN: return formatLine("JP 0x{:03X}", instruction.nnn);
+        case Operation::op2NNN: return formatLine("CALL 0x{:03X}", instruction.nnn);
+        case Operation::op3XNN: return formatLine("SE V{:X}, 0x{:02X}", x, instruction.nn);
+        case Operation::op4XNN: return formatLine("SNE V{:X}, 0x{:02X}", x, instruction.nn);
+        case Operation::op5XY0: return formatLine("SE V{:X}, V{:X}", x, y);
+        case Operation::op6XNN: return formatLine("LD V{:X}, 0x{:02X}", x, instruction.nn);
+        case Operation::op7XNN: return formatLine("ADD V{:X}, 0x{:02X}", x, instruction.nn);
+        case Operation::op8XY0: return formatLine("LD V{:X}, V{:X}", x, y);
+        case Operation::op8XY1: return formatLine("OR V{:X}, V{:X}", x, y);
+        case Operation::op8XY2: return formatLine("AND V{:X}, V{:X}", x, y);
+        case Operation::op8XY3: return formatLine("XOR V{:X}, V{:X}", x, y);
+        case Operation::op8XY4: return formatLine("ADD V{:X}, V{:X}", x, y);
+        case Operation::op8XY5: return formatLine("SUB V{:X}, V{:X}", x, y);
+        case Operation::op8XY6: return formatLine("SHR V{:X}, V{:X}", x, y);
+        case Operation::op8XY7: return formatLine("SUBN V{:X}, V{:X}", x, y);
+        case Operation::op8XYE: return formatLine("SHL V{:X}, V{:X}", x, y);
+        case Operation::op9XY0: return formatLine("SNE V{:X}, V{:X}", x, y);
+        case Operation::opANNN: return formatLine("LD I, 0x{:03X}", instruction.nnn);
+        case Operation::opBNNN: return formatLine("JP V0, 0x{:03X}", instruction.nnn);
+        case Operation::opCXNN: return formatLine("RND V{:X}, 0x{:02X}", x, instruction.nn);
+        case Operation::opDXYN: return formatLine("DRW V{:X}, V{:X}, {}", x, y, instruction.n);
+        case Operation::opEX9E: return formatLine("SKP V{:X}", x);
+        case Operation::opEXA1: return formatLine("SKNP V{:X}", x);
+        case Operation::opFX07: return formatLine("LD V{:X}, DT", x);
+        case Operation::opFX0A: return formatLine("LD V{:X}, K", x);
+        case Operation::opFX15: return formatLine("LD DT, V{:X}", x);
+        case Operation::opFX18: return formatLine("LD ST, V{:X}", x);
+        case Operation::opFX1E: return formatLine("ADD I, V{:X}", x);
+        case Operation::opFX29: return formatLine("LD F, V{:X}", x);
+        case Operation::opFX33: return formatLine("LD B, V{:X}", x);
+        case Operation::opFX55: return formatLine("LD [I], V{:X}", x);
+        case Operation::opFX65: return formatLine("LD V{:X}, [I]", x);
+
+        // Superinstructions only exist inside BasicBlockCache, never in memory
+        default:
+            return formatLine("DW 0x{:04X}", instruction.opcode);
+        }
+    }
+}
+
+DisassemblyCache::DisassemblyCache(const std::size_t memorySize)
+: m_entries(memorySize)
+{
+}
+
+std::string_view DisassemblyCache::disassembleAt(const std::span<const uint8_t> memory, const uint16_t address)
+{
+    const std::size_t wrappedAddress{ address % memory.size() };
+    const uint16_t opcode{ Utility::toU16((memory[wrappedAddress] << 8) | memory[(wrappedAddress + 1) % memory.size()]) };
+
+    if (wrappedAddress >= m_entries.size())
+    {
+        m_entries.resize(memory.size());
+    }
+
+    Entry& entry{ m_entries[wrappedAddress] };
+    if (!entry.isDisassembled || entry.opcode != opcode)
+    {
+        entry.opcode = opcode;
+        entry.isDisassembled = true;
+        entry.line = Disassembler::disassemble(opcode);
+        ++m_numDisassembled;
+    }
+
+    return entry.line.view();
+}
+
+std::size_t DisassemblyCache::takeNumDisassembled()
+{
+    return std::exchange(m_numDisassembled, 0);
+}
@@ -0,0 +1,636 @@
+#include "emulationthread.h"
+
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <variant>
+
+#include "exceptions/fileinputexception.h"
+#include "exceptions/badopcodeexception.h"
+#include "exceptions/chipstackerrorexception.h"
+#include "utils/trace.h"
+
+EmulationThread::EmulationThread(const int targetFPS, const std::size_t rewindCapacityInBytes)
+: m_targetFPS{ targetFPS }
+, m_frameTimer{ targetFPS }
+, m_rewindBuffer{ rewindCapacityInBytes }
+{
+    publishSnapshot();
+    m_thread = std::jthread{ [this](const std::stop_token stopToken) { run(stopToken); } };
+}
+
+void EmulationThread::rethrowIfFailed() const
+{
+    if (m_hasFailed.load(std::memory_order_acquire))
+    {
+        std::rethrow_exception(m_failure);
+    }
+}
+
+void EmulationThread::run(const std::stop_token stopToken)
+{
+    Trace::setThreadName("Emulation");
+
+    try
+    {
+        while (!stopToken.stop_requested())
+        {
+            const Trace::Scope traceScope{ "emulation frame" };
+            m_frameTimer.startFrameTiming();
+
+            const uint64_t totalInstrExecutedBeforeFrame{ m_chip->getRuntimeMetaData().numInstructionsExecuted };
+
+            processCommands();
+            handleSaveStateHotkeys();
+            handleMovieHotkeys();
+
+            int numFramesEmulated{ 0 };
+            if (m_chip->isRomLoaded())
+            {
+                handleEmulatorStateTransitions();
+                numFramesEmulated = emulateFramesUntilPublish();
+            }
+            m_systemKeysPressed = {};
+
+            // A ROM load or an error replaces the Chip8 partway through, and starts it counting from 0 again
+            const uint64_t totalInstrExecutedAfterFrame{ m_chip->getRuntimeMetaData().numInstructionsExecuted };
+            m_numInstrExecutedThisFrame = totalInstrExecutedAfterFrame >= totalInstrExecutedBeforeFrame
+                                        ? totalInstrExecutedAfterFrame - totalInstrExecutedBeforeFrame : 0;
+
+            publishSnapshot();
+            updateFrameTimingInfo(numFramesEmulated);
+        }
+
+        stopRecordingMovie();
+    }
+    catch (...)
+    {
+        m_failure = std::current_exception();
+        m_hasFailed.store(true, std::memory_order_release);
+    }
+}
+
+void EmulationThread::processCommands()
+{
+    while (std::optional<EmulatorCommand> command{ m_commands.tryPop() })
+    {
+        std::visit([this](const auto& typedCommand) { applyCommand(typedCommand); }, *command);
+    }
+}
+
+void EmulationThread::applyCommand(const EmulatorCommands::SetInputs& command)
+{
+    // A movie being played back decides the keys itself
+    if (!m_moviePlayer)
+    {
+        for (std::size_t key{ 0 }; key < command.chipKeysDown.size(); ++key)
+        {
+            if (command.chipKeysDown.data()[key])
+            {
+                m_chip->setKeyDown(static_cast<Chip8::KeyInputs>(key));
+            }
+            else
+            {
+                m_chip->setKeyUp(static_cast<Chip8::KeyInputs>(key));
+            }
+        }
+    }
+
+    for (std::size_t key{ 0 }; key < m_systemKeysPressed.size(); ++key)
+    {
+        m_systemKeysPressed.data()[key] = m_systemKeysPressed.data()[key] || command.systemKeysPressed.data()[key];
+    }
+
+    m_isRewindHeld = command.isRewindHeld;
+    m_isFastForwardHeld = command.isFastForwardHeld;
+}
+
+void EmulationThread::applyCommand(const EmulatorCommands::LoadRom& command)
+{
+    // The movie can't replay a different ROM, and the history of the old one is no use any more
+    stopRecordingMovie();
+    m_moviePlayer.reset();
+    m_rewindBuffer.clear();
+
+    const Chip8::ExecutionEngine engine{ m_chip->getExecutionEngine() };
+    resetChip();
+    m_chip->setExecutionEngine(engine);
+    try
+    {
+        m_chip->loadFile(command.path);
+    }
+    catch (const FileInputException& exception)
+    {
+        handleFileInputError(exception);
+    }
+}
+
+void EmulationThread::applyCommand(const EmulatorCommands::SetQuirks& command)
+{
+    m_chip->getEnabledQuirks() = command.quirks;
+}
+
+void EmulationThread::applyCommand(const EmulatorCommands::SetTargetNumInstrPerSecond& command)
+{
+    m_chip->setTargetNumInstrPerSecond(command.target);
+}
+
+void EmulationThread::applyCommand(const EmulatorCommands::SetExecutionEngine& command)
+{
+    m_chip->setExecutionEngine(command.engine);
+}
+
+void EmulationThread::applyCommand(const EmulatorCommands::SetTargetFPS& command)
+{
+    m_targetFPS = command.targetFPS;
+    m_frameTimer.setTargetFPS(command.targetFPS);
+}
+
+void EmulationThread::applyCommand(const EmulatorCommands::SetFrameSpinWindow& command)
+{
+    m_frameTimer.setSpinWindow(command.spinWindow);
+}
+
+void EmulationThread::applyCommand(const EmulatorCommands::SetRewindCapacity& command)
+{
+    m_rewindBuffer.setCapacity(command.capacityInBytes);
+}
+
+void EmulationThread::applyCommand(const EmulatorCommands::SelectSaveSlot& command)
+{
+    m_saveStateSlots.selectSlot(command.slot);
+}
+
+void EmulationThread::applyCommand(const EmulatorCommands::SaveToSlot& command)
+{
+    saveToSlot(command.slot);
+}
+
+void EmulationThread::applyCommand(const EmulatorCommands::LoadFromSlot& command)
+{
+    loadFromSlot(command.slot);
+}
+
+void EmulationThread::applyCommand(const EmulatorCommands::SetBreakpoints& command)
+{
+    m_breakpoints = command.breakpoints;
+    m_chip->setBreakpoints(m_breakpoints);
+}
+
+void EmulationThread::applyCommand(const EmulatorCommands::SetProfilerMode& command)
+{
+    m_profilerMode = command.mode;
+    m_chip->setProfilerMode(m_profilerMode);
+}
+
+void EmulationThread::applyCommand(const EmulatorCommands::ClearProfile&)
+{
+    m_chip->clearProfile();
+}
+
+void EmulationThread::applyCommand(const EmulatorCommands::ExportFoldedStacks&)
+{
+    const std::filesystem::path path{ s_foldedStacksPath };
+    std::error_code error{};
+    std::filesystem::create_directories(path.parent_path(), error);
+
+    std::ofstream file{ path };
+    m_chip->getProfiler().writeFoldedStacks(file);
+    file.close();
+
+    m_profileExportMessage = file ? std::format("Wrote {}", path.string())
+                                  : std::format("Couldn't write {}", path.string());
+}
+
+void EmulationThread::saveToSlot(const int slot)
+{
+    // Nothing to save until a ROM is running
+    if (!m_chip->isRomLoaded())
+    {
+        return;
+    }
+
+    try
+    {
+        m_saveStateSlots.save(slot, *m_chip);
+        m_saveStateErrorMessage.clear();
+    }
+    catch (const FileInputException& exception)
+    {
+        m_saveStateErrorMessage = exception.what();
+    }
+}
+
+void EmulationThread::loadFromSlot(const int slot)
+{
+    // A state can always be loaded, since it brings its ROM with it
+    if (m_saveStateSlots.load(slot, *m_chip))
+    {
+        // The movie can't replay a jump to another state
+        stopRecordingMovie();
+    }
+}
+
+void EmulationThread::handleSaveStateHotkeys()
+{
+    if (isSystemKeyPressed(InputHandler::SystemKeyInputs::K_PREVIOUS_SAVE_SLOT))
+    {
+        m_saveStateSlots.selectPreviousSlot();
+    }
+
+    if (isSystemKeyPressed(InputHandler::SystemKeyInputs::K_NEXT_SAVE_SLOT))
+    {
+        m_saveStateSlots.selectNextSlot();
+    }
+
+    const int selectedSlot{ m_saveStateSlots.getSelectedSlot() };
+    if (isSystemKeyPressed(InputHandler::SystemKeyInputs::K_SAVE_STATE))
+    {
+        saveToSlot(selectedSlot);
+    }
+
+    if (isSystemKeyPressed(InputHandler::SystemKeyInputs::K_LOAD_STATE))
+    {
+        loadFromSlot(selectedSlot);
+    }
+}
+
+void EmulationThread::handleMovieHotkeys()
+{
+    if (isSystemKeyPressed(InputHandler::SystemKeyInputs::K_TOGGLE_MOVIE_RECORDING))
+    {
+        if (m_movieBeingRecorded)
+        {
+            stopRecordingMovie();
+        }
+        else if (m_chip->isRomLoaded() && !m_moviePlayer)
+        {
+            m_movieBeingRecorded = InputMovie::startRecording(*m_chip, std::random_device{}());
+        }
+    }
+
+    if (isSystemKeyPressed(InputHandler::SystemKeyInputs::K_TOGGLE_MOVIE_PLAYBACK))
+    {
+        if (m_moviePlayer)
+        {
+            m_moviePlayer.reset();
+            return;
+        }
+
+        stopRecordingMovie();
+        try
+        {
+            m_moviePlayer.emplace(InputMovie::read(s_moviePath), *m_chip);
+        }
+        catch (const FileInputException& exception)
+        {
+            std::cerr << exception.what() << '\n';
+        }
+    }
+}
+
+void EmulationThread::stopRecordingMovie()
+{
+    if (!m_movieBeingRecorded)
+    {
+        return;
+    }
+
+    try
+    {
+        const std::filesystem::path moviePath{ s_moviePath };
+        std::error_code error{};
+        std::filesystem::create_directories(moviePath.parent_path(), error);
+        m_movieBeingRecorded->write(moviePath);
+    }
+    catch (const FileInputException& exception)
+    {
+        std::cerr << exception.what() << '\n';
+    }
+
+    m_movieBeingRecorded.reset();
+}
+
+void EmulationThread::handleEmulatorStateTransitions()
+{
+    const bool activateDebugPressed{ isSystemKeyPressed(InputHandler::SystemKeyInputs::K_ACTIVATE_DEBUG) };
+    if (activateDebugPressed)
+    {
+        m_stateManager.tryTransitionTo(StateManager::debug);
+    }
+
+    const bool deactivateDebugPressed{ isSystemKeyPressed(InputHandler::SystemKeyInputs::K_DEACTIVATE_DEBUG) };
+    if (deactivateDebugPressed)
+    {
+        m_stateManager.tryTransitionTo(StateManager::running);
+    }
+
+    const bool activateStepPressed{ isSystemKeyPressed(InputHandler::SystemKeyInputs::K_ACTIVATE_STEP) };
+    if (activateStepPressed)
+    {
+        m_stateManager.tryTransitionTo(StateManager::step);
+    }
+
+    const bool activateManualPressed{ isSystemKeyPressed(InputHandler::SystemKeyInputs::K_ACTIVATE_MANUAL) };
+    if (activateManualPressed)
+    {
+        m_stateManager.tryTransitionTo(StateManager::manual);
+    }
+
+    // Holding the fast forward key lasts until it's let go, the toggle lasts until it's pressed again
+    if (isSystemKeyPressed(InputHandler::SystemKeyInputs::K_TOGGLE_FAST_FORWARD))
+    {
+        m_isFastForwardToggledOn = !m_isFastForwardToggledOn;
+    }
+    if (m_stateManager.getCurrentState() == StateManager::debug)
+    {
+        m_isFastForwardToggledOn = false;
+    }
+
+    if (m_isFastForwardToggledOn || m_isFastForwardHeld)
+    {
+        m_stateManager.tryTransitionTo(StateManager::fastForward);
+    }
+    else if (m_stateManager.getCurrentState() == StateManager::fastForward)
+    {
+        m_stateManager.tryTransitionTo(StateManager::running);
+    }
+}
+
+int EmulationThread::emulateFramesUntilPublish()
+{
+    emulateFrame();
+    int numFramesEmulated{ 1 };
+
+    // The UI can't show frames any faster than the target FPS, so there's no point publishing them any faster either
+    const auto publishTime{ std::chrono::steady_clock::now() + std::chrono::microseconds{ 1'000'000 / m_targetFPS } };
+    while (m_stateManager.getCurrentState() == StateManager::fastForward && m_chip->isRomLoaded()
+           && std::chrono::steady_clock::now() < publishTime)
+    {
+        emulateFrame();
+        ++numFramesEmulated;
+    }
+
+    return numFramesEmulated;
+}
+
+void EmulationThread::emulateFrame()
+{
+    const Trace::Scope traceScope{ "emulateFrame" };
+
+    if (m_moviePlayer)
+    {
+        replayMovieFrame();
+        return;
+    }
+
+    // Only frames that run normally can be replayed exactly, so anything else ends the recording
+    if (m_movieBeingRecorded)
+    {
+        if (m_isRewindHeld || m_stateManager.getCurrentState() == StateManager::debug)
+        {
+            stopRecordingMovie();
+        }
+        else
+        {
+            m_movieBeingRecorded->recordFrame(*m_chip, calculateNumInstructionsNeededForFrame());
+        }
+    }
+
+    if (m_isRewindHeld)
+    {
+        rewindFrame();
+        return;
+    }
+
+    m_chip->decrementTimers();
+
+    executeChipInstructions();
+
+    m_chip->setPrevFrameInputs();
+
+    // Frames stepped through in debug mode aren't recorded, so the history doesn't fill up with copies of one frame.
+    // Neither is a Chip8 that was just reset by an error
+    if (m_stateManager.getCurrentState() != StateManager::debug && m_chip->isRomLoaded())
+    {
+        m_rewindBuffer.push(m_chip->saveState());
+    }
+}
+
+void EmulationThread::replayMovieFrame()
+{
+    try
+    {
+        m_moviePlayer->runFrame(*m_chip);
+    }
+    catch (const std::runtime_error& exception)
+    {
+        m_moviePlayer.reset();
+        handleOpcodeExecutionError(exception);
+        return;
+    }
+
+    m_rewindBuffer.push(m_chip->saveState());
+
+    // A frame cut short by a breakpoint puts the machine out of step with the movie, so playback can't carry on
+    if (handleBreakHit() || m_moviePlayer->isFinished())
+    {
+        m_moviePlayer.reset();
+    }
+}
+
+void EmulationThread::rewindFrame()
+{
+    Chip8::SaveState previousFrame{};
+    if (m_rewindBuffer.stepBack(previousFrame))
+    {
+        m_chip->loadState(previousFrame);
+    }
+}
+
+int EmulationThread::calculateNumInstructionsNeededForFrame()
+{
+    int targetNumInstrPerSecond{ m_chip->getTargetNumInstrPerSecond() };
+    if (targetNumInstrPerSecond <= 0)
+    {
+        return 0;
+    }
+    if (targetNumInstrPerSecond < m_targetFPS)
+    {
+        return 1;
+    }
+    return targetNumInstrPerSecond / m_targetFPS;
+}
+
+void EmulationThread::resetChip()
+{
+    m_chip = std::make_unique<Chip8>();
+    m_chip->setBreakpoints(m_breakpoints);
+    m_chip->setProfilerMode(m_profilerMode);
+    m_lastBreakHit.reset();
+}
+
+bool EmulationThread::handleBreakHit()
+{
+    std::optional<Chip8::BreakHit> hit{ m_chip->takeBreakHit() };
+    if (!hit)
+    {
+        return false;
+    }
+
+    m_stateManager.tryTransitionTo(StateManager::debug);
+    m_lastBreakHit = hit;
+    return true;
+}
+
+void EmulationThread::handleOpcodeExecutionError(const std::runtime_error& exception)
+{
+    resetChip();
+    m_rewindBuffer.clear();
+    m_currentErrorMessage = std::string(exception.what()) + " - Please fix any bugs present in the ROM or try a different ROM! "
+                                                            + "Make sure it is CHIP-8 compatible";
+}
+
+void EmulationThread::handleFileInputError(const FileInputException &exception)
+{
+    resetChip();
+    m_rewindBuffer.clear();
+    m_currentErrorMessage = std::string(exception.what()) + " Failed to load file. Please ensure it is not being"
+                                                            + "used by any other processes.";
+}
+
+void EmulationThread::executeChipInstructions()
+{
+    const Trace::Scope traceScope{ "executeChipInstructions" };
+
+    try
+    {
+        const StateManager::State currentState{ m_stateManager.getCurrentState() };
+        if (currentState == StateManager::State::running || currentState == StateManager::State::fastForward)
+        {
+            int numInstructionsToExecute { calculateNumInstructionsNeededForFrame() };
+            m_chip->executeInstructions(numInstructionsToExecute);
+            handleBreakHit();
+        }
+        else if (m_stateManager.getCurrentState() == StateManager::State::debug)
+        {
+            // Debug mode - Allows user to pause the program and step through it instruction by instruction or frame by frame. Inputs are still processed during this, so that the
+            // User can input things while debugging. Need to hold down the buttons while stepping for that input to be processed
+
+            if (m_stateManager.getCurrentDebugMode() != StateManager::DebugMode::step
+                && isSystemKeyPressed(InputHandler::SystemKeyInputs::K_ACTIVATE_STEP))
+            {
+                m_stateManager.tryTransitionTo(StateManager::DebugMode::step);
+            }
+
+            if (m_stateManager.getCurrentDebugMode() != StateManager::DebugMode::manual
+                && isSystemKeyPressed(InputHandler::SystemKeyInputs::K_ACTIVATE_MANUAL))
+            {
+                m_stateManager.tryTransitionTo(StateManager::DebugMode::manual);
+            }
+
+            if (m_stateManager.getCurrentDebugMode() == StateManager::step
+                && isSystemKeyPressed(InputHandler::SystemKeyInputs::K_NEXT_FRAME))
+            {
+                int numInstructionsToExecute{ calculateNumInstructionsNeededForFrame() };
+                m_chip->executeInstructions(numInstructionsToExecute);
+                handleBreakHit();
+            }
+
+            if (m_stateManager.getCurrentDebugMode() == StateManager::manual
+                && isSystemKeyPressed(InputHandler::SystemKeyInputs::K_NEXT_INSTRUCTION))
+            {
+                m_chip->performFDECycle();
+            }
+        }
+    }
+    catch (const BadOpcodeException& exception)
+    {
+        handleOpcodeExecutionError(exception);
+    }
+    catch (const ChipStackErrorException& exception)
+    {
+        handleOpcodeExecutionError(exception);
+    }
+    catch (const ChipOOBMemoryAccessException& exception)
+    {
+        handleOpcodeExecutionError(exception);
+    }
+}
+
+void EmulationThread::publishSnapshot()
+{
+    const Trace::Scope traceScope{ "publishSnapshot" };
+
+    // Every field is written each time, since the slot still holds a snapshot from a couple of frames ago
+    EmulatorSnapshot& snapshot{ m_snapshots.getWriteBuffer() };
+
+    snapshot.chip = m_chip->saveState();
+    snapshot.debugGenerations = m_chip->getDebugView().generations;
+    snapshot.targetNumInstrPerSecond = m_chip->getTargetNumInstrPerSecond();
+    snapshot.executionEngine = m_chip->getExecutionEngine();
+    snapshot.hasAotProgram = m_chip->hasAotProgram();
+
+    snapshot.stateManager = m_stateManager;
+
+    snapshot.isRecordingMovie = m_movieBeingRecorded.has_value();
+    snapshot.isPlayingMovie = m_moviePlayer.has_value();
+
+    snapshot.selectedSaveSlot = m_saveStateSlots.getSelectedSlot();
+    for (int slot{ 0 }; slot < SaveStateSlots::s_numSlots; ++slot)
+    {
+        snapshot.isSaveSlotOccupied[Utility::toUZ(slot)] = m_saveStateSlots.isOccupied(slot);
+    }
+    snapshot.saveStateErrorMessage = m_saveStateErrorMessage;
+
+    snapshot.numRewindFrames = m_rewindBuffer.getNumFrames();
+    snapshot.rewindBytesUsed = m_rewindBuffer.getUsedBytes();
+
+    snapshot.numInstructionsExecuted = m_numInstrExecutedThisFrame;
+    snapshot.speedMultiplier = m_speedMultiplier;
+    snapshot.framePacing = m_frameTimer.getPacingStats();
+
+    snapshot.lastBreakHit = m_lastBreakHit;
+
+    const ExecutionProfiler& profiler{ m_chip->getProfiler() };
+    snapshot.profilerMode = profiler.getMode();
+    snapshot.profileTotalHits = profiler.getTotalHits();
+    snapshot.profileHitsPerOperation = profiler.getHitsPerOperation();
+    if (profiler.getTotalHits() == 0)
+    {
+        snapshot.profileHitsAtAddress.clear();
+    }
+    else
+    {
+        // Keeps the slot's capacity, so only the first copy allocates
+        snapshot.profileHitsAtAddress.assign(profiler.getHitsAtAddress().begin(), profiler.getHitsAtAddress().end());
+    }
+    profiler.getRoutineProfiles(snapshot.profileRoutines);
+    snapshot.profileExportMessage = m_profileExportMessage;
+
+    snapshot.errorMessage = m_currentErrorMessage;
+
+    m_snapshots.publish();
+}
+
+void EmulationThread::updateFrameTimingInfo(const int numFramesEmulated)
+{
+    m_frameTimer.endFrameTiming();
+    if (m_stateManager.getCurrentState() == StateManager::fastForward)
+    {
+        m_frameTimer.finishFrameWithoutDelay();
+    }
+    else
+    {
+        m_frameTimer.delayToReachTargetFrameTime();
+    }
+
+    // Smoothed, since how many frames fit in before publishing varies from one frame to the next
+    const float emulatedFPS{ m_frameTimer.getActualFPS() * static_cast<float>(numFramesEmulated) };
+    const float speedMultiplier{ emulatedFPS / static_cast<float>(m_targetFPS) };
+    constexpr float smoothingFactor{ 0.1f };
+    m_speedMultiplier += (speedMultiplier - m_speedMultiplier) * smoothingFactor;
+}
@@ -4,6 +4,7 @@
 #include "imguirenderer.h"
 #include "../include/types/displaysettings.h"
 #include "../include/utils/frametimer.h"
+#include "../include/utils/trace.h"
 #include "chip8.h"
 #include "audioplayer.h"
 #include "inputhandler.h"
@@ -12,17 +13,36 @@
 #include "../include/types/frameinfo.h"
 
 #include "../include/exceptions/sdlinitexception.h"
-#include "../include/exceptions/fileinputexception.h"
-#include "../include/exceptions/badopcodeexception.h"
-#include "exceptions/chipstackerrorexception.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+    std::size_t megabytesToBytes(const int megabytes)
+    {
+        return Utility::toUZ(megabytes) * 1024 * 1024;
+    }
+
+    // Bit y is set when row y differs. The UI thread only sees the snapshots it gets round to drawing, so comparing with
+    // what it drew last catches every change no matter how many emulated frames, rewinds or ROM loads came in between
+    uint32_t findChangedRows(const Chip8::ScreenBuffer& previousScreen, const Chip8::ScreenBuffer& screen)
+    {
+        uint32_t changedRows{ 0 };
+        for (std::size_t row{ 0 }; row < screen.size(); ++row)
+        {
+            if (screen[row] != previousScreen[row])
+            {
+                changedRows |= uint32_t{ 1 } << row;
+            }
+        }
+        return changedRows;
+    }
+}
 
 Emulator::Emulator()
-: m_chip{ std::make_unique<Chip8>() }
-, m_stateManager{}
-, m_displaySettings{ std::make_shared<DisplaySettings>() }
+: m_displaySettings{ std::make_shared<DisplaySettings>() }
 , m_isRunning{ true }
-, m_numInstrExecutedThisFrame{ 0 }
-, m_currentErrorMessage{ "No ROM loaded. Open menu to load ROM." }
 {
     initialiseMainRenderer();
     initialiseGUIRenderer();
@@ -30,7 +50,15 @@ Emulator::Emulator()
     m_inputHandler = InputHandler();
     m_audioPlayer = std::make_unique<AudioPlayer>("assets/beep.wav");
 
-    m_frameTimer = FrameTimer(m_displaySettings->targetFPS);
+    const std::chrono::microseconds spinWindow{ m_displaySettings->frameSpinWindowMicroSec };
+    m_frameTimer = FrameTimer(calculatePresentRate());
+    m_frameTimer.setSpinWindow(spinWindow);
+
+    m_emulationThread = std::make_unique<EmulationThread>(
+        m_displaySettings->targetFPS,
+        megabytesToBytes(m_displaySettings->rewindMemoryLimitMB)
+    );
+    m_pendingCommands.emplace_back(EmulatorCommands::SetFrameSpinWindow{ spinWindow });
 }
 
 Emulator::~Emulator() = default;
@@ -53,16 +81,10 @@ void Emulator::initialiseGUIRenderer()
 
 void Emulator::processInputs()
 {
-    m_inputHandler.resetSystemKeysState();
+    const Trace::Scope traceScope{ "processInputs" };
 
-    if (m_chip->isRomLoaded())
-    {
-        m_inputHandler.readChipAndSystemInputs(*m_chip);
-    }
-    else
-    {
-        m_inputHandler.readSystemInputs();
-    }
+    m_inputHandler.resetSystemKeysState();
+    m_inputHandler.readInputs();
 
     if (m_inputHandler.isSystemKeyPressed(InputHandler::SystemKeyInputs::K_QUIT))
     {
@@ -73,160 +95,77 @@ void Emulator::processInputs()
     {
         m_displaySettings->showDebugWindows = !(m_displaySettings->showDebugWindows);
     }
-}
 
-void Emulator::handleEmulatorStateTransitions()
-{
-    const bool activateDebugPressed{ m_inputHandler.isSystemKeyPressed(InputHandler::SystemKeyInputs::K_ACTIVATE_DEBUG) };
-    if (activateDebugPressed)
-    {
-        m_stateManager.tryTransitionTo(StateManager::debug);
-    }
-
-    const bool deactivateDebugPressed{ m_inputHandler.isSystemKeyPressed(InputHandler::SystemKeyInputs::K_DEACTIVATE_DEBUG) };
-    if (deactivateDebugPressed)
-    {
-        m_stateManager.tryTransitionTo(StateManager::running);
-    }
-
-    const bool activateStepPressed{ m_inputHandler.isSystemKeyPressed(InputHandler::SystemKeyInputs::K_ACTIVATE_STEP) };
-    if (activateStepPressed)
-    {
-        m_stateManager.tryTransitionTo(StateManager::step);
-    }
+    const EmulatorCommands::SetInputs inputs{
+        .chipKeysDown = m_inputHandler.getChipKeysDown(),
+        .systemKeysPressed = m_inputHandler.getSystemKeysPressed(),
+        .isRewindHeld = m_inputHandler.isSystemKeyHeld(InputHandler::SystemKeyInputs::K_REWIND),
+        .isFastForwardHeld = m_inputHandler.isSystemKeyHeld(InputHandler::SystemKeyInputs::K_FAST_FORWARD),
+    };
 
-    const bool activateManualPressed{ m_inputHandler.isSystemKeyPressed(InputHandler::SystemKeyInputs::K_ACTIVATE_MANUAL) };
-    if (activateManualPressed)
+    // The same key pressed two frames running is two presses, even though nothing else changed
+    const bool anySystemKeyPressed{ std::ranges::find(inputs.systemKeysPressed, true) != inputs.systemKeysPressed.end() };
+    if (anySystemKeyPressed || inputs != m_lastSentInputs)
     {
-        m_stateManager.tryTransitionTo(StateManager::manual);
+        m_pendingCommands.emplace_back(inputs);
+        m_lastSentInputs = inputs;
     }
 }
 
-void Emulator::emulateFrame()
+void Emulator::sendPendingCommands()
 {
-    handleEmulatorStateTransitions();
-
-    m_chip->decrementTimers();
-
-    executeChipInstructions();
-
-    m_chip->setPrevFrameInputs();
-}
-
-int Emulator::calculateNumInstructionsNeededForFrame()
-{
-    int targetNumInstrPerSecond{ m_chip->getTargetNumInstrPerSecond() };
-    if (targetNumInstrPerSecond <= 0)
-    {
-        return 0;
-    }
-    if (targetNumInstrPerSecond < m_displaySettings->targetFPS)
+    std::size_t numSent{ 0 };
+    while (numSent < m_pendingCommands.size() && m_emulationThread->trySendCommand(std::move(m_pendingCommands[numSent])))
     {
-        return 1;
+        ++numSent;
     }
-    return targetNumInstrPerSecond / m_displaySettings->targetFPS;
-}
 
-void Emulator::handleOpcodeExecutionError(const std::runtime_error& exception)
-{
-    m_chip = std::make_unique<Chip8>();
-    m_currentErrorMessage = std::string(exception.what()) + " - Please fix any bugs present in the ROM or try a different ROM! "
-                                                            + "Make sure it is CHIP-8 compatible";
+    m_pendingCommands.erase(m_pendingCommands.begin(), m_pendingCommands.begin() + Utility::toInt(numSent));
 }
 
-void Emulator::handleFileInputError(const FileInputException &exception)
+int Emulator::calculatePresentRate() const
 {
-    m_chip = std::make_unique<Chip8>();
-    m_currentErrorMessage = std::string(exception.what()) + " Failed to load file. Please ensure it is not being"
-                                                            + "used by any other processes.";
-}
+    const int targetFPS{ m_displaySettings->targetFPS };
+    const int refreshRate{ m_renderer->getDisplayRefreshRate() };
 
+    return refreshRate > 0 ? std::min(refreshRate, targetFPS) : targetFPS;
+}
 
-void Emulator::updateAudioState()
+void Emulator::updateAudioState(const EmulatorSnapshot& snapshot)
 {
     if (!(m_audioPlayer->isAudioLoaded()))
     {
         return;
     }
 
-    if (m_chip->getSoundTimer() > 0)
+    if (snapshot.chip.soundTimer > 0)
     {
         m_audioPlayer->startSound();
     }
-    else if (m_chip->getSoundTimer() == 0)
+    else if (snapshot.chip.soundTimer == 0)
     {
         m_audioPlayer->stopSound();
     }
 }
 
-void Emulator::executeChipInstructions()
-{
-    try
-    {
-        if (m_stateManager.getCurrentState() == StateManager::State::running)
-        {
-            int numInstructionsToExecute { calculateNumInstructionsNeededForFrame() };
-            m_chip->executeInstructions(numInstructionsToExecute);
-        }
-        else if (m_stateManager.getCurrentState() == StateManager::State::debug)
-        {
-            // Debug mode - Allows user to pause the program and step through it instruction by instruction or frame by frame. Inputs are still processed during this, so that the
-            // User can input things while debugging. Need to hold down the buttons while stepping for that input to be processed
-
-            if (m_stateManager.getCurrentDebugMode() != StateManager::DebugMode::step
-                && m_inputHandler.isSystemKeyPressed(InputHandler::SystemKeyInputs::K_ACTIVATE_STEP))
-            {
-                m_stateManager.tryTransitionTo(StateManager::DebugMode::step);
-            }
-
-            if (m_stateManager.getCurrentDebugMode() != StateManager::DebugMode::manual
-                && m_inputHandler.isSystemKeyPressed(InputHandler::SystemKeyInputs::K_ACTIVATE_MANUAL))
-            {
-                m_stateManager.tryTransitionTo(StateManager::DebugMode::manual);
-            }
-
-            if (m_stateManager.getCurrentDebugMode() == StateManager::step
-                && m_inputHandler.isSystemKeyPressed(InputHandler::SystemKeyInputs::K_NEXT_FRAME))
-            {
-                int numInstructionsToExecute{ calculateNumInstructionsNeededForFrame() };
-                m_chip->executeInstructions(numInstructionsToExecute);
-            }
-
-            if (m_stateManager.getCurrentDebugMode() == StateManager::manual
-                && m_inputHandler.isSystemKeyPressed(InputHandler::SystemKeyInputs::K_NEXT_INSTRUCTION))
-            {
-                m_chip->performFDECycle();
-            }
-        }
-    }
-    catch (const BadOpcodeException& exception)
-    {
-        handleOpcodeExecutionError(exception);
-    }
-    catch (const ChipStackErrorException& exception)
-    {
-        handleOpcodeExecutionError(exception);
-    }
-    catch (const ChipOOBMemoryAccessException& exception)
-    {
-        handleOpcodeExecutionError(exception);
-    }
-}
-
-void Emulator::render()
+void Emulator::render(const EmulatorSnapshot& snapshot)
 {
     m_renderer->clearDisplay();
 
-    if (m_chip->isRomLoaded())
+    if (snapshot.chip.runtimeMetaData.romIsLoaded)
     {
-        m_renderer->drawChipScreenBufferToFrame(m_chip->getScreenBuffer());
+        {
+            const Trace::Scope traceScope{ "drawChipScreenBufferToFrame" };
+            m_renderer->drawChipScreenBufferToFrame(snapshot.chip.screen, findChangedRows(m_lastDrawnScreen, snapshot.chip.screen));
+        }
+        m_lastDrawnScreen = snapshot.chip.screen;
 
-        if (m_stateManager.getCurrentState() == StateManager::debug)
+        if (snapshot.stateManager.getCurrentState() == StateManager::debug)
         {
             constexpr int xPos{ 10 };
             constexpr int yPos{ 10 };
 
-            StateManager::DebugMode debugMode{ m_stateManager.getCurrentDebugMode() };
+            StateManager::DebugMode debugMode{ snapshot.stateManager.getCurrentDebugMode() };
             if (debugMode == StateManager::DebugMode::step)
             {
                 m_renderer->drawTextAt("STEP MODE ON", xPos, yPos);
@@ -236,44 +175,70 @@ void Emulator::render()
                 m_renderer->drawTextAt("MANUAL MODE ON", xPos, yPos);
             }
         }
+
+        constexpr int moviePosX{ 10 };
+        constexpr int moviePosY{ 40 };
+        if (snapshot.isRecordingMovie)
+        {
+            m_renderer->drawTextAt("RECORDING MOVIE", moviePosX, moviePosY);
+        }
+        else if (snapshot.isPlayingMovie)
+        {
+            m_renderer->drawTextAt("PLAYING MOVIE", moviePosX, moviePosY);
+        }
     }
     else
     {
-        m_renderer->drawTextAt(m_currentErrorMessage, 0, 0);
+        m_renderer->drawTextAt(snapshot.errorMessage, 0, 0);
     }
 
     if (m_displaySettings->showDebugWindows)
     {
-        try
-        {
-            FrameInfo frameInfo { m_frameTimer.getFrameInfo() };
-            frameInfo.numInstructionsExecuted = m_numInstrExecutedThisFrame;
+        FrameInfo frameInfo { m_frameTimer.getFrameInfo() };
+        frameInfo.numInstructionsExecuted = snapshot.numInstructionsExecuted;
+        frameInfo.speedMultiplier = snapshot.speedMultiplier;
+        frameInfo.emulationPacing = snapshot.framePacing;
 
-            int targetFPSBeforeUserInput{ m_displaySettings->targetFPS };
+        int targetFPSBeforeUserInput{ m_displaySettings->targetFPS };
+        const int rewindLimitBeforeUserInput{ m_displaySettings->rewindMemoryLimitMB };
+        const int spinWindowBeforeUserInput{ m_displaySettings->frameSpinWindowMicroSec };
 
+        {
+            const Trace::Scope traceScope{ "drawAllImguiWindows" };
             m_imguiRenderer->drawAllImguiWindows(
                 m_displaySettings,
                 *m_renderer,
-                *m_chip,
-                m_stateManager,
+                snapshot,
+                m_pendingCommands,
                 frameInfo,
                 m_audioPlayer->isAudioLoaded()
             );
+        }
 
-            int targetFPSAfterUserInput{ m_displaySettings->targetFPS };
+        int targetFPSAfterUserInput{ m_displaySettings->targetFPS };
 
-            bool targetFPSChanged{ targetFPSAfterUserInput != targetFPSBeforeUserInput };
-            if (targetFPSChanged)
-            {
-                m_frameTimer.setTargetFPS(targetFPSAfterUserInput);
-            }
+        bool targetFPSChanged{ targetFPSAfterUserInput != targetFPSBeforeUserInput };
+        if (targetFPSChanged)
+        {
+            m_frameTimer.setTargetFPS(calculatePresentRate());
+            m_pendingCommands.emplace_back(EmulatorCommands::SetTargetFPS{ targetFPSAfterUserInput });
+        }
+
+        if (m_displaySettings->frameSpinWindowMicroSec != spinWindowBeforeUserInput)
+        {
+            const std::chrono::microseconds spinWindow{ m_displaySettings->frameSpinWindowMicroSec };
+            m_frameTimer.setSpinWindow(spinWindow);
+            m_pendingCommands.emplace_back(EmulatorCommands::SetFrameSpinWindow{ spinWindow });
         }
-        catch (const FileInputException& exception)
+
+        if (m_displaySettings->rewindMemoryLimitMB != rewindLimitBeforeUserInput)
         {
-            handleFileInputError(exception);
+            m_pendingCommands.emplace_back(
+                EmulatorCommands::SetRewindCapacity{ megabytesToBytes(m_displaySettings->rewindMemoryLimitMB) });
         }
     }
 
+    const Trace::Scope traceScope{ "SDL_RenderPresent" };
     m_renderer->render();
 }
 
@@ -285,24 +250,23 @@ void Emulator::updateFrameTimingInfo()
 
 void Emulator::run()
 {
+    Trace::setThreadName("UI");
+
     while (m_isRunning)
     {
+        const Trace::Scope traceScope{ "UI frame" };
         m_frameTimer.startFrameTiming();
 
-        const uint64_t totalInstrExecutedBeforeFrame{ m_chip->getRuntimeMetaData().numInstructionsExecuted };
-
         processInputs();
 
-        if (m_chip->isRomLoaded())
-        {
-            emulateFrame();
-            updateAudioState();
-        }
+        m_emulationThread->rethrowIfFailed();
+        m_emulationThread->updateSnapshot();
+        const EmulatorSnapshot& snapshot{ m_emulationThread->getSnapshot() };
 
-        render();
-        updateFrameTimingInfo();
+        updateAudioState(snapshot);
+        render(snapshot);
 
-        const uint64_t totalInstrExecutedAfterframe{ m_chip->getRuntimeMetaData().numInstructionsExecuted };
-        m_numInstrExecutedThisFrame = totalInstrExecutedAfterframe - totalInstrExecutedBeforeFrame;
+        sendPendingCommands();
+        updateFrameTimingInfo();
     }
 }
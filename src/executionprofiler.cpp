@@ -0,0 +1,189 @@
+#include "executionprofiler.h"
+
+#include <algorithm>
+#include <format>
+#include <ranges>
+
+#include "utils/utility.h"
+
+ExecutionProfiler::ExecutionProfiler(const std::size_t memorySize)
+: m_hitsAtAddress(memorySize)
+, m_callTree(1)
+, m_routineStats(memorySize + 1)
+, m_currentRoutine{ memorySize }
+{
+    m_callTree.reserve(s_maxCallTreeNodes);
+}
+
+void ExecutionProfiler::setMode(const Mode mode)
+{
+    m_mode = mode;
+    m_runsUntilSample = 1;
+}
+
+void ExecutionProfiler::clear()
+{
+    std::ranges::fill(m_hitsAtAddress, uint64_t{ 0 });
+    m_hitsPerOperation = {};
+    m_totalHits = 0;
+
+    // The next beginRun() walks back down to wherever the ROM is
+    m_callTree.assign(1, CallTreeNode{});
+    std::ranges::fill(m_routineStats, RoutineStats{});
+    m_callPath.clear();
+    m_currentNode = s_rootNode;
+    m_currentRoutine = m_hitsAtAddress.size();
+}
+
+void ExecutionProfiler::beginRun(const std::span<const uint16_t> routines)
+{
+    std::size_t numMatching{ 0 };
+    while (numMatching < std::min(routines.size(), m_callPath.size())
+           && m_callPath[numMatching].routine == routines[numMatching] % m_hitsAtAddress.size())
+    {
+        ++numMatching;
+    }
+
+    while (m_callPath.size() > numMatching)
+    {
+        leaveRoutine();
+    }
+
+    for (const uint16_t routine : routines.subspan(numMatching))
+    {
+        enterRoutine(routine, false);
+    }
+}
+
+void ExecutionProfiler::enterRoutine(const uint16_t address, const bool isCall)
+{
+    const uint16_t routine{ Utility::toU16(address % m_hitsAtAddress.size()) };
+
+    m_currentNode = findOrAddChild(m_currentNode, routine);
+    m_currentRoutine = routine;
+    m_callPath.push_back(CallPathEntry{ .routine = routine, .node = m_currentNode });
+
+    RoutineStats& stats{ m_routineStats[routine] };
+    if (isCall)
+    {
+        ++stats.numCalls;
+    }
+    if (stats.numActiveCalls++ == 0)
+    {
+        stats.totalHitsWhenCalled = m_totalHits;
+    }
+}
+
+void ExecutionProfiler::leaveRoutine()
+{
+    // Only happens if the ROM returns from more calls than it made, which the Chip8 stops with an exception anyway
+    if (m_callPath.empty())
+    {
+        return;
+    }
+
+    RoutineStats& stats{ m_routineStats[m_callPath.back().routine] };
+    if (--stats.numActiveCalls == 0)
+    {
+        stats.inclusiveHits += m_totalHits - stats.totalHitsWhenCalled;
+    }
+
+    m_callPath.pop_back();
+    m_currentNode = m_callPath.empty() ? s_rootNode : m_callPath.back().node;
+    m_currentRoutine = m_callPath.empty() ? m_hitsAtAddress.size() : m_callPath.back().routine;
+}
+
+uint32_t ExecutionProfiler::findOrAddChild(const uint32_t parent, const uint16_t routine)
+{
+    uint32_t* link{ &m_callTree[parent].firstChild };
+    while (*link != s_noNode)
+    {
+        if (m_callTree[*link].routine == routine)
+        {
+            return *link;
+        }
+        link = &m_callTree[*link].nextSibling;
+    }
+
+    if (m_callTree.size() >= s_maxCallTreeNodes)
+    {
+        return parent;
+    }
+
+    // Filled in before push_back, which would leave link dangling if it reallocated. It won't, since the tree reserved
+    // room for every node up front
+    *link = Utility::toU32(m_callTree.size());
+    m_callTree.push_back(CallTreeNode{ .routine = routine, .parent = parent });
+    return *link;
+}
+
+void ExecutionProfiler::getRoutineProfiles(std::vector<RoutineProfile>& routines) const
+{
+    routines.clear();
+
+    const std::size_t topLevel{ m_hitsAtAddress.size() };
+    for (std::size_t routine{ 0 }; routine <= topLevel; ++routine)
+    {
+        const RoutineStats& stats{ m_routineStats[routine] };
+        if (stats.numCalls == 0 && stats.numActiveCalls == 0 && stats.exclusiveHits == 0)
+        {
+            continue;
+        }
+
+        // Calls still running haven't had their inclusive hits added yet. The top level is always running
+        uint64_t inclusiveHits{ stats.inclusiveHits };
+        if (routine == topLevel)
+        {
+            inclusiveHits = m_totalHits;
+        }
+        else if (stats.numActiveCalls > 0)
+        {
+            inclusiveHits += m_totalHits - stats.totalHitsWhenCalled;
+        }
+
+        routines.push_back(RoutineProfile{
+            .isTopLevel = routine == topLevel,
+            .address = routine == topLevel ? uint16_t{ 0 } : Utility::toU16(routine),
+            .exclusiveHits = stats.exclusiveHits,
+            .inclusiveHits = inclusiveHits,
+            .numCalls = stats.numCalls,
+        });
+    }
+}
+
+void ExecutionProfiler::writeFoldedStacks(std::ostream& output) const
+{
+    std::vector<uint16_t> path{};
+    for (const CallTreeNode& node : m_callTree)
+    {
+        if (node.numHits == 0)
+        {
+            continue;
+        }
+
+        path.clear();
+        for (const CallTreeNode* caller{ &node }; caller->parent != s_noNode; caller = &m_callTree[caller->parent])
+        {
+            path.push_back(caller->routine);
+        }
+
+        output << "main";
+        for (const uint16_t routine : path | std::views::reverse)
+        {
+            output << std::format(";sub_{:03X}", routine);
+        }
+        output << ' ' << node.numHits << '\n';
+    }
+}
+
+bool ExecutionProfiler::startNextSample()
+{
+    // xorshift32, plenty for spreading samples out
+    m_sampleGapRandomState ^= m_sampleGapRandomState << 13;
+    m_sampleGapRandomState ^= m_sampleGapRandomState >> 17;
+    m_sampleGapRandomState ^= m_sampleGapRandomState << 5;
+
+    // Anywhere from half to one and a half times the mean
+    m_runsUntilSample = s_meanRunsPerSample / 2 + Utility::toInt(m_sampleGapRandomState % s_meanRunsPerSample);
+    return true;
+}
@@ -2,8 +2,43 @@
 
 #include "../include/types/displaysettings.h"
 #include "../include/types/frameinfo.h"
+#include "../include/utils/trace.h"
+#include <algorithm>
 #include <chrono>
-#include <bits/this_thread_sleep.h>
+#include <cmath>
+#include <span>
+#include <thread>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <ctime>
+#endif
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    void sleepUntil(const Clock::time_point wakeTime)
+    {
+#if defined(__linux__)
+        // libstdc++'s steady_clock is CLOCK_MONOTONIC, so its time points can go straight to the kernel. Sleeping until
+        // an absolute time, rather than for a duration, can't be thrown off by being preempted between working the
+        // duration out and going to sleep
+        const auto timeSinceEpoch{ wakeTime.time_since_epoch() };
+        const auto wholeSeconds{ std::chrono::duration_cast<std::chrono::seconds>(timeSinceEpoch) };
+        const timespec deadline{
+            .tv_sec = static_cast<time_t>(wholeSeconds.count()),
+            .tv_nsec = static_cast<long>(std::chrono::duration_cast<std::chrono::nanoseconds>(timeSinceEpoch - wholeSeconds).count()),
+        };
+
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR)
+        {
+        }
+#else
+        std::this_thread::sleep_until(wakeTime);
+#endif
+    }
+}
 
 FrameTimer::FrameTimer(const int targetFPS)
 : m_targetFPS{ targetFPS }
@@ -30,13 +65,111 @@ void FrameTimer::endFrameTiming()
 
 void FrameTimer::delayToReachTargetFrameTime()
 {
-    if (m_frameTimeMicroSec < m_targetFrameTimeMicroSec)
+    // Falling more than a whole frame behind starts the deadlines again from here, rather than rushing through frames
+    // to catch up
+    const bool isFirstDeadline{ m_nextDeadline == Clock::time_point{} };
+    if (isFirstDeadline || m_endTimeMicroSec > m_nextDeadline + m_targetFrameTimeMicroSec)
+    {
+        m_nextDeadline = std::max(m_endTimeMicroSec, m_startTimeMicroSec + m_targetFrameTimeMicroSec);
+        m_lastWakeTime = {};
+    }
+
+    {
+        const Trace::Scope traceScope{ "frame pacing wait" };
+        waitUntil(m_nextDeadline);
+    }
+
+    const Clock::time_point wakeTime{ Clock::now() };
+    if (m_lastWakeTime != Clock::time_point{})
+    {
+        recordPacingSample(wakeTime - m_nextDeadline, wakeTime - m_lastWakeTime);
+    }
+    m_lastWakeTime = wakeTime;
+    m_nextDeadline += m_targetFrameTimeMicroSec;
+
+    m_frameTimeMicroSec = std::chrono::duration_cast<Microseconds>(wakeTime - m_startTimeMicroSec);
+    updateActualFPS();
+}
+
+void FrameTimer::finishFrameWithoutDelay()
+{
+    restartDeadlines();
+    updateActualFPS();
+}
+
+void FrameTimer::waitUntil(const Clock::time_point deadline) const
+{
+    const Clock::time_point sleepEndTime{ deadline - m_spinWindow };
+    if (Clock::now() < sleepEndTime)
+    {
+        sleepUntil(sleepEndTime);
+    }
+
+    while (Clock::now() < deadline)
+    {
+        std::this_thread::yield();
+    }
+}
+
+void FrameTimer::recordPacingSample(const Clock::duration overshoot, const Clock::duration interval)
+{
+    using FloatMicroseconds = std::chrono::duration<float, std::micro>;
+
+    m_overshootSamplesMicroSec[m_nextPacingSample] = std::chrono::duration_cast<FloatMicroseconds>(overshoot).count();
+    m_intervalSamplesMicroSec[m_nextPacingSample] = std::chrono::duration_cast<FloatMicroseconds>(interval).count();
+
+    m_nextPacingSample = (m_nextPacingSample + 1) % s_numPacingSamples;
+    m_numPacingSamples = std::min(m_numPacingSamples + 1, s_numPacingSamples);
+}
+
+void FrameTimer::restartDeadlines()
+{
+    m_nextDeadline = {};
+    m_lastWakeTime = {};
+}
+
+FramePacingStats FrameTimer::getPacingStats() const
+{
+    if (m_numPacingSamples == 0)
+    {
+        return {};
+    }
+
+    // Which samples are filled doesn't matter, only how many
+    const auto overshoots{ std::span{ m_overshootSamplesMicroSec }.first(m_numPacingSamples) };
+    const auto intervals{ std::span{ m_intervalSamplesMicroSec }.first(m_numPacingSamples) };
+    const float numSamples{ static_cast<float>(m_numPacingSamples) };
+
+    float totalOvershoot{ 0.0f };
+    float maxOvershoot{ 0.0f };
+    for (const float overshoot : overshoots)
+    {
+        totalOvershoot += overshoot;
+        maxOvershoot = std::max(maxOvershoot, overshoot);
+    }
+
+    float totalInterval{ 0.0f };
+    for (const float interval : intervals)
+    {
+        totalInterval += interval;
+    }
+    const float averageInterval{ totalInterval / numSamples };
+
+    float totalSquaredDeviation{ 0.0f };
+    for (const float interval : intervals)
     {
-        const auto timeToWaitMicroSec{ m_targetFrameTimeMicroSec - m_frameTimeMicroSec };
-        std::this_thread::sleep_for(timeToWaitMicroSec);
-        m_frameTimeMicroSec += timeToWaitMicroSec;
+        totalSquaredDeviation += (interval - averageInterval) * (interval - averageInterval);
     }
 
+    return FramePacingStats{
+        .averageOvershootUs = totalOvershoot / numSamples,
+        .maxOvershootUs = maxOvershoot,
+        .jitterUs = std::sqrt(totalSquaredDeviation / numSamples),
+    };
+}
+
+void FrameTimer::updateActualFPS()
+{
     m_actualFPS = (m_frameTimeMicroSec.count() > 0) ?
     (1'000'000.0f / static_cast<float>(m_frameTimeMicroSec.count()) )
     : 0.0f;
@@ -56,6 +189,12 @@ void FrameTimer::setTargetFPS(const int newTargetFPS)
 {
     m_targetFPS = newTargetFPS;
     m_targetFrameTimeMicroSec = std::chrono::duration_cast<Microseconds>(std::chrono::seconds(1)) / m_targetFPS;
+    restartDeadlines();
+}
+
+void FrameTimer::setSpinWindow(const std::chrono::microseconds spinWindow)
+{
+    m_spinWindow = spinWindow;
 }
 
 FrameInfo FrameTimer::getFrameInfo() const
@@ -65,7 +204,8 @@ FrameInfo FrameTimer::getFrameInfo() const
         .endTimeMs = std::chrono::duration_cast<Milliseconds>(m_endTimeMicroSec.time_since_epoch()).count(),
         .frameTimeMs = static_cast<float>(m_frameTimeMicroSec.count()) / 1000.0f,
         .fps = m_actualFPS,
-        .numInstructionsExecuted = 0
+        .numInstructionsExecuted = 0,
+        .pacing = getPacingStats(),
     };
 }
 
@@ -2,14 +2,17 @@
 #define IMGUI_DEFINE_MATH_OPERATORS
 #include "imguirenderer.h"
 
+#include <algorithm>
+#include <cmath>
 #include <ranges>
 
 #include "chip8.h"
 #include "renderer.h"
 #include "../include/types/displaysettings.h"
-#include "../include/exceptions/fileinputexception.h"
 
 #include "../include/types/frameinfo.h"
+#include "../include/utils/trace.h"
+#include "../include/exceptions/fileinputexception.h"
 
 #include "ImGuiFileDialog.h"
 #include "imgui_internal.h"
@@ -54,6 +57,14 @@ void ImguiRenderer::drawGeneralInfoWindow(
 
     displayText("FPS: {:.1f}", frameInfo.fps);
     displayText("Frame Time: {}ms", frameInfo.frameTimeMs);
+    displayText("Speed: {:.1f}x", frameInfo.speedMultiplier);
+
+    const auto displayPacing{ [this](const std::string_view name, const FramePacingStats& pacing) {
+        displayText("{} pacing: overshoot {:.0f}us avg, {:.0f}us max, jitter {:.0f}us",
+            name, pacing.averageOvershootUs, pacing.maxOvershootUs, pacing.jitterUs);
+    } };
+    displayPacing("UI", frameInfo.pacing);
+    displayPacing("Emulation", frameInfo.emulationPacing);
 
     displayText("Sound timer: {}", soundTimer);
 
@@ -91,15 +102,15 @@ void ImguiRenderer::printRowStartAddress(const std::size_t rowStartAddress,
 {
     if (rowStartAddress >= fontStartAddress && rowStartAddress <= fontEndAddress)
     {
-        ImGui::TextColored(blue, "0x%04lX |", rowStartAddress);
+        ImGui::TextColored(blue, "0x%04zX |", rowStartAddress);
     }
     else if(rowStartAddress >= programStartAddress && rowStartAddress <= programEndAddress)
     {
-        ImGui::TextColored(green, "0x%04lX |", rowStartAddress);
+        ImGui::TextColored(green, "0x%04zX |", rowStartAddress);
     }
     else
     {
-        displayText("0x{:04X} |", rowStartAddress);
+        ImGui::Text("0x%04zX |", rowStartAddress);
     }
 }
 
@@ -112,98 +123,208 @@ bool isValidASCIIValue(uint8_t value)
 }
 
 
-void ImguiRenderer::printASCIIRepresentationOfMemoryRow(const std::array<uint8_t, 4096> &memoryContents,
-    const std::size_t rowStartPos, const int numBytesToPrint) const
+bool ImguiRenderer::isRecentlyWritten(const int writtenOnFrame)
 {
-    auto rowBegin { memoryContents.begin() + rowStartPos };
-    auto rowEnd { rowBegin + numBytesToPrint };
+    return ImGui::GetFrameCount() - writtenOnFrame < s_writeHighlightFrames;
+}
 
+void ImguiRenderer::formatMemoryRow(MemoryRowText& row, const std::span<const uint8_t> rowContents,
+                                    const bool highlightChanges)
+{
+    constexpr std::string_view hexDigits{ "0123456789ABCDEF" };
     constexpr char placeHolderForInvalidChar{ '.' };
-    for (uint8_t currMemContents : std::ranges::subrange(rowBegin, rowEnd))
+
+    uint16_t changedBytes{ 0 };
+
+    row.numBytes = std::min(rowContents.size(), s_bytesPerMemoryRow);
+    for (std::size_t i{ 0 }; i < row.numBytes; ++i)
     {
-        ImGui::SameLine(0.0f, 0.0f);
+        const uint8_t byte{ rowContents[i] };
+        if (highlightChanges && byte != row.bytes[i])
+        {
+            changedBytes |= Utility::toU16(1u << i);
+        }
+        row.bytes[i] = byte;
 
-        if (isValidASCIIValue(currMemContents))
+        row.hex[i * 3] = ' ';
+        row.hex[i * 3 + 1] = hexDigits[byte >> 4];
+        row.hex[i * 3 + 2] = hexDigits[byte & 0xF];
+
+        row.ascii[i] = isValidASCIIValue(byte) ? static_cast<char>(byte) : placeHolderForInvalidChar;
+    }
+
+    if (changedBytes != 0)
+    {
+        row.recentlyWrittenBytes = changedBytes;
+        row.writtenOnFrame = ImGui::GetFrameCount();
+    }
+}
+
+void ImguiRenderer::updateMemoryRowText(const std::span<const uint8_t> memoryContents,
+                                        const Chip8::DebugGenerations& generations)
+{
+    const std::size_t numRows{ (memoryContents.size() + s_bytesPerMemoryRow - 1) / s_bytesPerMemoryRow };
+
+    // Nothing formatted for another machine can be kept, and a new ROM being loaded isn't worth highlighting
+    const bool isSameMachine{ generations.machine == m_memoryRowGenerations.machine && m_memoryRows.size() == numRows };
+    if (!isSameMachine)
+    {
+        m_memoryRows.assign(numRows, MemoryRowText{});
+    }
+
+    constexpr std::size_t rowsPerRegion{ Chip8::DebugGenerations::memoryRegionSize / s_bytesPerMemoryRow };
+    for (std::size_t region{ 0 }; region < generations.memoryRegions.size(); ++region)
+    {
+        if (isSameMachine && generations.memoryRegions[region] == m_memoryRowGenerations.memoryRegions[region])
         {
-            displayText("{:c}", currMemContents);
+            continue;
         }
-        else
+
+        const std::size_t lastRow{ std::min((region + 1) * rowsPerRegion, numRows) };
+        for (std::size_t row{ region * rowsPerRegion }; row < lastRow; ++row)
         {
-            displayText("{:c}", placeHolderForInvalidChar);
+            const std::size_t rowStartAddress{ row * s_bytesPerMemoryRow };
+            const std::size_t rowLength{ std::min(s_bytesPerMemoryRow, memoryContents.size() - rowStartAddress) };
+
+            formatMemoryRow(m_memoryRows[row], memoryContents.subspan(rowStartAddress, rowLength), isSameMachine);
         }
     }
+
+    m_memoryRowGenerations = generations;
 }
 
-void ImguiRenderer::printMemoryRow(const std::array<uint8_t, 4096>& memoryContents, const std::size_t rowStartPos,
-                                   const int numBytesToPrint,
-                                   const Chip8::RuntimeMetaData& runtimeData, const uint16_t chipPCValue) const
+void ImguiRenderer::printMemoryRow(const MemoryRowText& row, const std::size_t rowStartAddress,
+                                   const Chip8::RuntimeMetaData& runtimeData, const uint16_t chipPCValue,
+                                   const std::span<const uint64_t> rowHits, const uint64_t maxHits) const
 {
-    printRowStartAddress(rowStartPos, runtimeData.programStartAddress, runtimeData.programEndAddress,
-                                      runtimeData.fontStartAddress, runtimeData.fontEndAddress);
-
-    auto rowBegin { memoryContents.begin() + rowStartPos };
-    auto rowEnd { rowBegin + numBytesToPrint };
+    printRowStartAddress(rowStartAddress, runtimeData.programStartAddress, runtimeData.programEndAddress,
+                                          runtimeData.fontStartAddress, runtimeData.fontEndAddress);
 
-    auto memoryRowView{ std::ranges::subrange(rowBegin, rowEnd) };
-    for (auto [offset, currMemContents] : std::views::enumerate(memoryRowView))
+    // The heatmap goes behind the hex, so is drawn first. Each byte is " XX" in a monospaced font. Log scaled, since
+    // the hottest loop usually runs orders of magnitude more than anything else
+    if (!rowHits.empty() && maxHits > 0)
     {
-        ImGui::SameLine();
-        uint16_t currAddress{ Utility::toU16(rowStartPos + Utility::toU16(offset)) };
+        ImGui::SameLine(0.0f, 0.0f);
+        const ImVec2 hexStart{ ImGui::GetCursorScreenPos() };
+        const float charWidth{ ImGui::CalcTextSize("0").x };
+        const float lineHeight{ ImGui::GetTextLineHeight() };
+        const float logMaxHits{ std::log1p(static_cast<float>(maxHits)) };
 
-        const bool currAddressInFontRange { currAddress >= runtimeData.fontStartAddress
-                                         && currAddress <= runtimeData.fontEndAddress };
-        const bool currAddressInProgramRange { currAddress >= runtimeData.programStartAddress
-                                         && currAddress <= runtimeData.programEndAddress };
+        ImDrawList* drawList{ ImGui::GetWindowDrawList() };
+        for (std::size_t offset{ 0 }; offset < std::min(row.numBytes, rowHits.size()); ++offset)
+        {
+            if (rowHits[offset] == 0)
+            {
+                continue;
+            }
 
-        if (currAddressInFontRange)
+            const float heatLevel{ std::log1p(static_cast<float>(rowHits[offset])) / logMaxHits };
+            const ImVec2 topLeft{ hexStart.x + static_cast<float>(offset * 3 + 1) * charWidth, hexStart.y };
+            drawList->AddRectFilled(topLeft, topLeft + ImVec2{ charWidth * 2.0f, lineHeight },
+                ImGui::GetColorU32(ImVec4{ heat.x, heat.y, heat.z, 0.15f + 0.65f * heatLevel }));
+        }
+    }
+
+    const uint16_t recentlyWrittenBytes{ isRecentlyWritten(row.writtenOnFrame) ? row.recentlyWrittenBytes : uint16_t{ 0 } };
+
+    const auto colourOfByte{ [&](const std::size_t offset) -> const ImVec4& {
+        const std::size_t address{ rowStartAddress + offset };
+        if (address == chipPCValue || address == chipPCValue + 1u)
         {
-            ImGui::TextColored(blue, "%02X", currMemContents);
-            continue;
+            return red;
         }
 
-        if (currAddressInProgramRange)
+        if ((recentlyWrittenBytes >> offset) & 1)
         {
-            if (currAddress == chipPCValue || currAddress == chipPCValue + 1)
-            {
-                ImGui::TextColored(red, "%02X", currMemContents);
-            }
-            else
-            {
-                ImGui::TextColored(green, "%02X", currMemContents);
-            }
-            continue;
+            return yellow;
+        }
+
+        if (address >= runtimeData.fontStartAddress && address <= runtimeData.fontEndAddress)
+        {
+            return blue;
+        }
+
+        if (address >= runtimeData.programStartAddress && address <= runtimeData.programEndAddress)
+        {
+            return green;
         }
 
-        displayText("{:02X}", currMemContents);
+        return defaultTextColour;
+    } };
+
+    // Each run of same coloured bytes is drawn as one item, straight out of the row's formatted text
+    std::size_t runStart{ 0 };
+    while (runStart < row.numBytes)
+    {
+        const ImVec4& runColour{ colourOfByte(runStart) };
+
+        std::size_t runEnd{ runStart + 1 };
+        while (runEnd < row.numBytes && &colourOfByte(runEnd) == &runColour)
+        {
+            ++runEnd;
+        }
+
+        ImGui::SameLine(0.0f, 0.0f);
+        ImGui::PushStyleColor(ImGuiCol_Text, runColour);
+        ImGui::TextUnformatted(row.hex.data() + runStart * 3, row.hex.data() + runEnd * 3);
+        ImGui::PopStyleColor();
+
+        runStart = runEnd;
     }
 
-    ImGui::SameLine();
-    displayText(" ");
+    ImGui::SameLine(0.0f, 0.0f);
+    ImGui::TextUnformatted("  ");
 
-    printASCIIRepresentationOfMemoryRow(memoryContents, rowStartPos, numBytesToPrint);
+    ImGui::SameLine(0.0f, 0.0f);
+    ImGui::TextUnformatted(row.ascii.data(), row.ascii.data() + row.numBytes);
 }
 
-void ImguiRenderer::drawMemoryViewerWindow(const Chip8& chip) const
+void ImguiRenderer::drawMemoryViewerWindow(const EmulatorSnapshot& snapshot)
 {
-    const int bytesPerRow{ 16};
+    const Chip8::SaveState& chip{ snapshot.chip };
+    const std::span<const uint8_t> memoryContents{ chip.memory };
+    updateMemoryRowText(memoryContents, snapshot.debugGenerations);
 
-    const std::array<uint8_t, 4096> memoryContents{ chip.getMemoryContents() };
+    const std::span<const uint64_t> profileHits{ m_isHeatmapShown ? std::span<const uint64_t>{ snapshot.profileHitsAtAddress }
+                                                                   : std::span<const uint64_t>{} };
+    const uint64_t maxHits{ profileHits.empty() ? 0 : std::ranges::max(profileHits) };
 
     ImGui::Begin("Memory Viewer");
 
     ImGui::SeparatorText("Legend");
 
     ImGui::TextColored(red, "Next instruction");
+    ImGui::TextColored(yellow, "Recently written");
     ImGui::TextColored(green, "Program code");
     ImGui::TextColored(blue, "Font data");
     displayText("Unused memory");
+    ImGui::TextColored(heat, "Executed (brighter is more often)");
+    ImGui::SameLine();
+    ImGui::Checkbox("Show", &m_isHeatmapShown);
+    ImGui::SameLine();
+    displayHelpMarker("Needs the profiler on, see the Profiler window");
 
     ImGui::SeparatorText("Memory Contents");
 
-    for (std::size_t rowStartAddress{ 0 }; rowStartAddress < memoryContents.size(); rowStartAddress += bytesPerRow)
+    // Only the rows scrolled into view are drawn, so the window costs the same however much memory there is
+    ImGui::BeginChild("Memory Contents");
+
+    ImGuiListClipper clipper{};
+    clipper.Begin(Utility::toInt(m_memoryRows.size()));
+    while (clipper.Step())
     {
-        printMemoryRow(memoryContents, rowStartAddress, bytesPerRow, chip.getRuntimeMetaData(), chip.getPCAddress());
+        for (int row{ clipper.DisplayStart }; row < clipper.DisplayEnd; ++row)
+        {
+            const std::size_t rowIndex{ Utility::toUZ(row) };
+            const std::size_t rowStartAddress{ rowIndex * s_bytesPerMemoryRow };
+            const std::span<const uint64_t> rowHits{ profileHits.empty() ? profileHits
+                : profileHits.subspan(rowStartAddress, std::min(s_bytesPerMemoryRow, profileHits.size() - rowStartAddress)) };
+            printMemoryRow(m_memoryRows[rowIndex], rowStartAddress, chip.runtimeMetaData, chip.pc, rowHits, maxHits);
+        }
     }
+    clipper.End();
+
+    ImGui::EndChild();
 
     ImGui::End();
 }
@@ -221,14 +342,14 @@ void ImguiRenderer::displayTextCentredInBounds(const std::string& text,
     displayText("{}", text);
 }
 
-void ImguiRenderer::drawSpecialChipRegisterContents(const Chip8& chip) const
+void ImguiRenderer::drawSpecialChipRegisterContents(const Chip8::SaveState& chip) const
 {
     constexpr int numSpecialRegisters { 4 };
     std::array<uint16_t, numSpecialRegisters> otherRegisterContents {
-        chip.getPCAddress(),
-        chip.getIndexRegisterContents(),
-        chip.getDelayTimer(),
-        chip.getSoundTimer()
+        chip.pc,
+        chip.indexRegister,
+        chip.delayTimer,
+        chip.soundTimer
     };
 
     constexpr std::array<std::string_view, numSpecialRegisters> otherRegisterNames {
@@ -265,18 +386,42 @@ void ImguiRenderer::drawSpecialChipRegisterContents(const Chip8& chip) const
     ImGui::PopID();
 }
 
-void ImguiRenderer::drawRegisterViewerWindow(const Chip8& chip) const
+void ImguiRenderer::updateRegisterText(const Chip8::SaveState& chip, const Chip8::DebugGenerations& generations)
 {
-    const std::array<uint8_t, 16> registerContents{ chip.getRegisterContents() };
+    const bool isSameMachine{ generations.machine == m_registerTextGenerations.machine };
+    if (isSameMachine && generations.registers == m_registerTextGenerations.registers)
+    {
+        return;
+    }
+
+    for (auto [index, registerText] : std::views::enumerate(m_registerText))
+    {
+        const uint8_t value{ chip.registers[Utility::toUZ(index)] };
+        if (isSameMachine && value != registerText.value)
+        {
+            registerText.writtenOnFrame = ImGui::GetFrameCount();
+        }
+
+        registerText.value = value;
+        registerText.text = std::format("V{0:X} ..{1:2X}", index, value);
+    }
+
+    m_registerTextGenerations = generations;
+}
+
+void ImguiRenderer::drawRegisterViewerWindow(const Chip8::SaveState& chip, const Chip8::DebugGenerations& generations)
+{
+    updateRegisterText(chip, generations);
+
     constexpr int numColumns{ 4 };
-    constexpr int maxRegistersPerColumn{ registerContents.size() / numColumns };
+    constexpr int maxRegistersPerColumn{ Utility::toInt(std::tuple_size_v<decltype(m_registerText)>) / numColumns };
 
     ImGui::Begin("Register Viewer");
     ImGui::Columns(numColumns);
     const float columnWidth { ImGui::GetColumnWidth(-1) };
     float columnStartXPos{ 0 };
 
-    for (auto [index, currContents] : std::views::enumerate(registerContents))
+    for (auto [index, registerText] : std::views::enumerate(m_registerText))
     {
         ImGui::PushID(Utility::toInt(index));
         if (index > 0 && index % maxRegistersPerColumn == 0)
@@ -286,8 +431,16 @@ void ImguiRenderer::drawRegisterViewerWindow(const Chip8& chip) const
         }
 
         const float columnEndXPos{ columnStartXPos + columnWidth };
-        std::string textToDraw{ std::format("V{0:X} ..{1:2X}", index, currContents) };
-        displayTextCentredInBounds(textToDraw, columnStartXPos, columnEndXPos);
+        const bool isHighlighted{ isRecentlyWritten(registerText.writtenOnFrame) };
+        if (isHighlighted)
+        {
+            ImGui::PushStyleColor(ImGuiCol_Text, yellow);
+        }
+        displayTextCentredInBounds(registerText.text, columnStartXPos, columnEndXPos);
+        if (isHighlighted)
+        {
+            ImGui::PopStyleColor();
+        }
         ImGui::PopID();
     }
 
@@ -300,6 +453,458 @@ void ImguiRenderer::drawRegisterViewerWindow(const Chip8& chip) const
     ImGui::End();
 }
 
+void ImguiRenderer::drawDisassemblyWindow(const Chip8::SaveState& chip)
+{
+    const std::span<const uint8_t> memoryContents{ chip.memory };
+    const Chip8::RuntimeMetaData& runtimeData{ chip.runtimeMetaData };
+
+    ImGui::Begin("Disassembly");
+    ImGui::Checkbox("Follow PC", &m_isDisassemblyFollowingPC);
+
+    // One line is left at the bottom for the cache stats
+    ImGui::BeginChild("Disassembly Listing", ImVec2{ 0.0f, -ImGui::GetFrameHeightWithSpacing() });
+
+    // Instructions are 2 bytes but nothing stops the PC being odd, so lines start at odd addresses when it is
+    const std::size_t alignment{ chip.pc % 2u };
+    const std::size_t numLines{ (memoryContents.size() - alignment) / 2 };
+    const std::size_t pcLine{ chip.pc / 2u };
+
+    const float lineHeight{ ImGui::GetTextLineHeightWithSpacing() };
+    if (m_isDisassemblyFollowingPC)
+    {
+        // Only scrolls once the PC gets near the edge of the listing, so that it doesn't jitter while the PC moves
+        // around a loop that is already in view
+        constexpr float marginLines{ 2.0f };
+        const float pcLineY{ static_cast<float>(pcLine) * lineHeight };
+        const float viewTop{ ImGui::GetScrollY() + marginLines * lineHeight };
+        const float viewBottom{ ImGui::GetScrollY() + ImGui::GetWindowHeight() - (marginLines + 1.0f) * lineHeight };
+        if (pcLineY < viewTop || pcLineY > viewBottom)
+        {
+            ImGui::SetScrollY(pcLineY - ImGui::GetWindowHeight() / 2.0f);
+        }
+    }
+
+    ImGuiListClipper clipper{};
+    clipper.Begin(Utility::toInt(numLines), lineHeight);
+    while (clipper.Step())
+    {
+        for (int line{ clipper.DisplayStart }; line < clipper.DisplayEnd; ++line)
+        {
+            const std::size_t address{ alignment + Utility::toUZ(line) * 2 };
+            const std::string_view text{ m_disassemblyCache.disassembleAt(memoryContents, Utility::toU16(address)) };
+
+            const bool isPC{ address == chip.pc };
+            const bool isInProgram{ address >= runtimeData.programStartAddress && address <= runtimeData.programEndAddress };
+            const bool hasBreakpoint{ std::ranges::find(m_breakpoints.pcBreakpoints, address) != m_breakpoints.pcBreakpoints.end() };
+
+            ImGui::PushStyleColor(ImGuiCol_Text, isPC ? red : (isInProgram ? green : defaultTextColour));
+            ImGui::Text("%c%c 0x%04zX  %02X%02X  %.*s", isPC ? '>' : ' ', hasBreakpoint ? '*' : ' ', address,
+                memoryContents[address], memoryContents[(address + 1) % memoryContents.size()],
+                Utility::toInt(text.size()), text.data());
+            ImGui::PopStyleColor();
+        }
+    }
+    clipper.End();
+
+    ImGui::EndChild();
+
+    displayText("Lines disassembled this frame: {}", m_disassemblyCache.takeNumDisassembled());
+
+    ImGui::End();
+}
+
+std::string ImguiRenderer::describeBreakHit(const Chip8::BreakHit& hit) const
+{
+    using Reason = Chip8::BreakHit::Reason;
+
+    switch (hit.reason)
+    {
+    case Reason::pcBreakpoint:
+        return std::format("Breakpoint at 0x{:04X}", hit.pc);
+    case Reason::readWatchpoint:
+        return std::format("Read of 0x{:04X} by the instruction at 0x{:04X}", hit.detail, hit.pc);
+    case Reason::writeWatchpoint:
+        return std::format("Write to 0x{:04X} by the instruction at 0x{:04X}", hit.detail, hit.pc);
+    case Reason::registerCondition:
+        if (hit.detail < m_breakpoints.registerConditions.size())
+        {
+            const Chip8::Breakpoints::RegisterCondition& condition{ m_breakpoints.registerConditions[hit.detail] };
+            return std::format("V{:X} {} 0x{:02X} before 0x{:04X}", condition.registerIndex,
+                s_comparisonSymbols[condition.comparison], condition.value, hit.pc);
+        }
+        return std::format("Register condition before 0x{:04X}", hit.pc);
+    }
+
+    return {};
+}
+
+void ImguiRenderer::drawBreakpointsWindow(const EmulatorSnapshot& snapshot, std::vector<EmulatorCommand>& commands)
+{
+    using Breakpoints = Chip8::Breakpoints;
+
+    ImGui::Begin("Breakpoints");
+
+    if (snapshot.lastBreakHit && snapshot.stateManager.getCurrentState() == StateManager::debug)
+    {
+        ImGui::TextColored(red, "Stopped: %s", describeBreakHit(*snapshot.lastBreakHit).c_str());
+    }
+
+    bool breakpointsChanged{ false };
+
+    // Erases whichever entry of entries had its Remove button clicked, drawing each with describe()
+    const auto drawRemovableList{ [&breakpointsChanged](auto& entries, const auto& describe) {
+        for (std::size_t i{ 0 }; i < entries.size(); ++i)
+        {
+            ImGui::PushID(Utility::toInt(i));
+            const bool removeClicked{ ImGui::SmallButton("Remove") };
+            ImGui::SameLine();
+            ImGui::TextUnformatted(describe(entries[i]).c_str());
+            ImGui::PopID();
+
+            if (removeClicked)
+            {
+                entries.erase(entries.begin() + Utility::toInt(i));
+                breakpointsChanged = true;
+                break;
+            }
+        }
+    } };
+
+    const auto drawAddressInput{ [](const char* label, uint16_t& address) {
+        ImGui::SetNextItemWidth(ImGui::CalcTextSize("0000").x * 3.0f);
+        ImGui::InputScalar(label, ImGuiDataType_U16, &address, nullptr, nullptr, "%04X", ImGuiInputTextFlags_CharsHexadecimal);
+    } };
+
+    ImGui::SeparatorText("PC Breakpoints");
+    ImGui::PushID("PC Breakpoints");
+    drawAddressInput("Address", m_newBreakpointAddress);
+    ImGui::SameLine();
+    if (ImGui::Button("Add")
+        && std::ranges::find(m_breakpoints.pcBreakpoints, m_newBreakpointAddress) == m_breakpoints.pcBreakpoints.end())
+    {
+        m_breakpoints.pcBreakpoints.push_back(m_newBreakpointAddress);
+        breakpointsChanged = true;
+    }
+    drawRemovableList(m_breakpoints.pcBreakpoints, [](const uint16_t address) {
+        return std::format("0x{:04X}", address);
+    });
+    ImGui::PopID();
+
+    ImGui::SeparatorText("Watchpoints");
+    ImGui::PushID("Watchpoints");
+    drawAddressInput("Address", m_newWatchpoint.address);
+    ImGui::SameLine();
+    ImGui::Checkbox("Read", &m_newWatchpoint.onRead);
+    ImGui::SameLine();
+    ImGui::Checkbox("Write", &m_newWatchpoint.onWrite);
+    ImGui::SameLine();
+    if (ImGui::Button("Add") && (m_newWatchpoint.onRead || m_newWatchpoint.onWrite))
+    {
+        m_breakpoints.watchpoints.push_back(m_newWatchpoint);
+        breakpointsChanged = true;
+    }
+    drawRemovableList(m_breakpoints.watchpoints, [](const Breakpoints::Watchpoint& watchpoint) {
+        return std::format("0x{:04X}{}{}", watchpoint.address, watchpoint.onRead ? " read" : "", watchpoint.onWrite ? " write" : "");
+    });
+    ImGui::PopID();
+
+    ImGui::SeparatorText("Register Conditions");
+    ImGui::PushID("Register Conditions");
+
+    constexpr std::array<const char*, 16> registerNames{
+        "V0", "V1", "V2", "V3", "V4", "V5", "V6", "V7", "V8", "V9", "VA", "VB", "VC", "VD", "VE", "VF"
+    };
+    int registerIndex{ m_newRegisterCondition.registerIndex };
+    ImGui::SetNextItemWidth(ImGui::CalcTextSize("VF").x * 3.0f);
+    if (ImGui::Combo("##Register", &registerIndex, registerNames.data(), Utility::toInt(registerNames.size())))
+    {
+        m_newRegisterCondition.registerIndex = Utility::toU8(registerIndex);
+    }
+
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(ImGui::CalcTextSize("!=").x * 3.0f);
+    if (ImGui::BeginCombo("##Comparison", s_comparisonSymbols[m_newRegisterCondition.comparison].data()))
+    {
+        for (std::size_t i{ 0 }; i < s_comparisonSymbols.size(); ++i)
+        {
+            const auto comparison{ static_cast<Breakpoints::Comparison>(i) };
+            if (ImGui::Selectable(s_comparisonSymbols[comparison].data(), comparison == m_newRegisterCondition.comparison))
+            {
+                m_newRegisterCondition.comparison = comparison;
+            }
+        }
+        ImGui::EndCombo();
+    }
+
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(ImGui::CalcTextSize("00").x * 4.0f);
+    ImGui::InputScalar("##Value", ImGuiDataType_U8, &m_newRegisterCondition.value, nullptr, nullptr, "%02X",
+        ImGuiInputTextFlags_CharsHexadecimal);
+
+    ImGui::SameLine();
+    if (ImGui::Button("Add"))
+    {
+        m_breakpoints.registerConditions.push_back(m_newRegisterCondition);
+        breakpointsChanged = true;
+    }
+    drawRemovableList(m_breakpoints.registerConditions, [](const Breakpoints::RegisterCondition& condition) {
+        return std::format("V{:X} {} 0x{:02X}", condition.registerIndex, s_comparisonSymbols[condition.comparison], condition.value);
+    });
+    ImGui::PopID();
+
+    if (breakpointsChanged)
+    {
+        commands.emplace_back(EmulatorCommands::SetBreakpoints{ m_breakpoints });
+    }
+
+    ImGui::End();
+}
+
+void ImguiRenderer::drawProfilerWindow(const EmulatorSnapshot& snapshot, std::vector<EmulatorCommand>& commands)
+{
+    using Mode = ExecutionProfiler::Mode;
+    using OpcodeDecoder::Operation;
+
+    ImGui::Begin("Profiler");
+
+    static constexpr EnumArray<Mode, const char*> modeNames{ { "Off", "Sampled", "Exact" } };
+    for (std::size_t i{ 0 }; i < modeNames.size(); ++i)
+    {
+        const auto mode{ static_cast<Mode>(i) };
+        if (i > 0)
+        {
+            ImGui::SameLine();
+        }
+        if (ImGui::RadioButton(modeNames[mode], mode == snapshot.profilerMode) && mode != snapshot.profilerMode)
+        {
+            commands.emplace_back(EmulatorCommands::SetProfilerMode{ mode });
+        }
+    }
+    ImGui::SameLine();
+    displayHelpMarker(std::format("Sampled counts every instruction of roughly one frame in {}, and lets the selected "
+        "engine run the rest at full speed. Exact counts every instruction, but runs everything through the interpreter",
+        ExecutionProfiler::s_meanRunsPerSample));
+
+    if (ImGui::Button("Clear"))
+    {
+        commands.emplace_back(EmulatorCommands::ClearProfile{});
+    }
+    ImGui::SameLine();
+    displayText("Instructions counted: {}", snapshot.profileTotalHits);
+
+    const std::span<const uint64_t> hitsAtAddress{ snapshot.profileHitsAtAddress };
+    const double totalHits{ static_cast<double>(std::max(snapshot.profileTotalHits, uint64_t{ 1 })) };
+
+    // Sorts rows by whichever column the user picked, using sortKey(row, columnIndex)
+    const auto sortRows{ [](auto& rows, const auto& sortKey) {
+        const ImGuiTableSortSpecs* sortSpecs{ ImGui::TableGetSortSpecs() };
+        if (!sortSpecs || sortSpecs->SpecsCount == 0)
+        {
+            return;
+        }
+
+        const ImGuiTableColumnSortSpecs& spec{ sortSpecs->Specs[0] };
+        const bool isAscending{ spec.SortDirection == ImGuiSortDirection_Ascending };
+        std::ranges::stable_sort(rows, [&](const auto& lhs, const auto& rhs) {
+            const uint64_t lhsKey{ sortKey(lhs, spec.ColumnIndex) };
+            const uint64_t rhsKey{ sortKey(rhs, spec.ColumnIndex) };
+            return isAscending ? lhsKey < rhsKey : rhsKey < lhsKey;
+        });
+    } };
+
+    constexpr ImGuiTableFlags tableFlags{ ImGuiTableFlags_Sortable | ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersOuter
+                                          | ImGuiTableFlags_ScrollY | ImGuiTableFlags_Resizable };
+
+    ImGui::SeparatorText("Hot Spots");
+
+    // The hottest addresses, picked again every frame since the counts keep changing under them
+    m_hotSpots.clear();
+    for (std::size_t address{ 0 }; address < hitsAtAddress.size(); ++address)
+    {
+        if (hitsAtAddress[address] != 0)
+        {
+            m_hotSpots.push_back(Utility::toU16(address));
+        }
+    }
+    const auto hitsAt{ [&](const uint16_t address) { return hitsAtAddress[address]; } };
+    const std::size_t numHotSpots{ std::min(m_hotSpots.size(), s_maxHotSpots) };
+    std::ranges::partial_sort(m_hotSpots, m_hotSpots.begin() + Utility::toInt(numHotSpots), std::ranges::greater{}, hitsAt);
+    m_hotSpots.resize(numHotSpots);
+
+    if (ImGui::BeginTable("Hot Spots", 4, tableFlags, ImVec2{ 0.0f, ImGui::GetTextLineHeightWithSpacing() * 12.0f }))
+    {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Address");
+        ImGui::TableSetupColumn("Hits", ImGuiTableColumnFlags_DefaultSort | ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableSetupColumn("Share", ImGuiTableColumnFlags_NoSort);
+        ImGui::TableSetupColumn("Instruction", ImGuiTableColumnFlags_NoSort);
+        ImGui::TableHeadersRow();
+
+        sortRows(m_hotSpots, [&](const uint16_t address, const int column) {
+            return column == 0 ? uint64_t{ address } : hitsAt(address);
+        });
+
+        for (const uint16_t address : m_hotSpots)
+        {
+            const std::string_view text{ m_disassemblyCache.disassembleAt(snapshot.chip.memory, address) };
+
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("0x%04X", address);
+            ImGui::TableNextColumn();
+            displayText("{}", hitsAtAddress[address]);
+            ImGui::TableNextColumn();
+            ImGui::Text("%5.1f%%", 100.0 * static_cast<double>(hitsAtAddress[address]) / totalHits);
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(text.data(), text.data() + text.size());
+        }
+        ImGui::EndTable();
+    }
+
+    ImGui::SeparatorText("Operations");
+
+    const EnumArray<Operation, uint64_t>& hitsPerOperation{ snapshot.profileHitsPerOperation };
+    m_hotOperations.clear();
+    for (std::size_t i{ 0 }; i < hitsPerOperation.size(); ++i)
+    {
+        const auto operation{ static_cast<Operation>(i) };
+        if (hitsPerOperation[operation] != 0)
+        {
+            m_hotOperations.push_back(operation);
+        }
+    }
+
+    if (ImGui::BeginTable("Operations", 3, tableFlags, ImVec2{ 0.0f, ImGui::GetTextLineHeightWithSpacing() * 12.0f }))
+    {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Operation");
+        ImGui::TableSetupColumn("Hits", ImGuiTableColumnFlags_DefaultSort | ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableSetupColumn("Share", ImGuiTableColumnFlags_NoSort);
+        ImGui::TableHeadersRow();
+
+        sortRows(m_hotOperations, [&](const Operation operation, const int column) {
+            return column == 0 ? uint64_t{ Utility::toUZ(operation) } : hitsPerOperation[operation];
+        });
+
+        for (const Operation operation : m_hotOperations)
+        {
+            const std::string_view name{ OpcodeDecoder::getOperationName(operation) };
+
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(name.data(), name.data() + name.size());
+            ImGui::TableNextColumn();
+            displayText("{}", hitsPerOperation[operation]);
+            ImGui::TableNextColumn();
+            ImGui::Text("%5.1f%%", 100.0 * static_cast<double>(hitsPerOperation[operation]) / totalHits);
+        }
+        ImGui::EndTable();
+    }
+
+    ImGui::SeparatorText("Routines");
+
+    if (ImGui::Button("Export Folded Stacks"))
+    {
+        commands.emplace_back(EmulatorCommands::ExportFoldedStacks{});
+    }
+    ImGui::SameLine();
+    displayHelpMarker("Writes the call tree in the folded stack format that flamegraph.pl, speedscope and similar read");
+    if (!snapshot.profileExportMessage.empty())
+    {
+        ImGui::SameLine();
+        ImGui::TextUnformatted(snapshot.profileExportMessage.c_str());
+    }
+
+    m_routines.assign(snapshot.profileRoutines.begin(), snapshot.profileRoutines.end());
+
+    if (ImGui::BeginTable("Routines", 4, tableFlags, ImVec2{ 0.0f, ImGui::GetTextLineHeightWithSpacing() * 12.0f }))
+    {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Routine");
+        ImGui::TableSetupColumn("Inclusive", ImGuiTableColumnFlags_DefaultSort | ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableSetupColumn("Exclusive", ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableSetupColumn("Calls", ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableHeadersRow();
+
+        // The top level sorts before every routine by address
+        sortRows(m_routines, [](const ExecutionProfiler::RoutineProfile& routine, const int column) {
+            switch (column)
+            {
+            case 0: return routine.isTopLevel ? uint64_t{ 0 } : uint64_t{ routine.address } + 1;
+            case 1: return routine.inclusiveHits;
+            case 2: return routine.exclusiveHits;
+            default: return routine.numCalls;
+            }
+        });
+
+        ImGuiListClipper clipper{};
+        clipper.Begin(Utility::toInt(m_routines.size()));
+        while (clipper.Step())
+        {
+            for (int row{ clipper.DisplayStart }; row < clipper.DisplayEnd; ++row)
+            {
+                const ExecutionProfiler::RoutineProfile& routine{ m_routines[Utility::toUZ(row)] };
+
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                if (routine.isTopLevel)
+                {
+                    ImGui::TextUnformatted("(top level)");
+                }
+                else
+                {
+                    ImGui::Text("sub_%03X", routine.address);
+                }
+                ImGui::TableNextColumn();
+                ImGui::Text("%s (%.1f%%)", std::format("{}", routine.inclusiveHits).c_str(),
+                    100.0 * static_cast<double>(routine.inclusiveHits) / totalHits);
+                ImGui::TableNextColumn();
+                ImGui::Text("%s (%.1f%%)", std::format("{}", routine.exclusiveHits).c_str(),
+                    100.0 * static_cast<double>(routine.exclusiveHits) / totalHits);
+                ImGui::TableNextColumn();
+                displayText("{}", routine.numCalls);
+            }
+        }
+        clipper.End();
+
+        ImGui::EndTable();
+    }
+
+    ImGui::SeparatorText("Frame Timeline");
+
+    // Recorded by Trace, not the emulation thread, since it times the UI thread too
+    if (!Trace::isRecording())
+    {
+        if (ImGui::Button("Start Trace"))
+        {
+            Trace::startRecording();
+            m_traceMessage = "Recording...";
+        }
+    }
+    else if (ImGui::Button("Stop and Save Trace"))
+    {
+        try
+        {
+            const std::size_t numScopes{ Trace::stopRecording(s_tracePath) };
+            m_traceMessage = std::format("Wrote {} scopes to {}", numScopes, s_tracePath);
+        }
+        catch (const FileInputException& exception)
+        {
+            m_traceMessage = exception.what();
+        }
+    }
+    ImGui::SameLine();
+    displayHelpMarker("Times each part of every frame on both threads, as trace event JSON that chrome://tracing or "
+        "ui.perfetto.dev can open");
+    if (!m_traceMessage.empty())
+    {
+        ImGui::SameLine();
+        ImGui::TextUnformatted(m_traceMessage.c_str());
+    }
+
+    ImGui::End();
+}
+
 void ImguiRenderer::drawColourPicker(std::string_view title, RGBA& colourToEdit) const
 {
     displayText("{}", title);
@@ -340,7 +945,7 @@ void ImguiRenderer::drawTextScaleEditor(const float minTextScale, const float ma
     }
 }
 
-void ImguiRenderer::drawDisplaySettingsWindowAndApplyChanges()
+void ImguiRenderer::drawDisplaySettingsWindowAndApplyChanges(const Renderer& renderer, const EmulatorSnapshot& snapshot)
 {
     ImGui::Begin("Display Settings Menu");
 
@@ -350,6 +955,14 @@ void ImguiRenderer::drawDisplaySettingsWindowAndApplyChanges()
     drawCheckBoxWithDesc("Render Game Display to GUI Window", m_displaySettings->renderGameToImGuiWindow,
             "Choose whether or not to render the game onto a GUI window rather than the main window");
 
+    drawCheckBoxWithDesc("Use Streaming Texture", m_displaySettings->useStreamingTexture,
+            "Write the screen into a 64x32 texture and stretch it over the display in one copy, rather than drawing "
+            "each row of pixels as rectangles");
+
+    const Renderer::DrawCallCounts& drawCallCounts{ renderer.getLastFrameDrawCallCounts() };
+    displayText("Draw calls: {}  Render target switches: {}  Texture uploads: {}",
+        drawCallCounts.drawCalls, drawCallCounts.renderTargetSwitches, drawCallCounts.textureUploads);
+
     drawColourPicker("Off Pixel Colour: ", m_displaySettings->offPixelColour);
     drawColourPicker("On Pixel Colour: ", m_displaySettings->onPixelColour);
     drawColourPicker("Grid Colour: ", m_displaySettings->gridColour);
@@ -358,6 +971,19 @@ void ImguiRenderer::drawDisplaySettingsWindowAndApplyChanges()
     constexpr int maxFPS { 1000 };
     drawIntNumEditor("Target FPS: ", m_displaySettings->targetFPS, minFPS, maxFPS);
 
+    constexpr int minSpinWindowMicroSec{ 0 };
+    constexpr int maxSpinWindowMicroSec{ 5000 };
+    drawIntNumEditor("Frame Spin Window (us): ", m_displaySettings->frameSpinWindowMicroSec,
+        minSpinWindowMicroSec, maxSpinWindowMicroSec);
+
+    constexpr int minRewindMemoryMB{ 1 };
+    constexpr int maxRewindMemoryMB{ 1024 };
+    drawIntNumEditor("Rewind Memory (MB): ", m_displaySettings->rewindMemoryLimitMB, minRewindMemoryMB, maxRewindMemoryMB);
+
+    const std::size_t numRewindFrames{ snapshot.numRewindFrames };
+    displayText("Rewind history: {:.1f}s ({} frames, {} KB)",
+        static_cast<double>(numRewindFrames) / m_displaySettings->targetFPS, numRewindFrames, snapshot.rewindBytesUsed / 1024);
+
     displayText("UI Text Scale:");
     ImGui::SameLine();
 
@@ -390,18 +1016,56 @@ void ImguiRenderer::drawCheckBoxWithDesc(std::string_view title, bool& valueToTo
     }
 }
 
-void ImguiRenderer::drawIPSEditor(Chip8& chip) const
+void ImguiRenderer::drawIPSEditor(const EmulatorSnapshot& snapshot, std::vector<EmulatorCommand>& commands) const
 {
-    int currIPS { chip.getTargetNumInstrPerSecond() };
+    int currIPS { snapshot.targetNumInstrPerSecond };
     int newIPS { currIPS };
     drawIntNumEditor("IPS: ", newIPS);
     if (newIPS != currIPS)
     {
-        chip.setTargetNumInstrPerSecond(newIPS);
+        commands.emplace_back(EmulatorCommands::SetTargetNumInstrPerSecond{ newIPS });
     }
 }
 
-void ImguiRenderer::drawChipSettingsWindow(Chip8::QuirkFlags& chipQuirkFlags, Chip8& chip) const
+void ImguiRenderer::drawExecutionEngineEditor(const EmulatorSnapshot& snapshot, std::vector<EmulatorCommand>& commands) const
+{
+    static constexpr EnumArray<Chip8::ExecutionEngine, const char*> engineNames {
+        "Interpreter",
+        "Basic Block Cache",
+        "x86-64 JIT",
+        "Ahead-of-Time",
+    };
+
+    const Chip8::ExecutionEngine currEngine{ snapshot.executionEngine };
+
+    displayText("Execution Engine: ");
+    ImGui::SameLine();
+    if (ImGui::BeginCombo("##ExecutionEngine", engineNames[currEngine]))
+    {
+        for (std::size_t i{ 0 }; i < engineNames.size(); ++i)
+        {
+            const auto engine{ static_cast<Chip8::ExecutionEngine>(i) };
+            if (engine == Chip8::ExecutionEngine::jit && !X64Recompiler::isSupported())
+            {
+                continue;
+            }
+
+            // Only offered when chip8_aot output for the loaded ROM was linked in
+            if (engine == Chip8::ExecutionEngine::aheadOfTime && !snapshot.hasAotProgram && engine != currEngine)
+            {
+                continue;
+            }
+
+            if (ImGui::Selectable(engineNames[engine], engine == currEngine))
+            {
+                commands.emplace_back(EmulatorCommands::SetExecutionEngine{ engine });
+            }
+        }
+        ImGui::EndCombo();
+    }
+}
+
+void ImguiRenderer::drawChipSettingsWindow(const EmulatorSnapshot& snapshot, std::vector<EmulatorCommand>& commands) const
 {
     ImGui::Begin("Chip Settings");
     displayText("Quirk Flags");
@@ -427,6 +1091,7 @@ void ImguiRenderer::drawChipSettingsWindow(Chip8::QuirkFlags& chipQuirkFlags, Ch
         "Description to be added",
     };
 
+    Chip8::QuirkFlags chipQuirkFlags{ snapshot.chip.quirks };
     std::array quirkFlags {
         std::ref(chipQuirkFlags.resetVF),
         std::ref(chipQuirkFlags.index),
@@ -443,8 +1108,14 @@ void ImguiRenderer::drawChipSettingsWindow(Chip8::QuirkFlags& chipQuirkFlags, Ch
         drawCheckBoxWithDesc(quirkTitle, quirkFlag, quirkDesc);
     }
 
+    if (chipQuirkFlags != snapshot.chip.quirks)
+    {
+        commands.emplace_back(EmulatorCommands::SetQuirks{ chipQuirkFlags });
+    }
+
     ImGui::Separator();
-    drawIPSEditor(chip);
+    drawIPSEditor(snapshot, commands);
+    drawExecutionEngineEditor(snapshot, commands);
 
     ImGui::End();
 }
@@ -466,13 +1137,13 @@ void ImguiRenderer::drawGameDisplayWindow(SDL_Texture* gameFrame) const
     ImGui::End();
 }
 
-void ImguiRenderer::drawStackDisplayWindow(const std::vector<uint16_t>& stackContents) const
+void ImguiRenderer::drawStackDisplayWindow(const std::span<const uint16_t> stackContents, const std::size_t maxStackDepth) const
 {
     ImGui::Begin("Stack Viewer");
     ImGui::Columns(2);
 
     displayText("Depth");
-    for (const auto& i : std::views::iota(0u, stackContents.capacity()))
+    for (const auto& i : std::views::iota(0u, maxStackDepth))
     {
         displayText("{:2} ... ", i);
     }
@@ -490,7 +1161,7 @@ void ImguiRenderer::drawStackDisplayWindow(const std::vector<uint16_t>& stackCon
         }
     }
 
-    const std::size_t numEmptyStackSlots{ stackContents.capacity() - stackContents.size() };
+    const std::size_t numEmptyStackSlots{ maxStackDepth - stackContents.size() };
     for (std::size_t i{ 0 } ; i < numEmptyStackSlots; ++i)
     {
         displayText("{}  0x{:04X}", 0, 0);
@@ -499,7 +1170,7 @@ void ImguiRenderer::drawStackDisplayWindow(const std::vector<uint16_t>& stackCon
     ImGui::End();
 }
 
-void ImguiRenderer::drawROMSelectWindow(Chip8& chip)
+void ImguiRenderer::drawROMSelectWindow(std::vector<EmulatorCommand>& commands)
 {
     ImGui::Begin("ROM Select");
     if (ImGui::Button("Select ROM"))
@@ -515,17 +1186,7 @@ void ImguiRenderer::drawROMSelectWindow(Chip8& chip)
             std::string filePathName = ImGuiFileDialog::Instance()->GetFilePathName();
             std::string filePath = ImGuiFileDialog::Instance()->GetCurrentPath();
 
-            chip = Chip8{};
-            try
-            {
-                chip.loadFile(filePathName);
-            }
-            catch (const FileInputException& exception)
-            {
-                ImGuiFileDialog::Instance()->Close();
-                ImGui::End();
-                throw;
-            }
+            commands.emplace_back(EmulatorCommands::LoadRom{ filePathName });
         }
         ImGuiFileDialog::Instance()->Close();
 
@@ -533,10 +1194,56 @@ void ImguiRenderer::drawROMSelectWindow(Chip8& chip)
     ImGui::End();
 }
 
+void ImguiRenderer::drawSaveStatesWindow(const EmulatorSnapshot& snapshot, std::vector<EmulatorCommand>& commands)
+{
+    ImGui::Begin("Save States");
+    displayText("F5 to save, F9 to load, F6/F7 to change slot");
+
+    for (int slot{ 0 }; slot < SaveStateSlots::s_numSlots; ++slot)
+    {
+        ImGui::PushID(slot);
+
+        if (ImGui::RadioButton(std::format("Slot {}", slot).c_str(), snapshot.selectedSaveSlot == slot))
+        {
+            commands.emplace_back(EmulatorCommands::SelectSaveSlot{ slot });
+        }
+
+        ImGui::SameLine();
+        ImGui::BeginDisabled(!snapshot.chip.runtimeMetaData.romIsLoaded);
+        if (ImGui::Button("Save"))
+        {
+            commands.emplace_back(EmulatorCommands::SaveToSlot{ slot });
+        }
+        ImGui::EndDisabled();
+
+        const bool isOccupied{ snapshot.isSaveSlotOccupied[Utility::toUZ(slot)] };
+        ImGui::SameLine();
+        ImGui::BeginDisabled(!isOccupied);
+        if (ImGui::Button("Load"))
+        {
+            commands.emplace_back(EmulatorCommands::LoadFromSlot{ slot });
+        }
+        ImGui::EndDisabled();
+
+        ImGui::SameLine();
+        displayText("{}", isOccupied ? "Saved" : "Empty");
+
+        ImGui::PopID();
+    }
+
+    if (!snapshot.saveStateErrorMessage.empty())
+    {
+        ImGui::TextColored(red, "%s", snapshot.saveStateErrorMessage.c_str());
+    }
+
+    ImGui::End();
+}
+
 void ImguiRenderer::drawAllImguiWindows(
     std::shared_ptr<DisplaySettings> displaySettings,
     Renderer& renderer,
-    Chip8& chip, const StateManager& stateManager,
+    const EmulatorSnapshot& snapshot,
+    std::vector<EmulatorCommand>& commands,
     const FrameInfo& frameInfo,
     const bool isAudioLoaded)
 {
@@ -544,38 +1251,41 @@ void ImguiRenderer::drawAllImguiWindows(
     ImGui_ImplSDLRenderer2_NewFrame();
     ImGui::NewFrame();
 
-    drawGeneralInfoWindow (
-        frameInfo,
-        chip.getSoundTimer(),
-        stateManager,
-        chip.getRuntimeMetaData().numInstructionsExecuted,
-        isAudioLoaded
-    );
-
-    drawMemoryViewerWindow(chip);
-    drawRegisterViewerWindow(chip);
-    drawStackDisplayWindow(chip.getStackContents());
-
-    drawDisplaySettingsWindowAndApplyChanges();
-    drawChipSettingsWindow(chip.getEnabledQuirks(), chip);
+    m_windowTimes = {};
+
+    timeWindow(Window::generalInfo, [&] {
+        drawGeneralInfoWindow (
+            frameInfo,
+            snapshot.chip.soundTimer,
+            snapshot.stateManager,
+            snapshot.chip.runtimeMetaData.numInstructionsExecuted,
+            isAudioLoaded
+        );
+    });
+
+    timeWindow(Window::memoryViewer, [&] { drawMemoryViewerWindow(snapshot); });
+    timeWindow(Window::registerViewer, [&] { drawRegisterViewerWindow(snapshot.chip, snapshot.debugGenerations); });
+    timeWindow(Window::stackViewer, [&] {
+        const std::span<const uint16_t> stackContents{ snapshot.chip.stack.data(), snapshot.chip.stackDepth };
+        drawStackDisplayWindow(stackContents, snapshot.chip.stack.size());
+    });
+    timeWindow(Window::disassembly, [&] { drawDisassemblyWindow(snapshot.chip); });
+    timeWindow(Window::breakpoints, [&] { drawBreakpointsWindow(snapshot, commands); });
+    timeWindow(Window::profiler, [&] { drawProfilerWindow(snapshot, commands); });
+
+    timeWindow(Window::displaySettings, [&] { drawDisplaySettingsWindowAndApplyChanges(renderer, snapshot); });
+    timeWindow(Window::chipSettings, [&] { drawChipSettingsWindow(snapshot, commands); });
 
     if (displaySettings -> renderGameToImGuiWindow)
     {
         SDL_Texture* currGameFrame { renderer.getCurrentGameFrame() };
-        drawGameDisplayWindow(currGameFrame);
+        timeWindow(Window::gameDisplay, [&] { drawGameDisplayWindow(currGameFrame); });
     }
 
+    timeWindow(Window::saveStates, [&] { drawSaveStatesWindow(snapshot, commands); });
+
     //drawKeyboardInputWindow();
-    try
-    {
-        drawROMSelectWindow(chip);
-    }
-    catch (const FileInputException& exception)
-    {
-        ImGui::Render();
-        ImGui_ImplSDLRenderer2_RenderDrawData(ImGui::GetDrawData(), renderer.getRenderer());
-        throw;
-    }
+    timeWindow(Window::romSelect, [&] { drawROMSelectWindow(commands); });
 
     ImGui::Render();
     ImGui_ImplSDLRenderer2_RenderDrawData(ImGui::GetDrawData(), renderer.getRenderer());
@@ -1,32 +1,22 @@
 #include "inputhandler.h"
 #include "chip8.h"
+#include "imgui.h"
 #include "imgui_impl_sdl2.h"
 #include <algorithm>
-void InputHandler::readSystemInputs()
+void InputHandler::readInputs()
 {
     SDL_Event event{};
 
     while (SDL_PollEvent(&event) != 0)
     {
         ImGui_ImplSDL2_ProcessEvent(&event);
+        checkForChipInput(event);
         checkForSystemInput(event);
     }
 }
 
-void InputHandler::readChipAndSystemInputs(Chip8& chip)
-{
-    SDL_Event event{};
 
-    while (SDL_PollEvent(&event) != 0)
-    {
-        ImGui_ImplSDL2_ProcessEvent(&event);
-        checkForChipInput(event, chip);
-        checkForSystemInput(event);
-    }
-}
-
-
-void InputHandler::checkForChipInput(const SDL_Event& event, Chip8& chip)
+void InputHandler::checkForChipInput(const SDL_Event& event)
 {
     if (event.type == SDL_KEYDOWN)
     {
@@ -36,7 +26,7 @@ void InputHandler::checkForChipInput(const SDL_Event& event, Chip8& chip)
             auto keyIndex{ std::distance(chipKeyMap.begin(), iteratorAtValidKey) };
             Chip8::KeyInputs keyInput { static_cast<Chip8::KeyInputs>(keyIndex) };
 
-            chip.setKeyDown(keyInput);
+            m_isChipKeyDown[keyInput] = true;
         }
     }
     else if (event.type == SDL_KEYUP)
@@ -47,11 +37,20 @@ void InputHandler::checkForChipInput(const SDL_Event& event, Chip8& chip)
             auto keyIndex{ std::distance(chipKeyMap.begin(), iteratorAtValidKey) };
             Chip8::KeyInputs keyInput { static_cast<Chip8::KeyInputs>(keyIndex) };
 
-            chip.setKeyUp(keyInput);
+            m_isChipKeyDown[keyInput] = false;
         }
     }
 }
 
+bool InputHandler::isSystemKeyHeld(const SystemKeyInputs key) const
+{
+    // SDL_GetKeyboardState() doesn't know about ImGui, so Backspace would rewind while it deletes text in an input field
+    if (ImGui::GetIO().WantCaptureKeyboard) { return false; }
+
+    const Uint8* keyboardState{ SDL_GetKeyboardState(nullptr) };
+    return keyboardState[systemKeyMap[key]] != 0;
+}
+
 void InputHandler::checkForSystemInput(const SDL_Event event)
 {
     if (event.type == SDL_QUIT) { m_isSystemKeyPressed[SystemKeyInputs::K_QUIT] = true; }
@@ -63,6 +62,11 @@ void InputHandler::checkForSystemInput(const SDL_Event event)
         auto keyIndex{ std::distance(systemKeyMap.begin(), iteratorAtValidKey) };
         SystemKeyInputs keyInput { static_cast<SystemKeyInputs>(keyIndex) };
 
+        // ImGui moves keyboard focus with Tab, which shouldn't also start fast forwarding the game behind it
+        const bool isFastForwardKey{ keyInput == SystemKeyInputs::K_FAST_FORWARD
+                                     || keyInput == SystemKeyInputs::K_TOGGLE_FAST_FORWARD };
+        if (isFastForwardKey && ImGui::GetIO().WantCaptureKeyboard) { return; }
+
         m_isSystemKeyPressed[keyInput] = true;
     }
 }
@@ -0,0 +1,189 @@
+#include "inputmovie.h"
+
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <string_view>
+
+#include "savestatefile.h"
+#include "exceptions/fileinputexception.h"
+#include "utils/bytestream.h"
+
+namespace
+{
+    using KeyInputs = Chip8::KeyInputs;
+
+    constexpr std::string_view s_magic{ "C8MV" };
+
+    uint16_t getKeysDownMask(const Chip8& chip)
+    {
+        const auto& keysDown{ chip.getKeysDownThisFrame() };
+
+        uint16_t mask{ 0 };
+        for (std::size_t key{ 0 }; key < keysDown.size(); ++key)
+        {
+            mask |= Utility::toU16(keysDown.data()[key] ? 1u << key : 0u);
+        }
+        return mask;
+    }
+
+    void setKeysDown(Chip8& chip, const uint16_t mask)
+    {
+        for (int key{ 0 }; key < Utility::toInt(KeyInputs::MAX_VALUE); ++key)
+        {
+            if ((mask >> key) & 1)
+            {
+                chip.setKeyDown(static_cast<KeyInputs>(key));
+            }
+            else
+            {
+                chip.setKeyUp(static_cast<KeyInputs>(key));
+            }
+        }
+    }
+}
+
+InputMovie::InputMovie(const Chip8::SaveState& startState, const uint64_t randomSeed)
+: m_startState{ startState }
+, m_randomSeed{ randomSeed }
+{
+}
+
+InputMovie InputMovie::startRecording(Chip8& chip, const uint64_t randomSeed)
+{
+    chip.seedRandom(randomSeed);
+    return InputMovie{ chip.saveState(), randomSeed };
+}
+
+void InputMovie::recordFrame(const Chip8& chip, const int numInstructions)
+{
+    const Run frame{ .numFrames = 1, .keysDown = getKeysDownMask(chip), .instructionsPerFrame = Utility::toU32(numInstructions) };
+
+    const bool continuesLastRun{ !m_runs.empty() && m_runs.back().keysDown == frame.keysDown
+                                 && m_runs.back().instructionsPerFrame == frame.instructionsPerFrame };
+    if (continuesLastRun)
+    {
+        ++m_runs.back().numFrames;
+    }
+    else
+    {
+        m_runs.push_back(frame);
+    }
+
+    ++m_numFrames;
+}
+
+void InputMovie::write(const std::filesystem::path& path) const
+{
+    std::vector<uint8_t> bytes{};
+    ByteWriter writer{ bytes };
+
+    for (const char character : s_magic)
+    {
+        writer.write(static_cast<uint8_t>(character));
+    }
+    writer.write(s_version);
+    writer.write(m_randomSeed);
+
+    const std::vector<uint8_t> startState{ SaveStateFile::serialize(m_startState) };
+    writer.write(Utility::toU32(startState.size()));
+    writer.writeBytes(startState);
+
+    writer.write(Utility::toU32(m_runs.size()));
+    for (const Run& run : m_runs)
+    {
+        writer.writeVarint(run.numFrames);
+        writer.write(run.keysDown);
+        writer.writeVarint(run.instructionsPerFrame);
+    }
+
+    std::ofstream file{ path, std::ios::binary };
+    file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+
+    if (!file)
+    {
+        throw FileInputException("Error writing input movie. Path: " + path.string());
+    }
+}
+
+InputMovie InputMovie::read(const std::filesystem::path& path)
+{
+    std::ifstream file{ path, std::ios::binary };
+    if (!file)
+    {
+        throw FileInputException("Error opening input movie. Path: " + path.string());
+    }
+
+    const std::vector<uint8_t> bytes{ std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
+    ByteReader reader{ bytes, "Input movie" };
+
+    for (const char character : s_magic)
+    {
+        if (reader.read<uint8_t>() != static_cast<uint8_t>(character))
+        {
+            throw FileInputException("Not an input movie. Path: " + path.string());
+        }
+    }
+
+    const uint16_t fileVersion{ reader.read<uint16_t>() };
+    if (fileVersion != s_version)
+    {
+        throw FileInputException(std::format("Input movie is version {}, only version {} is supported. Path: {}",
+            fileVersion, s_version, path.string()));
+    }
+
+    const uint64_t randomSeed{ reader.read<uint64_t>() };
+    const uint32_t startStateSize{ reader.read<uint32_t>() };
+    InputMovie movie{ SaveStateFile::deserialize(reader.take(startStateSize)), randomSeed };
+
+    const uint32_t numRuns{ reader.read<uint32_t>() };
+    for (uint32_t i{ 0 }; i < numRuns; ++i)
+    {
+        Run run{};
+        run.numFrames = static_cast<uint32_t>(reader.readVarint());
+        run.keysDown = reader.read<uint16_t>();
+        run.instructionsPerFrame = static_cast<uint32_t>(reader.readVarint());
+        if (run.numFrames == 0)
+        {
+            throw FileInputException("Input movie has an empty run. Path: " + path.string());
+        }
+
+        movie.m_runs.push_back(run);
+        movie.m_numFrames += run.numFrames;
+    }
+
+    if (!reader.isAtEnd())
+    {
+        throw FileInputException("Input movie has trailing data. Path: " + path.string());
+    }
+
+    return movie;
+}
+
+InputMoviePlayer::InputMoviePlayer(InputMovie movie, Chip8& chip)
+: m_movie{ std::move(movie) }
+{
+    chip.loadState(m_movie.getStartState());
+}
+
+void InputMoviePlayer::runFrame(Chip8& chip)
+{
+    if (isFinished())
+    {
+        return;
+    }
+
+    const InputMovie::Run& run{ m_movie.getRuns()[m_currentRun] };
+    setKeysDown(chip, run.keysDown);
+
+    chip.decrementTimers();
+    chip.executeInstructions(Utility::toInt(run.instructionsPerFrame));
+    chip.setPrevFrameInputs();
+
+    ++m_currentFrame;
+    if (++m_framesIntoRun == run.numFrames)
+    {
+        ++m_currentRun;
+        m_framesIntoRun = 0;
+    }
+}
@@ -0,0 +1,25 @@
+#include "opcodedecoder.h"
+
+namespace OpcodeDecoder
+{
+    namespace
+    {
+        constexpr DecodeTable buildDecodeTable()
+        {
+            DecodeTable table{};
+            for (std::size_t opcode{ 0 }; opcode < s_numOpcodes; ++opcode)
+            {
+                table[opcode] = decode(Utility::toU16(opcode));
+            }
+            return table;
+        }
+    }
+
+    constinit const DecodeTable s_decodeTable{ buildDecodeTable() };
+
+    static_assert(decode(0x00E0).operation == Operation::op00E0);
+    static_assert(decode(0xD12F).operation == Operation::opDXYN);
+    static_assert(decode(0xF265).x == 0x2);
+    static_assert(decode(0x8AB9).operation == Operation::invalid);
+    static_assert(getOperationName(Operation::invalid) == "Invalid");
+}
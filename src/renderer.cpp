@@ -90,7 +90,7 @@ Renderer::Renderer(std::shared_ptr<DisplaySettings> displaySettings)
         throw SDLInitException("SDL_ttf could not initialize! TTF_Error: " + errorMsg);
     }
 
-    m_defaultFont.reset(TTF_OpenFont("assets/fonts/anonymous.ttf", 24));
+    m_defaultFont.reset(TTF_OpenFont("assets/fonts/anonymous.ttf", s_defaultFontSize));
 
     if (!m_defaultFont)
     {
@@ -103,6 +103,9 @@ Renderer::Renderer(std::shared_ptr<DisplaySettings> displaySettings)
 Renderer::~Renderer() noexcept
 {
     m_currentGameFrame.reset();
+    m_screenLayer.reset();
+    m_gridLayer.reset();
+    m_textTextures.clear();
     m_defaultFont.reset();
     
     m_renderer.reset();
@@ -114,12 +117,23 @@ Renderer::~Renderer() noexcept
 
 
 
+int Renderer::getDisplayRefreshRate() const
+{
+    SDL_DisplayMode displayMode{};
+    if (SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(m_window.get()), &displayMode) != 0)
+    {
+        return 0;
+    }
+
+    return displayMode.refresh_rate;
+}
+
 void Renderer::clearDisplay() const
 {
-    SDL_SetRenderTarget(m_renderer.get(), m_currentGameFrame.get());
+    setRenderTarget(m_currentGameFrame.get());
     clearDisplay(m_displaySettings -> offPixelColour);
 
-    SDL_SetRenderTarget(m_renderer.get(), nullptr);
+    setRenderTarget(nullptr);
     clearDisplay(m_displaySettings -> offPixelColour);
 }
 
@@ -128,92 +142,381 @@ void Renderer::clearDisplay(const RGBA colour) const
     SDL_Renderer* renderer{ m_renderer.get() };
     SDL_SetRenderDrawColor(renderer, colour.red, colour.green, colour.blue, colour.alpha);
     SDL_RenderClear(renderer);
+    ++m_drawCallCounts.drawCalls;
 }
 
 void Renderer::drawGrid(const int pixelWidth, const int pixelHeight, int horizontalPixelAmount, int verticalPixelAmount)
 {
-    RGBA gridColour{ m_displaySettings -> gridColour };
-    SDL_SetRenderDrawColor(m_renderer.get(), gridColour.red, gridColour.green, gridColour.blue, gridColour.alpha);
-
     int frameWidth{ m_displaySettings -> mainWindowWidth };
     int frameHeight{ m_displaySettings -> mainWindowHeight };
 
     if (m_displaySettings->renderGameToImGuiWindow)
     {
-        SDL_SetRenderTarget(m_renderer.get(), m_currentGameFrame.get());
         frameWidth = m_displaySettings -> gameDisplayTextureWidth;
         frameHeight = m_displaySettings -> gameDisplayTextureHeight;
     }
 
+    prepareGridLayer({
+        .pixelWidth = pixelWidth,
+        .pixelHeight = pixelHeight,
+        .numColumns = horizontalPixelAmount,
+        .numRows = verticalPixelAmount,
+        .frameWidth = std::max(frameWidth, 1),
+        .frameHeight = std::max(frameHeight, 1),
+        .gridColour = m_displaySettings -> gridColour
+    });
+
+    if (m_displaySettings->renderGameToImGuiWindow)
+    {
+        setRenderTarget(m_currentGameFrame.get());
+    }
+
+    const SDL_Rect gridRect{ 0, 0, m_gridLayerProperties.frameWidth, m_gridLayerProperties.frameHeight };
+    SDL_RenderCopy(m_renderer.get(), m_gridLayer.get(), nullptr, &gridRect);
+    ++m_drawCallCounts.drawCalls;
+
+    if (m_displaySettings->renderGameToImGuiWindow)
+    {
+        setRenderTarget(nullptr);
+    }
+}
+
+void Renderer::prepareGridLayer(const GridLayerProperties& properties)
+{
+    if (m_gridLayer != nullptr && properties == m_gridLayerProperties)
+    {
+        return;
+    }
+
+    const bool layerNeedsRecreating{ m_gridLayer == nullptr
+                                     || properties.frameWidth != m_gridLayerProperties.frameWidth
+                                     || properties.frameHeight != m_gridLayerProperties.frameHeight };
+
+    if (layerNeedsRecreating)
+    {
+        m_gridLayer.reset(
+            SDL_CreateTexture(m_renderer.get(), SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET,
+                              properties.frameWidth, properties.frameHeight)
+        );
+
+        if (m_gridLayer == nullptr)
+        {
+            std::string errorMsg{ SDL_GetError() };
+            throw SDLInitException("Failed to create texture gridLayer. SDL_Error: " + errorMsg);
+        }
+
+        // Everything between the lines is left transparent, so the screen shows through it
+        SDL_SetTextureBlendMode(m_gridLayer.get(), SDL_BLENDMODE_BLEND);
+    }
+
+    m_gridLayerProperties = properties;
+
     SDL_Renderer* renderer{ m_renderer.get() };
-    for (int i{ 0 }; i < horizontalPixelAmount ; ++i)
+    SDL_Texture* const previousTarget{ SDL_GetRenderTarget(renderer) };
+    setRenderTarget(m_gridLayer.get());
+
+    clearDisplay(RGBA{ 0x00, 0x00, 0x00, 0x00 });
+
+    const RGBA gridColour{ properties.gridColour };
+    SDL_SetRenderDrawColor(renderer, gridColour.red, gridColour.green, gridColour.blue, gridColour.alpha);
+
+    const int frameWidth{ properties.frameWidth };
+    const int frameHeight{ properties.frameHeight };
+
+    for (int i{ 0 }; i < properties.numColumns; ++i)
     {
-        int xCoord{ i * pixelWidth };
+        int xCoord{ i * properties.pixelWidth };
         SDL_RenderDrawLine(renderer, xCoord, 0, xCoord, frameHeight);
     }
     SDL_RenderDrawLine(renderer, 0, frameHeight-1, frameWidth, frameHeight-1);
 
-    for (int i{ 0 }; i < verticalPixelAmount; ++i)
+    for (int i{ 0 }; i < properties.numRows; ++i)
     {
-        int yCoord{ i * pixelHeight };
+        int yCoord{ i * properties.pixelHeight };
         SDL_RenderDrawLine(renderer, 0, yCoord, frameWidth, yCoord);
     }
     SDL_RenderDrawLine(renderer, frameWidth-1, 0, frameWidth-1, frameHeight);
 
+    m_drawCallCounts.drawCalls += properties.numColumns + properties.numRows + 2;
+
+    setRenderTarget(previousTarget);
+}
+
+void Renderer::drawTextAt(const std::string_view text, const int xPos, const int yPos)
+{
+    const TextTexture* const textTexture{ findOrCreateTextTexture(text, RGBA::pureGreen()) };
+    if (textTexture == nullptr)
+    {
+        return;
+    }
+
     if (m_displaySettings->renderGameToImGuiWindow)
     {
-        SDL_SetRenderTarget(m_renderer.get(), nullptr);
+        setRenderTarget(m_currentGameFrame.get());
+    }
+
+    SDL_Rect textRect{ xPos, yPos, textTexture->width, textTexture->height };
+
+    SDL_RenderCopy(m_renderer.get(), textTexture->texture.get(), nullptr, &textRect);
+    ++m_drawCallCounts.drawCalls;
+
+    if (m_displaySettings->renderGameToImGuiWindow)
+    {
+        setRenderTarget(nullptr);
     }
 }
 
-void Renderer::drawTextAt(const std::string_view text, const int xPos, const int yPos)
+const Renderer::TextTexture* Renderer::findOrCreateTextTexture(const std::string_view text, const RGBA colour)
 {
-    if (m_displaySettings->renderGameToImGuiWindow)
+    const TextTextureKeyView keyView{ text, colour, s_defaultFontSize };
+    if (const auto cached{ m_textTextures.find(keyView) }; cached != m_textTextures.end())
     {
-        SDL_SetRenderTarget(m_renderer.get(), m_currentGameFrame.get());
+        return &cached->second;
     }
 
-    const RGBA textColour{ RGBA::pureGreen() };
+    if (m_textTextures.size() >= s_maxCachedTextTextures)
+    {
+        m_textTextures.clear();
+    }
+
+    // SDL_ttf wants a null terminated string, which a string_view doesn't promise
+    TextTextureKey key{ std::string{ text }, colour, s_defaultFontSize };
+
     std::unique_ptr<SDL_Surface, decltype(&SDL_FreeSurface)> textSurface{
-        TTF_RenderText_Solid(m_defaultFont.get(), text.data(), textColour),
+        TTF_RenderText_Solid(m_defaultFont.get(), key.text.c_str(), colour),
         &SDL_FreeSurface
     };
 
-    std::unique_ptr<SDL_Texture, decltype(&SDL_DestroyTexture)> textTexture{
-        SDL_CreateTextureFromSurface(m_renderer.get(), textSurface.get()),
-        &SDL_DestroyTexture
-    };
+    if (textSurface == nullptr)
+    {
+        return nullptr;
+    }
 
-    int textWidth{};
-    int textHeight{};
-    TTF_SizeText(m_defaultFont.get(), text.data(), &textWidth, &textHeight);
+    TextTexture textTexture{};
+    textTexture.texture.reset(SDL_CreateTextureFromSurface(m_renderer.get(), textSurface.get()));
+    textTexture.width = textSurface->w;
+    textTexture.height = textSurface->h;
+    ++m_drawCallCounts.textureUploads;
 
-    SDL_Rect textRect{ xPos, yPos, textWidth, textHeight };
+    if (textTexture.texture == nullptr)
+    {
+        return nullptr;
+    }
 
-    SDL_RenderCopy(m_renderer.get(), textTexture.get(), nullptr, &textRect);
+    return &m_textTextures.emplace(std::move(key), std::move(textTexture)).first->second;
+}
 
-    if (m_displaySettings->renderGameToImGuiWindow)
+std::size_t Renderer::TextTextureKeyHash::operator()(const TextTextureKeyView& key) const noexcept
+{
+    const uint32_t colour{ (uint32_t{ key.colour.red } << 24) | (uint32_t{ key.colour.green } << 16)
+                           | (uint32_t{ key.colour.blue } << 8) | key.colour.alpha };
+
+    std::size_t hash{ std::hash<std::string_view>{}(key.text) };
+    hash ^= std::hash<uint32_t>{}(colour) + 0x9E3779B97F4A7C15 + (hash << 6) + (hash >> 2);
+    hash ^= std::hash<int>{}(key.fontSize) + 0x9E3779B97F4A7C15 + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+SDL_Point Renderer::beginGameFrame()
+{
+    SDL_Point gameFrameSize{};
+
+    if (m_displaySettings -> renderGameToImGuiWindow)
     {
-        SDL_SetRenderTarget(m_renderer.get(), nullptr);
+        setRenderTarget(m_currentGameFrame.get());
+
+        SDL_QueryTexture(m_currentGameFrame.get(), nullptr, nullptr,
+            &gameFrameSize.x, &gameFrameSize.y);
     }
+    else
+    {
+        gameFrameSize.x = m_displaySettings -> mainWindowWidth;
+        gameFrameSize.y = m_displaySettings -> mainWindowHeight;
+    }
+
+    return gameFrameSize;
 }
 
-void Renderer::renderPixel(const Pixel &pixel) const
+void Renderer::endGameFrame()
 {
-    if (m_displaySettings->renderGameToImGuiWindow)
+    if (m_displaySettings -> renderGameToImGuiWindow)
     {
-        SDL_SetRenderTarget(m_renderer.get(), m_currentGameFrame.get());
+        setRenderTarget(nullptr);
     }
+}
+
+void Renderer::setRenderTarget(SDL_Texture* const target) const
+{
+    SDL_SetRenderTarget(m_renderer.get(), target);
+    ++m_drawCallCounts.renderTargetSwitches;
+}
 
-    SDL_SetRenderDrawColor(m_renderer.get(),
-        pixel.colour.red, pixel.colour.green, pixel.colour.blue, pixel.colour.alpha);
+void Renderer::drawScreenRows(const std::span<const uint64_t> screenRows, const uint32_t dirtyRowMask)
+{
+    constexpr int numColumns{ 64 };
+    const int numRows{ Utility::toInt(screenRows.size()) };
 
-    SDL_RenderFillRect(m_renderer.get(), &pixel.rect);
+    const SDL_Point gameFrameSize{ beginGameFrame() };
 
-    if (m_displaySettings->renderGameToImGuiWindow)
+    ScreenLayerProperties properties{
+        .pixelWidth = gameFrameSize.x / numColumns,
+        .pixelHeight = gameFrameSize.y / numRows,
+        .onPixelColour = m_displaySettings -> onPixelColour,
+        .offPixelColour = m_displaySettings -> offPixelColour,
+        .isStreamingTexture = m_displaySettings -> useStreamingTexture && !m_hasStreamingTextureFailed
+    };
+
+    const uint32_t allRows{ numRows >= 32 ? ~uint32_t{ 0 } : (uint32_t{ 1 } << numRows) - 1 };
+    const uint32_t rowsToRedraw{ prepareScreenLayer(properties, numRows) ? allRows : (dirtyRowMask & allRows) };
+    if (rowsToRedraw != 0)
+    {
+        if (!properties.isStreamingTexture)
+        {
+            redrawScreenLayerRows(screenRows, rowsToRedraw);
+        }
+        else if (!uploadScreenLayerRows(screenRows, rowsToRedraw))
+        {
+            // Reported once rather than every frame. This frame is drawn again into a fresh render target texture
+            std::cerr << "Failed to lock screen texture, drawing the screen without it from now on. SDL_Error: "
+                      << SDL_GetError() << std::endl;
+            m_hasStreamingTextureFailed = true;
+
+            properties.isStreamingTexture = false;
+            prepareScreenLayer(properties, numRows);
+            redrawScreenLayerRows(screenRows, allRows);
+        }
+    }
+
+    // The streaming texture is one texel per CHIP-8 pixel, so this is also where it gets scaled up
+    const SDL_Rect screenRect{ 0, 0, properties.pixelWidth * numColumns, properties.pixelHeight * numRows };
+    SDL_RenderCopy(m_renderer.get(), m_screenLayer.get(), nullptr, &screenRect);
+    ++m_drawCallCounts.drawCalls;
+
+    if (m_displaySettings -> gridOn)
+    {
+        drawGrid(properties.pixelWidth, properties.pixelHeight, numColumns, numRows);
+    }
+
+    endGameFrame();
+}
+
+bool Renderer::prepareScreenLayer(const ScreenLayerProperties& properties, const int numRows)
+{
+    constexpr int numColumns{ 64 };
+
+    const SDL_Point layerSize{ properties.isStreamingTexture
+                               ? SDL_Point{ numColumns, numRows }
+                               : SDL_Point{ std::max(properties.pixelWidth * numColumns, 1),
+                                            std::max(properties.pixelHeight * numRows, 1) } };
+
+    const bool layerNeedsRecreating{ m_screenLayer == nullptr
+                                     || properties.isStreamingTexture != m_screenLayerProperties.isStreamingTexture
+                                     || layerSize.x != m_screenLayerSize.x || layerSize.y != m_screenLayerSize.y };
+
+    if (layerNeedsRecreating)
+    {
+        const int textureAccess{ properties.isStreamingTexture ? SDL_TEXTUREACCESS_STREAMING : SDL_TEXTUREACCESS_TARGET };
+        m_screenLayer.reset(
+            SDL_CreateTexture(m_renderer.get(), SDL_PIXELFORMAT_ARGB8888, textureAccess, layerSize.x, layerSize.y)
+        );
+
+        if (m_screenLayer == nullptr)
+        {
+            std::string errorMsg{ SDL_GetError() };
+            throw SDLInitException("Failed to create texture screenLayer. SDL_Error: " + errorMsg);
+        }
+
+        // Pixels have to stay sharp edged when the streaming texture is stretched over the frame
+        SDL_SetTextureScaleMode(m_screenLayer.get(), SDL_ScaleModeNearest);
+        m_screenLayerSize = layerSize;
+    }
+    else if (properties == m_screenLayerProperties)
     {
-        SDL_SetRenderTarget(m_renderer.get(), nullptr);
+        return false;
     }
+
+    m_screenLayerProperties = properties;
+    return true;
 }
 
+void Renderer::redrawScreenLayerRows(const std::span<const uint64_t> screenRows, uint32_t rowMask) const
+{
+    constexpr int numColumns{ 64 };
+
+    const int pixelWidth{ m_screenLayerProperties.pixelWidth };
+    const int pixelHeight{ m_screenLayerProperties.pixelHeight };
+
+    SDL_Renderer* renderer{ m_renderer.get() };
+    SDL_Texture* const previousTarget{ SDL_GetRenderTarget(renderer) };
+    setRenderTarget(m_screenLayer.get());
+
+    while (rowMask != 0)
+    {
+        const int y{ std::countr_zero(rowMask) };
+        rowMask &= rowMask - 1;
+
+        const uint64_t row{ screenRows[Utility::toUZ(y)] };
+
+        // Every run of same coloured pixels in the row is drawn as one rect rather than pixel by pixel
+        int runStartX{ 0 };
+        while (runStartX < numColumns)
+        {
+            const uint64_t rowFromRunStart{ row << runStartX };
+            const bool pixelOn{ (rowFromRunStart >> (numColumns - 1)) != 0 };
 
+            // Zeroes get shifted in on the right, so an off run could appear to carry on past the end of the row
+            const int runLength{ std::min(std::countl_zero(pixelOn ? ~rowFromRunStart : rowFromRunStart),
+                                          numColumns - runStartX) };
+
+            const RGBA colour{ pixelOn ? m_screenLayerProperties.onPixelColour : m_screenLayerProperties.offPixelColour };
+            const SDL_Rect pixelRun{ runStartX * pixelWidth, y * pixelHeight, runLength * pixelWidth, pixelHeight };
+
+            SDL_SetRenderDrawColor(renderer, colour.red, colour.green, colour.blue, colour.alpha);
+            SDL_RenderFillRect(renderer, &pixelRun);
+            ++m_drawCallCounts.drawCalls;
+
+            runStartX += runLength;
+        }
+    }
+
+    setRenderTarget(previousTarget);
+}
+
+bool Renderer::uploadScreenLayerRows(const std::span<const uint64_t> screenRows, const uint32_t rowMask) const
+{
+    constexpr int numColumns{ 64 };
+
+    const auto toARGB8888 = [](const RGBA colour) {
+        return (uint32_t{ colour.alpha } << 24) | (uint32_t{ colour.red } << 16) | (uint32_t{ colour.green } << 8) | colour.blue;
+    };
+    const std::array<uint32_t, 2> palette{ toARGB8888(m_screenLayerProperties.offPixelColour),
+                                           toARGB8888(m_screenLayerProperties.onPixelColour) };
+
+    // Locked pixels are write only and don't have to hold what the texture had before, so every row from the first dirty
+    // one to the last gets written, dirty or not
+    const int firstRow{ std::countr_zero(rowMask) };
+    const int lastRow{ Utility::toInt(std::bit_width(rowMask)) - 1 };
+    const SDL_Rect lockedRows{ 0, firstRow, numColumns, lastRow - firstRow + 1 };
+
+    void* pixels{};
+    int pitch{};
+    if (SDL_LockTexture(m_screenLayer.get(), &lockedRows, &pixels, &pitch) != 0)
+    {
+        return false;
+    }
+
+    for (int y{ firstRow }; y <= lastRow; ++y)
+    {
+        const uint64_t row{ screenRows[Utility::toUZ(y)] };
+        uint32_t* const texels{ reinterpret_cast<uint32_t*>(static_cast<uint8_t*>(pixels) + (y - firstRow) * pitch) };
+
+        for (int x{ 0 }; x < numColumns; ++x)
+        {
+            texels[x] = palette[Utility::toUZ((row >> (numColumns - 1 - x)) & 1)];
+        }
+    }
+
+    SDL_UnlockTexture(m_screenLayer.get());
+    ++m_drawCallCounts.textureUploads;
+    return true;
+}
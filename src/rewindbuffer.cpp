@@ -0,0 +1,321 @@
+#include "rewindbuffer.h"
+
+#include <cstring>
+#include <type_traits>
+
+namespace
+{
+    // Zero runs shorter than this cost more to end a literal run for than to keep as literals
+    constexpr std::size_t s_minZeroRun{ 3 };
+
+    std::size_t writeVarint(std::vector<uint8_t>& output, std::size_t position, std::size_t value)
+    {
+        while (value >= 0x80)
+        {
+            output[position++] = Utility::toU8((value & 0x7F) | 0x80);
+            value >>= 7;
+        }
+        output[position++] = Utility::toU8(value);
+        return position;
+    }
+
+    std::size_t readVarint(const std::span<const uint8_t> input, std::size_t& position)
+    {
+        std::size_t value{ 0 };
+        for (int shift{ 0 }; ; shift += 7)
+        {
+            const uint8_t byte{ input[position++] };
+            value |= std::size_t{ byte & 0x7Fu } << shift;
+            if ((byte & 0x80) == 0)
+            {
+                return value;
+            }
+        }
+    }
+}
+
+static_assert(std::is_trivially_copyable_v<Chip8::SaveState>, "RewindBuffer stores SaveStates as raw bytes");
+
+RewindBuffer::RewindBuffer(const std::size_t capacityInBytes, const int keyframeInterval)
+: m_arena(capacityInBytes)
+, m_keyframeInterval{ keyframeInterval }
+// Every literal byte on its own between two zero runs is the worst case, at 3 bytes for every 2 of state
+, m_encoded(2 * sizeof(Chip8::SaveState) + 16)
+{
+    m_deltasSinceKeyframe.reserve(Utility::toUZ(keyframeInterval));
+}
+
+void RewindBuffer::push(const Chip8::SaveState& state)
+{
+    StateBytes stateBytes{};
+    std::memcpy(stateBytes.data(), &state, sizeof(state));
+
+    static constexpr StateBytes noState{};
+    bool isKeyframe{ m_numRecords == 0 || m_framesSinceKeyframe + 1 >= m_keyframeInterval };
+
+    std::size_t payloadSize{};
+    std::size_t offset{};
+    while (true)
+    {
+        payloadSize = encode(stateBytes, isKeyframe ? noState : m_newestState);
+        if (!makeRoomFor(s_headerSize + payloadSize, offset))
+        {
+            clear();
+            return;
+        }
+
+        // Making room can evict the keyframe a delta would have been built on, along with everything after it
+        if (isKeyframe || m_numRecords > 0)
+        {
+            break;
+        }
+        isKeyframe = true;
+    }
+
+    const RecordHeader header{
+        .payloadSize = Utility::toU32(payloadSize),
+        .previousRecordOffset = Utility::toU32(m_newestOffset),
+        .isKeyframe = isKeyframe,
+    };
+    std::memcpy(&m_arena[offset], &header, s_headerSize);
+    std::memcpy(&m_arena[offset + s_headerSize], m_encoded.data(), payloadSize);
+
+    m_newestOffset = offset;
+    m_writeOffset = offset + s_headerSize + payloadSize;
+    m_usedBytes += s_headerSize + payloadSize;
+    ++m_numRecords;
+
+    m_framesSinceKeyframe = isKeyframe ? 0 : m_framesSinceKeyframe + 1;
+    m_newestState = stateBytes;
+}
+
+bool RewindBuffer::stepBack(Chip8::SaveState& state)
+{
+    // The newest frame is the one the machine is already in
+    if (m_numRecords < 2)
+    {
+        return false;
+    }
+
+    const RecordHeader newest{ readHeader(m_newestOffset) };
+    const std::size_t previousOffset{ newest.previousRecordOffset };
+
+    if (!newest.isKeyframe)
+    {
+        decodeInto(getPayload(m_newestOffset), m_newestState);
+        --m_framesSinceKeyframe;
+    }
+    else
+    {
+        // The oldest record is always a keyframe, so there is one to start from
+        m_deltasSinceKeyframe.clear();
+        std::size_t offset{ previousOffset };
+        while (!readHeader(offset).isKeyframe)
+        {
+            m_deltasSinceKeyframe.push_back(offset);
+            offset = readHeader(offset).previousRecordOffset;
+        }
+
+        m_newestState = {};
+        decodeInto(getPayload(offset), m_newestState);
+        for (auto delta{ m_deltasSinceKeyframe.rbegin() }; delta != m_deltasSinceKeyframe.rend(); ++delta)
+        {
+            decodeInto(getPayload(*delta), m_newestState);
+        }
+        m_framesSinceKeyframe = Utility::toInt(m_deltasSinceKeyframe.size());
+    }
+
+    m_usedBytes -= s_headerSize + newest.payloadSize;
+    --m_numRecords;
+
+    if (m_isWrapped && m_newestOffset == 0)
+    {
+        m_isWrapped = false;
+        m_writeOffset = m_wrapOffset;
+    }
+    else
+    {
+        m_writeOffset = m_newestOffset;
+    }
+    m_newestOffset = previousOffset;
+
+    std::memcpy(&state, m_newestState.data(), sizeof(state));
+    return true;
+}
+
+void RewindBuffer::clear()
+{
+    m_oldestOffset = 0;
+    m_newestOffset = 0;
+    m_writeOffset = 0;
+    m_wrapOffset = 0;
+    m_isWrapped = false;
+
+    m_numRecords = 0;
+    m_usedBytes = 0;
+    m_framesSinceKeyframe = 0;
+}
+
+void RewindBuffer::setCapacity(const std::size_t capacityInBytes)
+{
+    // Assigning a new vector rather than resizing, so that lowering the limit gives the memory back
+    m_arena = std::vector<uint8_t>(capacityInBytes);
+    clear();
+}
+
+std::size_t RewindBuffer::encode(const StateBytes& state, const StateBytes& base)
+{
+    const auto isZeroAt{ [&](const std::size_t i) { return state[i] == base[i]; } };
+
+    constexpr std::size_t wordSize{ sizeof(uint64_t) };
+    const std::size_t stateSize{ state.size() };
+
+    std::size_t encodedSize{ 0 };
+    std::size_t i{ 0 };
+    while (i < stateSize)
+    {
+        const std::size_t zeroRunStart{ i };
+
+        // Most of a delta is zero, so skip over it a word at a time first
+        while (i + wordSize <= stateSize && std::memcmp(&state[i], &base[i], wordSize) == 0)
+        {
+            i += wordSize;
+        }
+        while (i < stateSize && isZeroAt(i))
+        {
+            ++i;
+        }
+
+        // Trailing zeros don't need storing
+        if (i == stateSize)
+        {
+            break;
+        }
+
+        const std::size_t literalRunStart{ i };
+        while (i < stateSize)
+        {
+            if (!isZeroAt(i))
+            {
+                ++i;
+                continue;
+            }
+
+            std::size_t zerosEnd{ i };
+            while (zerosEnd < stateSize && zerosEnd - i < s_minZeroRun && isZeroAt(zerosEnd))
+            {
+                ++zerosEnd;
+            }
+
+            if (zerosEnd - i >= s_minZeroRun || zerosEnd == stateSize)
+            {
+                break;
+            }
+            i = zerosEnd;
+        }
+
+        encodedSize = writeVarint(m_encoded, encodedSize, literalRunStart - zeroRunStart);
+        encodedSize = writeVarint(m_encoded, encodedSize, i - literalRunStart);
+        for (std::size_t literal{ literalRunStart }; literal < i; ++literal)
+        {
+            m_encoded[encodedSize++] = state[literal] ^ base[literal];
+        }
+    }
+
+    return encodedSize;
+}
+
+void RewindBuffer::decodeInto(const std::span<const uint8_t> payload, StateBytes& state)
+{
+    std::size_t position{ 0 };
+    std::size_t stateIndex{ 0 };
+    while (position < payload.size())
+    {
+        stateIndex += readVarint(payload, position);
+        const std::size_t literalRunLength{ readVarint(payload, position) };
+        assert(stateIndex + literalRunLength <= state.size());
+
+        for (std::size_t literal{ 0 }; literal < literalRunLength; ++literal)
+        {
+            state[stateIndex++] ^= payload[position++];
+        }
+    }
+}
+
+bool RewindBuffer::makeRoomFor(const std::size_t recordSize, std::size_t& offset)
+{
+    if (recordSize > m_arena.size())
+    {
+        return false;
+    }
+
+    while (true)
+    {
+        if (m_numRecords == 0)
+        {
+            clear();
+            offset = 0;
+            return true;
+        }
+
+        if (!m_isWrapped)
+        {
+            if (m_writeOffset + recordSize <= m_arena.size())
+            {
+                offset = m_writeOffset;
+                return true;
+            }
+
+            if (recordSize <= m_oldestOffset)
+            {
+                m_wrapOffset = m_writeOffset;
+                m_isWrapped = true;
+                offset = 0;
+                return true;
+            }
+        }
+        else if (m_writeOffset + recordSize <= m_oldestOffset)
+        {
+            offset = m_writeOffset;
+            return true;
+        }
+
+        evictOldest();
+    }
+}
+
+void RewindBuffer::evictOldest()
+{
+    // Deltas whose keyframe is gone can't be rebuilt any more, so they go along with it
+    do
+    {
+        const std::size_t recordSize{ s_headerSize + readHeader(m_oldestOffset).payloadSize };
+        m_usedBytes -= recordSize;
+        --m_numRecords;
+
+        m_oldestOffset += recordSize;
+        if (m_isWrapped && m_oldestOffset == m_wrapOffset)
+        {
+            m_oldestOffset = 0;
+            m_isWrapped = false;
+        }
+    }
+    while (m_numRecords > 0 && !readHeader(m_oldestOffset).isKeyframe);
+
+    if (m_numRecords == 0)
+    {
+        clear();
+    }
+}
+
+RewindBuffer::RecordHeader RewindBuffer::readHeader(const std::size_t offset) const
+{
+    RecordHeader header{};
+    std::memcpy(&header, &m_arena[offset], s_headerSize);
+    return header;
+}
+
+std::span<const uint8_t> RewindBuffer::getPayload(const std::size_t offset) const
+{
+    return std::span<const uint8_t>{ m_arena }.subspan(offset + s_headerSize, readHeader(offset).payloadSize);
+}
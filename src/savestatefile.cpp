@@ -0,0 +1,223 @@
+#include "savestatefile.h"
+
+#include <array>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <string_view>
+
+#include "exceptions/fileinputexception.h"
+#include "utils/bytestream.h"
+
+namespace
+{
+    using SaveState = Chip8::SaveState;
+    using QuirkFlags = Chip8::QuirkFlags;
+    using KeyInputs = Chip8::KeyInputs;
+
+    constexpr std::string_view s_magic{ "C8SS" };
+
+    // Order the quirks are packed into their byte, lowest bit first. Only ever append to this
+    constexpr std::array s_quirkBits{
+        &QuirkFlags::resetVF,
+        &QuirkFlags::index,
+        &QuirkFlags::wrapScreen,
+        &QuirkFlags::shift,
+        &QuirkFlags::jump,
+        &QuirkFlags::displayWait,
+        &QuirkFlags::haltOnOOBAccess,
+    };
+
+    enum FlagBits : uint8_t
+    {
+        executedDXYNBit = 1 << 0,
+        romIsLoadedBit = 1 << 1,
+    };
+
+    uint16_t packKeys(const EnumArray<KeyInputs, bool>& keys)
+    {
+        uint16_t packed{ 0 };
+        for (std::size_t key{ 0 }; key < keys.size(); ++key)
+        {
+            packed |= Utility::toU16(keys.data()[key] ? 1u << key : 0u);
+        }
+        return packed;
+    }
+
+    EnumArray<KeyInputs, bool> unpackKeys(const uint16_t packed)
+    {
+        EnumArray<KeyInputs, bool> keys{};
+        for (std::size_t key{ 0 }; key < keys.size(); ++key)
+        {
+            keys.data()[key] = (packed >> key) & 1;
+        }
+        return keys;
+    }
+
+    uint8_t packQuirks(const QuirkFlags& quirks)
+    {
+        uint8_t packed{ 0 };
+        for (std::size_t bit{ 0 }; bit < s_quirkBits.size(); ++bit)
+        {
+            packed |= Utility::toU8(quirks.*s_quirkBits[bit] ? 1u << bit : 0u);
+        }
+        return packed;
+    }
+
+    QuirkFlags unpackQuirks(const uint8_t packed)
+    {
+        QuirkFlags quirks{};
+        for (std::size_t bit{ 0 }; bit < s_quirkBits.size(); ++bit)
+        {
+            quirks.*s_quirkBits[bit] = (packed >> bit) & 1;
+        }
+        return quirks;
+    }
+}
+
+std::vector<uint8_t> SaveStateFile::serialize(const SaveState& state)
+{
+    std::vector<uint8_t> bytes{};
+    bytes.reserve(sizeof(SaveState));
+
+    ByteWriter writer{ bytes };
+    for (const char character : s_magic)
+    {
+        writer.write(static_cast<uint8_t>(character));
+    }
+    writer.write(version);
+
+    writer.writeBytes(state.memory);
+    writer.writeBytes(state.registers);
+    writer.write(state.pc);
+    writer.write(state.indexRegister);
+    writer.write(state.delayTimer);
+    writer.write(state.soundTimer);
+
+    writer.write(state.stackDepth);
+    for (std::size_t i{ 0 }; i < state.stackDepth; ++i)
+    {
+        writer.write(state.stack[i]);
+    }
+
+    for (const uint64_t row : state.screen)
+    {
+        writer.write(row);
+    }
+
+    writer.write(packKeys(state.keyDownThisFrame));
+    writer.write(packKeys(state.keyDownLastFrame));
+    writer.write(packQuirks(state.quirks));
+    writer.write(state.randomState);
+
+    const uint8_t flags{ Utility::toU8((state.executedDXYN ? executedDXYNBit : 0)
+                                     | (state.runtimeMetaData.romIsLoaded ? romIsLoadedBit : 0)) };
+    writer.write(flags);
+
+    const Chip8::RuntimeMetaData& metaData{ state.runtimeMetaData };
+    writer.write(metaData.numInstructionsExecuted);
+    writer.write(metaData.numInstructionsSkippedIdle);
+    writer.write(metaData.fontStartAddress);
+    writer.write(metaData.fontEndAddress);
+    writer.write(metaData.programStartAddress);
+    writer.write(metaData.programEndAddress);
+
+    return bytes;
+}
+
+SaveState SaveStateFile::deserialize(const std::span<const uint8_t> bytes)
+{
+    ByteReader reader{ bytes, "Save state" };
+    for (const char character : s_magic)
+    {
+        if (reader.read<uint8_t>() != static_cast<uint8_t>(character))
+        {
+            throw FileInputException("Not a save state");
+        }
+    }
+
+    const uint16_t fileVersion{ reader.read<uint16_t>() };
+    if (fileVersion != version)
+    {
+        throw FileInputException(std::format("Save state is version {}, only version {} is supported", fileVersion, version));
+    }
+
+    SaveState state{};
+    reader.readBytes(state.memory);
+    reader.readBytes(state.registers);
+    state.pc = reader.read<uint16_t>();
+    state.indexRegister = reader.read<uint16_t>();
+    state.delayTimer = reader.read<uint8_t>();
+    state.soundTimer = reader.read<uint8_t>();
+
+    state.stackDepth = reader.read<uint8_t>();
+    if (state.stackDepth > Chip8::InitialConfig::maxStackDepth)
+    {
+        throw FileInputException(std::format("Save state has a stack {} deep", state.stackDepth));
+    }
+    for (std::size_t i{ 0 }; i < state.stackDepth; ++i)
+    {
+        state.stack[i] = reader.read<uint16_t>();
+    }
+
+    for (uint64_t& row : state.screen)
+    {
+        row = reader.read<uint64_t>();
+    }
+
+    state.keyDownThisFrame = unpackKeys(reader.read<uint16_t>());
+    state.keyDownLastFrame = unpackKeys(reader.read<uint16_t>());
+    state.quirks = unpackQuirks(reader.read<uint8_t>());
+    state.randomState = reader.read<uint64_t>();
+
+    const uint8_t flags{ reader.read<uint8_t>() };
+    state.executedDXYN = (flags & executedDXYNBit) != 0;
+    state.runtimeMetaData.romIsLoaded = (flags & romIsLoadedBit) != 0;
+
+    Chip8::RuntimeMetaData& metaData{ state.runtimeMetaData };
+    metaData.numInstructionsExecuted = reader.read<uint64_t>();
+    metaData.numInstructionsSkippedIdle = reader.read<uint64_t>();
+    metaData.fontStartAddress = reader.read<uint16_t>();
+    metaData.fontEndAddress = reader.read<uint16_t>();
+    metaData.programStartAddress = reader.read<uint16_t>();
+    metaData.programEndAddress = reader.read<uint16_t>();
+
+    if (!reader.isAtEnd())
+    {
+        throw FileInputException("Save state has trailing data");
+    }
+
+    return state;
+}
+
+void SaveStateFile::write(const std::filesystem::path& path, const SaveState& state)
+{
+    const std::vector<uint8_t> bytes{ serialize(state) };
+
+    std::ofstream file{ path, std::ios::binary };
+    file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+
+    if (!file)
+    {
+        throw FileInputException("Error writing save state. Path: " + path.string());
+    }
+}
+
+SaveState SaveStateFile::read(const std::filesystem::path& path)
+{
+    std::ifstream file{ path, std::ios::binary };
+    if (!file)
+    {
+        throw FileInputException("Error opening save state. Path: " + path.string());
+    }
+
+    const std::vector<uint8_t> bytes{ std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
+    try
+    {
+        return deserialize(bytes);
+    }
+    catch (const FileInputException& exception)
+    {
+        throw FileInputException(std::string{ exception.what() } + ". Path: " + path.string());
+    }
+}
@@ -0,0 +1,83 @@
+#include "savestateslots.h"
+
+#include <format>
+#include <iostream>
+
+#include "savestatefile.h"
+#include "exceptions/fileinputexception.h"
+
+SaveStateSlots::SaveStateSlots(std::filesystem::path directory)
+: m_directory{ std::move(directory) }
+{
+    for (int slot{ 0 }; slot < s_numSlots; ++slot)
+    {
+        const std::filesystem::path slotPath{ getSlotPath(slot) };
+        std::error_code error{};
+        if (!std::filesystem::exists(slotPath, error))
+        {
+            continue;
+        }
+
+        // A slot that can't be read is treated as empty, and is overwritten by the next save to it
+        try
+        {
+            m_slots[Utility::toUZ(slot)] = SaveStateFile::read(slotPath);
+        }
+        catch (const FileInputException& exception)
+        {
+            std::cerr << exception.what() << '\n';
+        }
+    }
+}
+
+void SaveStateSlots::save(const int slot, const Chip8& chip)
+{
+    assert(slot >= 0 && slot < s_numSlots);
+
+    std::optional<Chip8::SaveState>& savedState{ m_slots[Utility::toUZ(slot)] };
+    savedState = chip.saveState();
+
+    std::error_code error{};
+    std::filesystem::create_directories(m_directory, error);
+    SaveStateFile::write(getSlotPath(slot), *savedState);
+}
+
+bool SaveStateSlots::load(const int slot, Chip8& chip) const
+{
+    assert(slot >= 0 && slot < s_numSlots);
+
+    const std::optional<Chip8::SaveState>& savedState{ m_slots[Utility::toUZ(slot)] };
+    if (!savedState)
+    {
+        return false;
+    }
+
+    chip.loadState(*savedState);
+    return true;
+}
+
+bool SaveStateSlots::isOccupied(const int slot) const
+{
+    return m_slots[Utility::toUZ(slot)].has_value();
+}
+
+void SaveStateSlots::selectSlot(const int slot)
+{
+    assert(slot >= 0 && slot < s_numSlots);
+    m_selectedSlot = slot;
+}
+
+void SaveStateSlots::selectNextSlot()
+{
+    m_selectedSlot = (m_selectedSlot + 1) % s_numSlots;
+}
+
+void SaveStateSlots::selectPreviousSlot()
+{
+    m_selectedSlot = (m_selectedSlot + s_numSlots - 1) % s_numSlots;
+}
+
+std::filesystem::path SaveStateSlots::getSlotPath(const int slot) const
+{
+    return m_directory / std::format("slot{}.c8s", slot);
+}
@@ -3,6 +3,12 @@
 
 bool StateManager::canTransitionTo(const State newState)
 {
+    // Fast forward is only a faster way of running, so there's nothing to fast forward while debugging
+    if (newState == fastForward && m_currentState != running)
+    {
+        return false;
+    }
+
     return m_currentState != newState;
 }
 
@@ -0,0 +1,130 @@
+#include "../include/utils/trace.h"
+
+#include <cstdint>
+#include <format>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../include/exceptions/fileinputexception.h"
+
+namespace Trace
+{
+    namespace
+    {
+        // About 24MB of scopes, several minutes' worth at the usual couple of dozen per frame. Anything after that is
+        // dropped rather than letting the recording grow without end
+        constexpr std::size_t s_maxEvents{ 1 << 20 };
+
+        struct Event
+        {
+            const char* name{};
+            uint32_t threadId{};
+            Clock::time_point start{};
+            Clock::duration duration{};
+        };
+
+        // Only taken by threads that are recording a scope, a couple of dozen times a frame, so it is never contended
+        // for long enough to matter
+        std::mutex s_mutex{};
+        std::vector<Event> s_events{};
+        Clock::time_point s_recordingStart{};
+        std::vector<std::pair<uint32_t, std::string>> s_threadNames{};
+
+        std::atomic<uint32_t> s_numThreads{ 0 };
+
+        uint32_t getThreadId()
+        {
+            thread_local const uint32_t threadId{ ++s_numThreads };
+            return threadId;
+        }
+
+        double toMicroseconds(const Clock::duration duration)
+        {
+            return std::chrono::duration<double, std::micro>{ duration }.count();
+        }
+    }
+
+    void Detail::recordScope(const char* name, const Clock::time_point start, const Clock::time_point end)
+    {
+        const uint32_t threadId{ getThreadId() };
+
+        const std::scoped_lock lock{ s_mutex };
+
+        // Recording may have stopped while the scope was open
+        if (!isRecording() || s_events.size() >= s_maxEvents)
+        {
+            return;
+        }
+
+        s_events.push_back(Event{ .name = name, .threadId = threadId, .start = start, .duration = end - start });
+    }
+
+    void startRecording()
+    {
+        const std::scoped_lock lock{ s_mutex };
+
+        s_events.clear();
+        s_recordingStart = Clock::now();
+        Detail::s_isRecording.store(true, std::memory_order_relaxed);
+    }
+
+    std::size_t stopRecording(const std::filesystem::path& path)
+    {
+        std::vector<Event> events{};
+        std::vector<std::pair<uint32_t, std::string>> threadNames{};
+        Clock::time_point recordingStart{};
+        {
+            const std::scoped_lock lock{ s_mutex };
+
+            Detail::s_isRecording.store(false, std::memory_order_relaxed);
+            events = std::exchange(s_events, {});
+            threadNames = s_threadNames;
+            recordingStart = s_recordingStart;
+        }
+
+        std::error_code error{};
+        std::filesystem::create_directories(path.parent_path(), error);
+
+        std::ofstream file{ path };
+        file << "{\"traceEvents\":[\n";
+
+        bool isFirstEvent{ true };
+        const auto separator{ [&isFirstEvent] { return std::exchange(isFirstEvent, false) ? "" : ",\n"; } };
+
+        for (const auto& [threadId, name] : threadNames)
+        {
+            file << std::format("{}{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":\"{}\"}}}}",
+                separator(), threadId, name);
+        }
+
+        // Complete ("X") events, in microseconds from when recording started
+        for (const Event& event : events)
+        {
+            file << std::format("{}{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+                separator(), event.name, event.threadId, toMicroseconds(event.start - recordingStart),
+                toMicroseconds(event.duration));
+        }
+
+        file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+        file.close();
+
+        if (!file)
+        {
+            throw FileInputException("Error writing trace. Path: " + path.string());
+        }
+
+        return events.size();
+    }
+
+    void setThreadName(const std::string_view name)
+    {
+        const uint32_t threadId{ getThreadId() };
+
+        const std::scoped_lock lock{ s_mutex };
+        std::erase_if(s_threadNames, [threadId](const auto& threadName) { return threadName.first == threadId; });
+        s_threadNames.emplace_back(threadId, name);
+    }
+}
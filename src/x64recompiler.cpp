@@ -0,0 +1,1035 @@
+#include "x64recompiler.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define CHIP8_X64_RECOMPILER_SUPPORTED
+#include <sys/mman.h>
+#endif
+
+namespace
+{
+    using OpcodeDecoder::Operation;
+    using OpcodeDecoder::DecodedOpcode;
+    using MachineState = X64Recompiler::MachineState;
+
+    enum HostRegister : uint8_t
+    {
+        rax = 0,
+        rcx = 1,
+        rdx = 2,
+        rbx = 3,
+        rsp = 4,
+        rbp = 5,
+        rsi = 6,
+        rdi = 7,
+        r8 = 8,
+        r9 = 9,
+        r10 = 10,
+        r11 = 11,
+        r12 = 12,
+        r13 = 13,
+        r14 = 14,
+        r15 = 15,
+    };
+
+    // How compiled code uses the host registers. rax, rcx and rdx are scratch
+    constexpr HostRegister s_stateRegister{ rdi };
+    constexpr HostRegister s_indexRegister{ rsi };
+    constexpr HostRegister s_memoryRegister{ r8 };
+
+    // Handed out to V registers in the order a block first uses them. Only the callee-saved ones have to be pushed, so
+    // those go last. Everything else is taken, so a block stops in front of an instruction that would need a tenth
+    constexpr std::array s_registerHosts{ r9, r10, r11, rbx, rbp, r12, r13, r14, r15 };
+
+    constexpr bool isCalleeSaved(const HostRegister reg)
+    {
+        return reg == rbx || reg == rbp || reg >= r12;
+    }
+
+    enum Condition : uint8_t
+    {
+        carry = 0x2,
+        noCarry = 0x3,
+        equal = 0x4,
+        notEqual = 0x5,
+        above = 0x7,
+    };
+
+    // A byte in memory at [base + index + displacement]. An index of rsp means there isn't one
+    struct Memory
+    {
+        HostRegister base{};
+        HostRegister index{ rsp };
+        int32_t displacement{};
+    };
+
+    Memory fieldOf(const HostRegister base, const std::size_t offset)
+    {
+        return Memory{ .base = base, .displacement = static_cast<int32_t>(offset) };
+    }
+
+    constexpr uint8_t s_registerVF{ 0xF };
+
+    // Writes x86-64 machine code for a single block. Only the handful of instruction forms the translator needs exist
+    // here. Byte operations always get a REX prefix, so that sil, dil, bpl and r8b-r15b can be used
+    class CodeEmitter
+    {
+    public:
+        enum class Size
+        {
+            byte,
+            word,
+            dword,
+            qword,
+        };
+
+        const std::vector<uint8_t>& getCode() const { return m_code; }
+
+        // op r/m, reg for the ALU forms: add 0x00, or 0x08, and 0x20, sub 0x28, xor 0x30, cmp 0x38, mov 0x88
+        void byteOperation(const uint8_t opcode, const HostRegister dest, const HostRegister src)
+        {
+            emitRegisterForm(Size::byte, { opcode }, src, dest);
+        }
+
+        // op r/m8, imm8: add /0, or /1, and /4, sub /5, xor /6, cmp /7
+        void byteOperationImmediate(const uint8_t extension, const HostRegister dest, const uint8_t value)
+        {
+            emitRegisterForm(Size::byte, { 0x80 }, static_cast<HostRegister>(extension), dest);
+            emit({ value });
+        }
+
+        // mov reg8, imm8
+        void moveByteImmediate(const HostRegister dest, const uint8_t value)
+        {
+            emitRex(Size::byte, rax, rsp, dest);
+            emit({ Utility::toU8(0xB0 + (dest & 7)), value });
+        }
+
+        // shl r/m8, imm8 is /4, shr /5
+        void shiftByte(const uint8_t extension, const HostRegister dest, const uint8_t amount)
+        {
+            emitRegisterForm(Size::byte, { 0xC0 }, static_cast<HostRegister>(extension), dest);
+            emit({ amount });
+        }
+
+        // setcc r/m8
+        void setByteIf(const Condition condition, const HostRegister dest)
+        {
+            emitRegisterForm(Size::byte, { 0x0F, Utility::toU8(0x90 + condition) }, rax, dest);
+        }
+
+        // movzx reg32, r/m8
+        void zeroExtendByte(const HostRegister dest, const HostRegister src)
+        {
+            emitRegisterForm(Size::byte, { 0x0F, 0xB6 }, dest, src);
+        }
+
+        void zeroExtendByte(const HostRegister dest, const Memory& src)
+        {
+            emitMemoryForm(Size::byte, { 0x0F, 0xB6 }, dest, src);
+        }
+
+        // movzx reg32, r/m16
+        void zeroExtendWord(const HostRegister dest, const Memory& src)
+        {
+            emitMemoryForm(Size::dword, { 0x0F, 0xB7 }, dest, src);
+        }
+
+        // mov r/m, reg and mov reg, r/m
+        void store(const Size size, const Memory& dest, const HostRegister src)
+        {
+            emitMemoryForm(size, { size == Size::byte ? uint8_t{ 0x88 } : uint8_t{ 0x89 } }, src, dest);
+        }
+
+        void load(const Size size, const HostRegister dest, const Memory& src)
+        {
+            emitMemoryForm(size, { size == Size::byte ? uint8_t{ 0x8A } : uint8_t{ 0x8B } }, dest, src);
+        }
+
+        // add r/m16, r16 and add r16, r/m16
+        void addWord(const HostRegister dest, const HostRegister src)
+        {
+            emitRegisterForm(Size::word, { 0x01 }, src, dest);
+        }
+
+        void addWord(const HostRegister dest, const Memory& src)
+        {
+            emitMemoryForm(Size::word, { 0x03 }, dest, src);
+        }
+
+        // add/sub r32, r/m32
+        void addDword(const HostRegister dest, const HostRegister src)
+        {
+            emitRegisterForm(Size::dword, { 0x03 }, dest, src);
+        }
+
+        void subtractDword(const HostRegister dest, const HostRegister src)
+        {
+            emitRegisterForm(Size::dword, { 0x2B }, dest, src);
+        }
+
+        // op r/m32, imm32: add /0, and /4, sub /5, cmp /7
+        void dwordOperationImmediate(const uint8_t extension, const HostRegister dest, const uint32_t value)
+        {
+            emitRegisterForm(Size::dword, { 0x81 }, static_cast<HostRegister>(extension), dest);
+            emitDword(value);
+        }
+
+        // shr r/m32, imm8
+        void shiftRightDword(const HostRegister dest, const uint8_t amount)
+        {
+            emitRegisterForm(Size::dword, { 0xC1 }, static_cast<HostRegister>(5), dest);
+            emit({ amount });
+        }
+
+        // imul reg32, r/m32, imm32
+        void multiplyDword(const HostRegister dest, const HostRegister src, const uint32_t value)
+        {
+            emitRegisterForm(Size::dword, { 0x69 }, dest, src);
+            emitDword(value);
+        }
+
+        // lea reg32, [src + src * 4]. src can't be rbp or r13, which have no base-only encoding without a displacement
+        void multiplyByFive(const HostRegister dest, const HostRegister src)
+        {
+            emitRex(Size::dword, dest, src, src);
+            emit({ 0x8D, Utility::toU8(((dest & 7) << 3) | 0b100),
+                   Utility::toU8(0x80 | ((src & 7) << 3) | (src & 7)) });
+        }
+
+        // mov reg32, imm32
+        void moveImmediate(const HostRegister dest, const uint32_t value)
+        {
+            emitRex(Size::dword, rax, rsp, dest);
+            emit({ Utility::toU8(0xB8 + (dest & 7)) });
+            emitDword(value);
+        }
+
+        // cmovcc reg32, r/m32
+        void moveIf(const Condition condition, const HostRegister dest, const HostRegister src)
+        {
+            emitRegisterForm(Size::dword, { 0x0F, Utility::toU8(0x40 + condition) }, dest, src);
+        }
+
+        // jcc rel32 to a label that isn't there yet. Returns what to pass to bindJump() once it is
+        std::size_t jumpIf(const Condition condition)
+        {
+            emit({ 0x0F, Utility::toU8(0x80 + condition) });
+            emitDword(0);
+            return m_code.size();
+        }
+
+        // Points the jump that ended at jumpEnd here
+        void bindJump(const std::size_t jumpEnd)
+        {
+            const uint32_t distance{ Utility::toU32(m_code.size() - jumpEnd) };
+            for (std::size_t byte{ 0 }; byte < 4; ++byte)
+            {
+                m_code[jumpEnd - 4 + byte] = Utility::toU8((distance >> (8 * byte)) & 0xFF);
+            }
+        }
+
+        void push(const HostRegister reg)
+        {
+            emitRex(Size::dword, rax, rsp, reg);
+            emit({ Utility::toU8(0x50 + (reg & 7)) });
+        }
+
+        void pop(const HostRegister reg)
+        {
+            emitRex(Size::dword, rax, rsp, reg);
+            emit({ Utility::toU8(0x58 + (reg & 7)) });
+        }
+
+        // sub rsp, imm8 / add rsp, imm8
+        void reserveStack(const uint8_t numBytes) { emit({ 0x48, 0x83, 0xEC, numBytes }); }
+        void releaseStack(const uint8_t numBytes) { emit({ 0x48, 0x83, 0xC4, numBytes }); }
+
+        // call rax
+        void callRAX() { emit({ 0xFF, 0xD0 }); }
+
+        void ret() { emit({ 0xC3 }); }
+
+    private:
+        void emit(const std::initializer_list<uint8_t> bytes) { m_code.insert(m_code.end(), bytes); }
+
+        void emitDword(const uint32_t value)
+        {
+            for (int shift{ 0 }; shift < 32; shift += 8)
+            {
+                emit({ Utility::toU8((value >> shift) & 0xFF) });
+            }
+        }
+
+        // Operand size prefix and REX for an instruction whose ModRM names reg and, through index and base, r/m
+        void emitRex(const Size size, const HostRegister reg, const HostRegister index, const HostRegister base)
+        {
+            if (size == Size::word)
+            {
+                emit({ 0x66 });
+            }
+
+            const uint8_t rex{ Utility::toU8(0x40 | (size == Size::qword ? 0x08 : 0) | ((reg >> 3) << 2)
+                                              | ((index >> 3) << 1) | (base >> 3)) };
+            if (rex != 0x40 || size == Size::byte)
+            {
+                emit({ rex });
+            }
+        }
+
+        void emitRegisterForm(const Size size, const std::initializer_list<uint8_t> opcode, const HostRegister reg,
+                              const HostRegister rm)
+        {
+            emitRex(size, reg, rsp, rm);
+            emit(opcode);
+            emit({ Utility::toU8(0xC0 | ((reg & 7) << 3) | (rm & 7)) });
+        }
+
+        // Always goes through a SIB byte and a displacement, which covers every base register the same way
+        void emitMemoryForm(const Size size, const std::initializer_list<uint8_t> opcode, const HostRegister reg,
+                            const Memory& memory)
+        {
+            const bool isShortDisplacement{ memory.displacement >= -128 && memory.displacement <= 127 };
+
+            emitRex(size, reg, memory.index, memory.base);
+            emit(opcode);
+            emit({ Utility::toU8((isShortDisplacement ? 0x40 : 0x80) | ((reg & 7) << 3) | 0b100),
+                   Utility::toU8(((memory.index & 7) << 3) | (memory.base & 7)) });
+            if (isShortDisplacement)
+            {
+                emit({ static_cast<uint8_t>(memory.displacement) });
+            }
+            else
+            {
+                emitDword(static_cast<uint32_t>(memory.displacement));
+            }
+        }
+
+        std::vector<uint8_t> m_code{};
+    };
+
+    bool isTranslatable(const Operation operation)
+    {
+        switch (operation)
+        {
+        case Operation::op6XNN:
+        case Operation::op7XNN:
+        case Operation::op8XY0:
+        case Operation::op8XY1:
+        case Operation::op8XY2:
+        case Operation::op8XY3:
+        case Operation::op8XY4:
+        case Operation::op8XY5:
+        case Operation::op8XY6:
+        case Operation::op8XY7:
+        case Operation::op8XYE:
+        case Operation::opANNN:
+        case Operation::opFX07:
+        case Operation::opFX15:
+        case Operation::opFX18:
+        case Operation::opFX1E:
+        case Operation::opFX29:
+        case Operation::opFX65:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // Translatable, but the block has to end after them
+    bool isTranslatableBlockEnd(const Operation operation)
+    {
+        switch (operation)
+        {
+        case Operation::op1NNN:
+        case Operation::op3XNN:
+        case Operation::op4XNN:
+        case Operation::op5XY0:
+        case Operation::op9XY0:
+        case Operation::opFX33:
+        case Operation::opFX55:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // What a translated instruction does to the machine, so that a block knows what to load and store back
+    struct Footprint
+    {
+        // Bit v for Vv
+        uint16_t registersUsed{ 0 };
+        uint16_t registersWritten{ 0 };
+
+        bool usesIndex{ false };
+        bool writesIndex{ false };
+        bool usesMemory{ false };
+    };
+
+    Footprint findFootprint(const DecodedOpcode& instruction, const X64Recompiler::Quirks& quirks)
+    {
+        const uint16_t x{ Utility::toU16(1u << instruction.x) };
+        const uint16_t y{ Utility::toU16(1u << instruction.y) };
+        constexpr uint16_t vf{ 1u << s_registerVF };
+        const uint16_t upToX{ Utility::toU16((2u << instruction.x) - 1) };
+
+        switch (instruction.operation)
+        {
+        case Operation::op6XNN:
+        case Operation::op7XNN:
+        case Operation::opFX07:
+            return { .registersUsed = x, .registersWritten = x };
+        case Operation::op3XNN:
+        case Operation::op4XNN:
+        case Operation::opFX15:
+        case Operation::opFX18:
+            return { .registersUsed = x };
+        case Operation::op5XY0:
+        case Operation::op9XY0:
+            return { .registersUsed = Utility::toU16(x | y) };
+        case Operation::op8XY0:
+            return { .registersUsed = Utility::toU16(x | y), .registersWritten = x };
+        case Operation::op8XY1:
+        case Operation::op8XY2:
+        case Operation::op8XY3:
+        {
+            const uint16_t flag{ quirks.resetVF ? vf : uint16_t{ 0 } };
+            return { .registersUsed = Utility::toU16(x | y | flag), .registersWritten = Utility::toU16(x | flag) };
+        }
+        case Operation::op8XY6:
+        case Operation::op8XYE:
+        {
+            const uint16_t source{ quirks.shift ? x : y };
+            return { .registersUsed = Utility::toU16(x | source | vf), .registersWritten = Utility::toU16(x | vf) };
+        }
+        case Operation::op8XY4:
+        case Operation::op8XY5:
+        case Operation::op8XY7:
+            return { .registersUsed = Utility::toU16(x | y | vf), .registersWritten = Utility::toU16(x | vf) };
+        case Operation::opANNN:
+            return { .usesIndex = true, .writesIndex = true };
+        case Operation::opFX1E:
+        case Operation::opFX29:
+            return { .registersUsed = x, .usesIndex = true, .writesIndex = true };
+        case Operation::opFX33:
+            return { .registersUsed = x, .usesIndex = true, .usesMemory = true };
+        case Operation::opFX55:
+            return { .registersUsed = upToX, .usesIndex = true, .writesIndex = quirks.index, .usesMemory = true };
+        case Operation::opFX65:
+            return { .registersUsed = upToX, .registersWritten = upToX, .usesIndex = true, .writesIndex = quirks.index,
+                     .usesMemory = true };
+        default:
+            return {};
+        }
+    }
+
+    // Emits one block. Everything the block touches is decided before any code is written, so that it can all be loaded
+    // up front and stored back on every way out
+    class BlockTranslator
+    {
+    public:
+        BlockTranslator(const X64Recompiler::Quirks& quirks, const std::size_t memorySize)
+        : m_quirks{ quirks }
+        , m_memorySize{ memorySize }
+        {
+            m_hostOfRegister.fill(rsp);
+        }
+
+        // False if the instruction would need more V registers than there are host registers for them
+        bool tryAdd(const DecodedOpcode& instruction)
+        {
+            const Footprint footprint{ findFootprint(instruction, m_quirks) };
+            const uint16_t registersUsed{ Utility::toU16(m_footprint.registersUsed | footprint.registersUsed) };
+            if (std::popcount(registersUsed) > Utility::toInt(s_registerHosts.size()))
+            {
+                return false;
+            }
+
+            for (uint8_t v{ 0 }; v < m_hostOfRegister.size(); ++v)
+            {
+                if ((footprint.registersUsed & (1u << v)) != 0 && m_hostOfRegister[v] == rsp)
+                {
+                    m_hostOfRegister[v] = s_registerHosts[Utility::toUZ(std::popcount(m_footprint.registersUsed))];
+                    m_footprint.registersUsed |= Utility::toU16(1u << v);
+                }
+            }
+            m_footprint.registersWritten |= footprint.registersWritten;
+            m_footprint.usesIndex = m_footprint.usesIndex || footprint.usesIndex;
+            m_footprint.writesIndex = m_footprint.writesIndex || footprint.writesIndex;
+            m_footprint.usesMemory = m_footprint.usesMemory || footprint.usesMemory;
+
+            m_instructions.push_back(instruction);
+            return true;
+        }
+
+        std::size_t getNumInstructions() const { return m_instructions.size(); }
+
+        // The instructions added are the ones from startAddress on
+        std::vector<uint8_t> translate(const uint16_t startAddress)
+        {
+            for (const HostRegister host : s_registerHosts)
+            {
+                if (isCalleeSaved(host) && isHostUsed(host))
+                {
+                    m_emitter.push(host);
+                    m_pushedRegisters.push_back(host);
+                }
+            }
+            emitLoadState();
+
+            for (std::size_t i{ 0 }; i < m_instructions.size(); ++i)
+            {
+                const uint16_t address{ Utility::toU16(startAddress + 2 * i) };
+                const bool isLast{ i + 1 == m_instructions.size() };
+                emitInstruction(m_instructions[i], address, Utility::toU16(i), isLast);
+            }
+
+            for (const SideExit& sideExit : m_sideExits)
+            {
+                m_emitter.bindJump(sideExit.jumpEnd);
+                emitExit(sideExit.result);
+            }
+
+            return m_emitter.getCode();
+        }
+
+    private:
+        // Leaves in front of an instruction the interpreter has to run instead
+        struct SideExit
+        {
+            std::size_t jumpEnd{};
+            X64Recompiler::BlockResult result{};
+        };
+
+        HostRegister host(const uint8_t v) const { return m_hostOfRegister[v]; }
+
+        bool isHostUsed(const HostRegister reg) const
+        {
+            return std::ranges::find(m_hostOfRegister, reg) != m_hostOfRegister.end();
+        }
+
+        // mov dest, [state + offset], for the pointers in MachineState
+        void loadStateField(const HostRegister dest, const std::size_t offset)
+        {
+            m_emitter.load(CodeEmitter::Size::qword, dest, fieldOf(s_stateRegister, offset));
+        }
+
+        void emitLoadState()
+        {
+            if (m_footprint.registersUsed != 0)
+            {
+                loadStateField(rax, offsetof(MachineState, registers));
+                forEachRegister(m_footprint.registersUsed, [this](const uint8_t v) {
+                    m_emitter.zeroExtendByte(host(v), Memory{ .base = rax, .displacement = v });
+                });
+            }
+            if (m_footprint.usesIndex)
+            {
+                loadStateField(rax, offsetof(MachineState, indexRegister));
+                m_emitter.zeroExtendWord(s_indexRegister, Memory{ .base = rax });
+            }
+            if (m_footprint.usesMemory)
+            {
+                loadStateField(s_memoryRegister, offsetof(MachineState, memory));
+            }
+        }
+
+        // Only moves, so the flags of a skip's comparison survive it
+        void emitStoreState()
+        {
+            if (m_footprint.registersWritten != 0)
+            {
+                loadStateField(rax, offsetof(MachineState, registers));
+                forEachRegister(m_footprint.registersWritten, [this](const uint8_t v) {
+                    m_emitter.store(CodeEmitter::Size::byte, Memory{ .base = rax, .displacement = v }, host(v));
+                });
+            }
+            if (m_footprint.writesIndex)
+            {
+                loadStateField(rax, offsetof(MachineState, indexRegister));
+                m_emitter.store(CodeEmitter::Size::word, Memory{ .base = rax }, s_indexRegister);
+            }
+        }
+
+        void emitPopRegisters()
+        {
+            for (auto reg{ m_pushedRegisters.rbegin() }; reg != m_pushedRegisters.rend(); ++reg)
+            {
+                m_emitter.pop(*reg);
+            }
+        }
+
+        void emitExit(const X64Recompiler::BlockResult result)
+        {
+            emitStoreState();
+            emitPopRegisters();
+            m_emitter.moveImmediate(rax, std::bit_cast<uint32_t>(result));
+            m_emitter.ret();
+        }
+
+        void emitInstruction(const DecodedOpcode& instruction, const uint16_t address, const uint16_t numBefore,
+                             const bool isLast)
+        {
+            const uint16_t addressAfter{ Utility::toU16(address + 2) };
+            const X64Recompiler::BlockResult fallThrough{ .nextPC = addressAfter,
+                                                         .numInstructionsExecuted = Utility::toU16(numBefore + 1) };
+
+            switch (instruction.operation)
+            {
+            case Operation::op1NNN:
+                emitExit({ .nextPC = instruction.nnn, .numInstructionsExecuted = fallThrough.numInstructionsExecuted });
+                return;
+            case Operation::op3XNN:
+            case Operation::op4XNN:
+            case Operation::op5XY0:
+            case Operation::op9XY0:
+                emitSkip(instruction, fallThrough);
+                return;
+            case Operation::opFX33:
+            case Operation::opFX55:
+                emitMemoryWrite(instruction, address, numBefore, fallThrough);
+                return;
+            case Operation::opFX65:
+                emitMemoryRead(instruction, address, numBefore);
+                break;
+            case Operation::opFX07:
+            case Operation::opFX15:
+            case Operation::opFX18:
+                emitTimerAccess(instruction);
+                break;
+            default:
+                emitRegisterOperation(instruction);
+                break;
+            }
+
+            if (isLast)
+            {
+                emitExit(fallThrough);
+            }
+        }
+
+        // Flags are left in VF the same way the interpreter does it: computed from the original operands, written last
+        void emitRegisterOperation(const DecodedOpcode& instruction)
+        {
+            const HostRegister vx{ host(instruction.x) };
+            const HostRegister vy{ host(instruction.y) };
+            const HostRegister vf{ host(s_registerVF) };
+
+            switch (instruction.operation)
+            {
+            case Operation::op6XNN:
+                m_emitter.moveByteImmediate(vx, instruction.nn);
+                break;
+            case Operation::op7XNN:
+                m_emitter.byteOperationImmediate(0, vx, instruction.nn);
+                break;
+            case Operation::op8XY0:
+                m_emitter.byteOperation(0x88, vx, vy);
+                break;
+            case Operation::op8XY1:
+            case Operation::op8XY2:
+            case Operation::op8XY3:
+            {
+                const uint8_t opcode{ instruction.operation == Operation::op8XY1   ? uint8_t{ 0x08 }
+                                      : instruction.operation == Operation::op8XY2 ? uint8_t{ 0x20 }
+                                                                                   : uint8_t{ 0x30 } };
+                m_emitter.byteOperation(opcode, vx, vy);
+                if (m_quirks.resetVF)
+                {
+                    m_emitter.moveByteImmediate(vf, 0);
+                }
+                break;
+            }
+            case Operation::op8XY4:
+                m_emitter.byteOperation(0x00, vx, vy);
+                m_emitter.setByteIf(carry, rdx);
+                m_emitter.byteOperation(0x88, vf, rdx);
+                break;
+            case Operation::op8XY5:
+                m_emitter.byteOperation(0x28, vx, vy);
+                m_emitter.setByteIf(noCarry, rdx);
+                m_emitter.byteOperation(0x88, vf, rdx);
+                break;
+            case Operation::op8XY7:
+                m_emitter.byteOperation(0x88, rax, vy);
+                m_emitter.byteOperation(0x28, rax, vx);
+                m_emitter.setByteIf(noCarry, rdx);
+                m_emitter.byteOperation(0x88, vx, rax);
+                m_emitter.byteOperation(0x88, vf, rdx);
+                break;
+            case Operation::op8XY6:
+            case Operation::op8XYE:
+            {
+                const bool isRight{ instruction.operation == Operation::op8XY6 };
+                m_emitter.byteOperation(0x88, rax, m_quirks.shift ? vx : vy);
+                m_emitter.byteOperation(0x88, rdx, rax);
+                if (isRight)
+                {
+                    m_emitter.byteOperationImmediate(4, rdx, 0x01);
+                    m_emitter.shiftByte(5, rax, 1);
+                }
+                else
+                {
+                    m_emitter.shiftByte(5, rdx, 7);
+                    m_emitter.shiftByte(4, rax, 1);
+                }
+                m_emitter.byteOperation(0x88, vx, rax);
+                m_emitter.byteOperation(0x88, vf, rdx);
+                break;
+            }
+            case Operation::opANNN:
+                m_emitter.moveImmediate(s_indexRegister, instruction.nnn);
+                break;
+            case Operation::opFX1E:
+                // Only the low 16 bits change, so I stays zero extended
+                m_emitter.zeroExtendByte(rax, vx);
+                m_emitter.addWord(s_indexRegister, rax);
+                break;
+            case Operation::opFX29:
+                m_emitter.zeroExtendByte(rax, vx);
+                m_emitter.dwordOperationImmediate(4, rax, 0x0F);
+                m_emitter.multiplyByFive(s_indexRegister, rax);
+                m_emitter.addWord(s_indexRegister, fieldOf(s_stateRegister, offsetof(MachineState, fontsAddress)));
+                break;
+            default:
+                break;
+            }
+        }
+
+        void emitTimerAccess(const DecodedOpcode& instruction)
+        {
+            const bool isSoundTimer{ instruction.operation == Operation::opFX18 };
+            loadStateField(rax, isSoundTimer ? offsetof(MachineState, soundTimer) : offsetof(MachineState, delayTimer));
+            if (instruction.operation == Operation::opFX07)
+            {
+                m_emitter.load(CodeEmitter::Size::byte, host(instruction.x), Memory{ .base = rax });
+            }
+            else
+            {
+                m_emitter.store(CodeEmitter::Size::byte, Memory{ .base = rax }, host(instruction.x));
+            }
+        }
+
+        // The skip is worked out with a cmov, after the state is stored back, since neither touches the flags
+        void emitSkip(const DecodedOpcode& instruction, const X64Recompiler::BlockResult fallThrough)
+        {
+            const HostRegister vx{ host(instruction.x) };
+            if (instruction.operation == Operation::op3XNN || instruction.operation == Operation::op4XNN)
+            {
+                m_emitter.byteOperationImmediate(7, vx, instruction.nn);
+            }
+            else
+            {
+                m_emitter.byteOperation(0x38, vx, host(instruction.y));
+            }
+
+            emitStoreState();
+            emitPopRegisters();
+
+            const X64Recompiler::BlockResult skipped{ .nextPC = Utility::toU16(fallThrough.nextPC + 2),
+                                                      .numInstructionsExecuted = fallThrough.numInstructionsExecuted };
+            const bool skipIfEqual{ instruction.operation == Operation::op3XNN
+                                    || instruction.operation == Operation::op5XY0 };
+            m_emitter.moveImmediate(rax, std::bit_cast<uint32_t>(fallThrough));
+            m_emitter.moveImmediate(rcx, std::bit_cast<uint32_t>(skipped));
+            m_emitter.moveIf(skipIfEqual ? equal : notEqual, rax, rcx);
+            m_emitter.ret();
+        }
+
+        // Goes to a side exit unless all numBytes from I on are inside memory
+        void emitMemoryBoundsCheck(const std::size_t numBytes, const uint16_t address, const uint16_t numBefore)
+        {
+            m_emitter.dwordOperationImmediate(7, s_indexRegister, Utility::toU32(m_memorySize - numBytes));
+            m_sideExits.push_back({ .jumpEnd = m_emitter.jumpIf(above),
+                                    .result = { .nextPC = address, .numInstructionsExecuted = numBefore } });
+        }
+
+        Memory memoryAtIndex(const int32_t offset) const
+        {
+            return Memory{ .base = s_memoryRegister, .index = s_indexRegister, .displacement = offset };
+        }
+
+        void emitMemoryRead(const DecodedOpcode& instruction, const uint16_t address, const uint16_t numBefore)
+        {
+            const uint8_t numRegisters{ Utility::toU8(instruction.x + 1) };
+            emitMemoryBoundsCheck(numRegisters, address, numBefore);
+
+            for (uint8_t v{ 0 }; v < numRegisters; ++v)
+            {
+                m_emitter.load(CodeEmitter::Size::byte, host(v), memoryAtIndex(v));
+            }
+            if (m_quirks.index)
+            {
+                m_emitter.dwordOperationImmediate(0, s_indexRegister, numRegisters);
+            }
+        }
+
+        // Ends the block: the write may have been to code, so after telling the owner about it nothing compiled can be
+        // trusted to still be there
+        void emitMemoryWrite(const DecodedOpcode& instruction, const uint16_t address, const uint16_t numBefore,
+                             const X64Recompiler::BlockResult fallThrough)
+        {
+            const bool isBCD{ instruction.operation == Operation::opFX33 };
+            const uint8_t numBytes{ isBCD ? uint8_t{ 3 } : Utility::toU8(instruction.x + 1) };
+            emitMemoryBoundsCheck(numBytes, address, numBefore);
+
+            if (isBCD)
+            {
+                emitBCD(host(instruction.x));
+            }
+            else
+            {
+                for (uint8_t v{ 0 }; v < numBytes; ++v)
+                {
+                    m_emitter.store(CodeEmitter::Size::byte, memoryAtIndex(v), host(v));
+                }
+                if (m_quirks.index)
+                {
+                    m_emitter.dwordOperationImmediate(0, s_indexRegister, numBytes);
+                }
+            }
+
+            emitStoreState();
+
+            // notifyMemoryWritten(owner, first address, numBytes), with the stack 16 byte aligned for the call. I is
+            // already in esi, which is where the first address goes
+            static_assert(s_indexRegister == rsi);
+            if (!isBCD && m_quirks.index)
+            {
+                m_emitter.dwordOperationImmediate(5, s_indexRegister, numBytes);
+            }
+            m_emitter.moveImmediate(rdx, numBytes);
+            loadStateField(rax, offsetof(MachineState, notifyMemoryWritten));
+            loadStateField(rdi, offsetof(MachineState, owner));
+
+            const bool isStackAligned{ m_pushedRegisters.size() % 2 == 1 };
+            if (!isStackAligned)
+            {
+                m_emitter.reserveStack(8);
+            }
+            m_emitter.callRAX();
+            if (!isStackAligned)
+            {
+                m_emitter.releaseStack(8);
+            }
+
+            emitPopRegisters();
+            m_emitter.moveImmediate(rax, std::bit_cast<uint32_t>(fallThrough));
+            m_emitter.ret();
+        }
+
+        // Hundreds, tens and ones of Vx to I, I + 1 and I + 2. Dividing by 10 is a multiply by 205 and a shift by 11,
+        // which is exact for anything below 1029
+        void emitBCD(const HostRegister vx)
+        {
+            m_emitter.zeroExtendByte(rax, vx);
+            m_emitter.multiplyDword(rdx, rax, 205);
+            m_emitter.shiftRightDword(rdx, 11);
+            m_emitter.multiplyByFive(rcx, rdx);
+            m_emitter.addDword(rcx, rcx);
+            m_emitter.subtractDword(rax, rcx);
+            m_emitter.store(CodeEmitter::Size::byte, memoryAtIndex(2), rax);
+
+            m_emitter.multiplyDword(rax, rdx, 205);
+            m_emitter.shiftRightDword(rax, 11);
+            m_emitter.store(CodeEmitter::Size::byte, memoryAtIndex(0), rax);
+            m_emitter.multiplyByFive(rcx, rax);
+            m_emitter.addDword(rcx, rcx);
+            m_emitter.subtractDword(rdx, rcx);
+            m_emitter.store(CodeEmitter::Size::byte, memoryAtIndex(1), rdx);
+        }
+
+        template <typename Function>
+        static void forEachRegister(const uint16_t registers, Function function)
+        {
+            for (uint8_t v{ 0 }; v < 16; ++v)
+            {
+                if ((registers & (1u << v)) != 0)
+                {
+                    function(v);
+                }
+            }
+        }
+
+        CodeEmitter m_emitter{};
+        X64Recompiler::Quirks m_quirks{};
+        std::size_t m_memorySize{};
+
+        std::vector<DecodedOpcode> m_instructions{};
+        Footprint m_footprint{};
+
+        // rsp for V registers the block doesn't use
+        std::array<HostRegister, 16> m_hostOfRegister{};
+
+        std::vector<HostRegister> m_pushedRegisters{};
+        std::vector<SideExit> m_sideExits{};
+    };
+}
+
+bool X64Recompiler::isSupported()
+{
+#ifdef CHIP8_X64_RECOMPILER_SUPPORTED
+    return true;
+#else
+    return false;
+#endif
+}
+
+X64Recompiler::X64Recompiler(const std::size_t memorySize)
+: m_blockIndexAtAddress(memorySize, s_notCompiledYet)
+, m_isCompiledByte(memorySize, false)
+, m_isSelfModifiedByte(memorySize, false)
+{
+#ifdef CHIP8_X64_RECOMPILER_SUPPORTED
+    // Starts out read only, installCode() only makes it writable while copying a block in
+    void* arena{ mmap(nullptr, s_codeArenaSize, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0) };
+    if (arena != MAP_FAILED)
+    {
+        m_codeArena = static_cast<uint8_t*>(arena);
+    }
+#endif
+}
+
+X64Recompiler::~X64Recompiler()
+{
+#ifdef CHIP8_X64_RECOMPILER_SUPPORTED
+    if (m_codeArena != nullptr)
+    {
+        munmap(m_codeArena, s_codeArenaSize);
+    }
+#endif
+}
+
+const X64Recompiler::CompiledBlock* X64Recompiler::compileAt(const std::span<const uint8_t> memory,
+                                                             const uint16_t address)
+{
+    if (m_flushPending)
+    {
+        clear();
+    }
+
+    if (address >= m_blockIndexAtAddress.size())
+    {
+        return nullptr;
+    }
+
+    const CompiledBlock* block{ compileBlock(memory, address) };
+
+    // Unless the arena just filled up, in which case it is worth trying again once it has been emptied
+    if (block == nullptr && !m_flushPending)
+    {
+        m_blockIndexAtAddress[address] = s_notCompilable;
+    }
+    return block;
+}
+
+const X64Recompiler::CompiledBlock* X64Recompiler::compileBlock(const std::span<const uint8_t> memory, const uint16_t address)
+{
+    if (m_codeArena == nullptr)
+    {
+        return nullptr;
+    }
+
+    BlockTranslator translator{ m_compiledWithQuirks, memory.size() };
+    std::size_t currAddress{ address };
+    bool isIdleLoop{ false };
+
+    while (currAddress + 1 < memory.size() && translator.getNumInstructions() < s_maxInstructionsPerBlock)
+    {
+        // Code that has been rewritten before is likely to be rewritten again, so it is left to the interpreter
+        if (m_isSelfModifiedByte[currAddress] || m_isSelfModifiedByte[currAddress + 1])
+        {
+            break;
+        }
+
+        const uint16_t opcode{ Utility::toU16((memory[currAddress] << 8) | memory[currAddress + 1]) };
+        const DecodedOpcode& instruction{ OpcodeDecoder::lookup(opcode) };
+
+        const bool endsBlock{ isTranslatableBlockEnd(instruction.operation) };
+        if ((!endsBlock && !isTranslatable(instruction.operation)) || !translator.tryAdd(instruction))
+        {
+            break;
+        }
+
+        currAddress += 2;
+        if (endsBlock)
+        {
+            isIdleLoop = translator.getNumInstructions() == 1 && instruction.operation == Operation::op1NNN
+                && instruction.nnn == address;
+            break;
+        }
+    }
+
+    if (translator.getNumInstructions() == 0)
+    {
+        return nullptr;
+    }
+
+    BlockFunction function{ installCode(translator.translate(address)) };
+    if (function == nullptr)
+    {
+        // Arena is full. Start over, this block will be compiled again the next time it is reached
+        discardCompiledBlocks();
+        return nullptr;
+    }
+
+    for (std::size_t codeAddress{ address }; codeAddress < currAddress; ++codeAddress)
+    {
+        m_isCompiledByte[codeAddress] = true;
+    }
+
+    m_blockIndexAtAddress[address] = Utility::toInt(m_blocks.size());
+    m_blocks.push_back(CompiledBlock{
+        .function = function,
+        .startAddress = address,
+        .numInstructions = Utility::toU16(translator.getNumInstructions()),
+        .isIdleLoop = isIdleLoop,
+    });
+
+    return &m_blocks.back();
+}
+
+X64Recompiler::BlockFunction X64Recompiler::installCode(const std::vector<uint8_t>& code)
+{
+#ifdef CHIP8_X64_RECOMPILER_SUPPORTED
+    if (m_codeArenaUsed + code.size() > s_codeArenaSize)
+    {
+        return nullptr;
+    }
+
+    // The arena is never writable and executable at the same time
+    if (mprotect(m_codeArena, s_codeArenaSize, PROT_READ | PROT_WRITE) != 0)
+    {
+        return nullptr;
+    }
+
+    uint8_t* const start{ m_codeArena + m_codeArenaUsed };
+    std::memcpy(start, code.data(), code.size());
+    m_codeArenaUsed += code.size();
+
+    if (mprotect(m_codeArena, s_codeArenaSize, PROT_READ | PROT_EXEC) != 0)
+    {
+        return nullptr;
+    }
+
+    return reinterpret_cast<BlockFunction>(start);
+#else
+    static_cast<void>(code);
+    return nullptr;
+#endif
+}
+
+void X64Recompiler::clear()
+{
+    m_blocks.clear();
+    m_codeArenaUsed = 0;
+    std::ranges::fill(m_blockIndexAtAddress, s_notCompiledYet);
+    std::fill(m_isCompiledByte.begin(), m_isCompiledByte.end(), false);
+    m_flushPending = false;
+}
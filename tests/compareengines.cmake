@@ -0,0 +1,56 @@
+# Runs a ROM through chip8_headless on one engine and on the interpreter, and fails unless both leave the machine in
+# exactly the same state: screen and memory hashes, PC, I, timers, registers, stack and instruction count. Engines that
+# skip an idle loop's budget count it separately, so executed and skipped instructions are added up before comparing.
+#
+# cmake -DHEADLESS=<chip8_headless> -DROM=<rom.ch8> -DENGINE=<blocks|jit|aot> [-DFUSION=on|off] [-DFRAMES=N] [-DIPS=N]
+#       -P compareengines.cmake
+
+foreach(variable IN ITEMS HEADLESS ROM ENGINE)
+    if(NOT DEFINED ${variable})
+        message(FATAL_ERROR "compareengines.cmake needs -D${variable}=...")
+    endif()
+endforeach()
+
+if(NOT DEFINED FUSION)
+    set(FUSION on)
+endif()
+if(NOT DEFINED FRAMES)
+    set(FRAMES 600)
+endif()
+
+# A fixed seed, so ROMs that use CXNN draw the same numbers on both engines
+set(commonArgs "${ROM}" --frames ${FRAMES} --seed 1234)
+if(DEFINED IPS)
+    list(APPEND commonArgs --ips ${IPS})
+endif()
+
+# Sets outVar to the parts of chip8_headless's output that every engine has to agree on. A ROM that stops early makes
+# chip8_headless fail, which is fine as long as it stops the same way on both engines, so the exit code is kept too
+function(run_headless outVar)
+    execute_process(
+        COMMAND "${HEADLESS}" ${commonArgs} ${ARGN}
+        OUTPUT_VARIABLE output
+        ERROR_VARIABLE errors
+        RESULT_VARIABLE result
+    )
+
+    string(REGEX MATCH "Instructions executed: ([0-9]+)" _ "${output}")
+    set(numExecuted "${CMAKE_MATCH_1}")
+    string(REGEX MATCH "Instructions skipped while idle: ([0-9]+)" _ "${output}")
+    set(numSkipped "${CMAKE_MATCH_1}")
+    if(numExecuted STREQUAL "" OR numSkipped STREQUAL "")
+        message(FATAL_ERROR "chip8_headless ${ARGN} didn't report its instruction count:\n${output}${errors}")
+    endif()
+    math(EXPR numInstructions "${numExecuted} + ${numSkipped}")
+
+    string(REGEX MATCH "Framebuffer hash:.*" machineState "${output}")
+    set(${outVar} "Exit code: ${result}\nInstructions: ${numInstructions}\n${machineState}\n${errors}" PARENT_SCOPE)
+endfunction()
+
+run_headless(expected --engine interpreter)
+run_headless(actual --engine ${ENGINE} --fusion ${FUSION})
+
+if(NOT actual STREQUAL expected)
+    message(FATAL_ERROR "${ENGINE} (fusion ${FUSION}) doesn't match the interpreter on ${ROM}\n"
+                        "Interpreter:\n${expected}\n${ENGINE}:\n${actual}")
+endif()
@@ -0,0 +1,69 @@
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <filesystem>
+#include <vector>
+
+#include "chip8.h"
+#include "aottranslator.h"
+#include "exceptions/fileinputexception.h"
+
+// Usage: chip8_aot <rom.ch8> <output.cpp>
+// Writes a translation unit that, once linked into a program using the Chip8 core, lets ExecutionEngine::aheadOfTime run
+// that ROM as native code.
+
+namespace
+{
+    std::vector<uint8_t> readRom(const std::filesystem::path& path)
+    {
+        std::ifstream romFile{ path, std::ios::binary };
+        if (!romFile)
+        {
+            throw FileInputException("Error opening ROM file. Path: " + path.string());
+        }
+
+        std::vector<uint8_t> rom{ std::istreambuf_iterator<char>{ romFile }, std::istreambuf_iterator<char>{} };
+
+        constexpr std::size_t maxRomSize{ Chip8::InitialConfig::bitsOfMemory - Chip8::InitialConfig::programStartAddress };
+        if (rom.size() > maxRomSize)
+        {
+            throw FileInputException("ROM does not fit into CHIP-8 memory. Path: " + path.string());
+        }
+
+        return rom;
+    }
+
+    void writeSource(const std::filesystem::path& path, const std::string& source)
+    {
+        std::ofstream sourceFile{ path, std::ios::binary };
+        sourceFile << source;
+
+        if (!sourceFile)
+        {
+            throw FileInputException("Error writing generated source. Path: " + path.string());
+        }
+    }
+}
+
+int main(int argc, char* args[])
+{
+    if (argc != 3)
+    {
+        std::cerr << "Usage: chip8_aot <rom.ch8> <output.cpp>\n";
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        const std::filesystem::path romPath{ args[1] };
+        const std::vector<uint8_t> rom{ readRom(romPath) };
+
+        writeSource(args[2], AotTranslator::translate(rom, romPath.filename().string()));
+        return EXIT_SUCCESS;
+    }
+    catch (const std::runtime_error& exception)
+    {
+        std::cerr << "chip8_aot: " << exception.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
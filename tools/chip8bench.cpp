@@ -0,0 +1,666 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <optional>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#define SDL_MAIN_HANDLED
+#include <SDL.h>
+
+#include "chip8.h"
+#include "renderer.h"
+#include "imguirenderer.h"
+#include "rewindbuffer.h"
+#include "types/displaysettings.h"
+#include "types/emulatorcommand.h"
+#include "types/emulatorsnapshot.h"
+#include "types/frameinfo.h"
+#include "exceptions/fileinputexception.h"
+
+// Usage: chip8_bench [--json results.json] [--baseline baseline.json] [--tolerance 0.25] [--filter prefix]
+// Times the hot paths of the emulator: single instructions through performFDECycle, sprite drawing, a frame of a real ROM
+// on each execution engine, loading ROMs, taking and restoring save states, recording and stepping back through rewind
+// history, drawing the screen through the Renderer and building each ImGui window. The renderer benchmarks run on SDL's
+// dummy video driver with the software renderer, so no display is needed, and are skipped if SDL can't start at all.
+//
+// Every result is the average time of one operation over a batch, taking the fastest of several batches to keep noise
+// from other processes out. With --baseline, any result that is slower than its baseline by more than the tolerance
+// (a fraction, 0.25 by default) is reported and the exit code is non-zero, and so is any result the baseline has no
+// entry for: leave those out with --filter rather than letting them pass unchecked. tools/chip8bench_baseline.json is
+// the baseline that is kept in the repo; regenerate it with --json when a change is meant to move the numbers.
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int s_numBatches{ 5 };
+    constexpr double s_defaultTolerance{ 0.25 };
+
+    struct BenchmarkResult
+    {
+        std::string name{};
+        double nsPerOp{};
+    };
+
+    struct Options
+    {
+        std::string jsonPath{};
+        std::string baselinePath{};
+        double tolerance{ s_defaultTolerance };
+        std::string filter{};
+    };
+
+    class BenchmarkRunner
+    {
+    public:
+        explicit BenchmarkRunner(std::string filter)
+        : m_filter{ std::move(filter) }
+        {
+        }
+
+        // The filter is a prefix of the names to run. Also true for a group like "renderer/" if the filter picks
+        // something inside it
+        bool isSelected(const std::string_view name) const
+        {
+            return name.starts_with(m_filter) || std::string_view{ m_filter }.starts_with(name);
+        }
+
+        // operation is run opsPerBatch times per batch
+        void run(const std::string& name, const int opsPerBatch, const std::function<void()>& operation)
+        {
+            if (!isSelected(name))
+            {
+                return;
+            }
+
+            operation();
+
+            double fastestBatchNs{ std::numeric_limits<double>::max() };
+            for (int batch{ 0 }; batch < s_numBatches; ++batch)
+            {
+                const auto startTime{ Clock::now() };
+                for (int i{ 0 }; i < opsPerBatch; ++i)
+                {
+                    operation();
+                }
+                const std::chrono::duration<double, std::nano> elapsed{ Clock::now() - startTime };
+                fastestBatchNs = std::min(fastestBatchNs, elapsed.count());
+            }
+
+            record(name, fastestBatchNs / opsPerBatch);
+        }
+
+        // For timings measured somewhere else, like ImguiRenderer's own window timings
+        void record(const std::string& name, const double nsPerOp)
+        {
+            m_results.push_back(BenchmarkResult{ .name = name, .nsPerOp = nsPerOp });
+            std::cout << std::format("{:<48} {:>14.1f} ns\n", name, nsPerOp);
+        }
+
+        const std::vector<BenchmarkResult>& getResults() const { return m_results; }
+
+    private:
+        std::string m_filter{};
+        std::vector<BenchmarkResult> m_results{};
+    };
+
+    // Chip8::loadFile reports what it is loading on stdout, which would be mixed in with the results
+    class StdoutSilencer
+    {
+    public:
+        StdoutSilencer()
+        : m_previousBuffer{ std::cout.rdbuf(m_discarded.rdbuf()) }
+        {
+        }
+
+        ~StdoutSilencer()
+        {
+            std::cout.rdbuf(m_previousBuffer);
+        }
+
+        StdoutSilencer(const StdoutSilencer&) = delete;
+        StdoutSilencer& operator=(const StdoutSilencer&) = delete;
+
+    private:
+        std::ostringstream m_discarded{};
+        std::streambuf* m_previousBuffer{};
+    };
+
+    std::filesystem::path writeTemporaryRom(const std::string_view name, const std::vector<uint16_t>& opcodes)
+    {
+        const std::filesystem::path path{ std::filesystem::temp_directory_path() / std::format("chip8_bench_{}.ch8", name) };
+
+        std::ofstream romFile{ path, std::ios::binary };
+        for (const uint16_t opcode : opcodes)
+        {
+            romFile.put(static_cast<char>(opcode >> 8));
+            romFile.put(static_cast<char>(opcode & 0xFF));
+        }
+
+        if (!romFile)
+        {
+            throw FileInputException("Error writing temporary ROM. Path: " + path.string());
+        }
+        return path;
+    }
+
+    void loadQuietly(Chip8& chip, const std::filesystem::path& romPath)
+    {
+        StdoutSilencer silencer{};
+        chip.loadFile(romPath.string());
+    }
+
+    // One instruction (or a short sequence) repeated over and over. setup runs once first, then body is unrolled
+    // numBodyCopies times with a jump back to its start
+    struct OpcodeBenchmark
+    {
+        std::string_view name{};
+        std::vector<uint16_t> setup{};
+        std::vector<uint16_t> body{};
+        bool wrapScreen{ false };
+    };
+
+    constexpr int s_numBodyCopies{ 32 };
+
+    std::vector<uint16_t> buildRom(const OpcodeBenchmark& benchmark)
+    {
+        std::vector<uint16_t> rom{ benchmark.setup };
+        const uint16_t bodyAddress{ Utility::toU16(Chip8::InitialConfig::programStartAddress + 2 * rom.size()) };
+
+        for (int copy{ 0 }; copy < s_numBodyCopies; ++copy)
+        {
+            rom.insert(rom.end(), benchmark.body.begin(), benchmark.body.end());
+        }
+        rom.push_back(Utility::toU16(0x1000 | bodyAddress));
+        return rom;
+    }
+
+    void runOpcodeBenchmark(BenchmarkRunner& runner, const std::string& name, const OpcodeBenchmark& benchmark)
+    {
+        if (!runner.isSelected(name))
+        {
+            return;
+        }
+
+        Chip8 chip{};
+        loadQuietly(chip, writeTemporaryRom(benchmark.name, buildRom(benchmark)));
+
+        // Otherwise FX55/FX65 would walk I through memory until it ran off the end
+        chip.getEnabledQuirks().index = false;
+        chip.getEnabledQuirks().wrapScreen = benchmark.wrapScreen;
+
+        for (std::size_t i{ 0 }; i < benchmark.setup.size(); ++i)
+        {
+            chip.performFDECycle();
+        }
+
+        constexpr int cyclesPerBatch{ 200'000 };
+        runner.run(name, cyclesPerBatch, [&chip] { chip.performFDECycle(); });
+    }
+
+    void benchmarkOpcodeFamilies(BenchmarkRunner& runner)
+    {
+        // V0-VF are set up so every operand is non-trivial, and I points past the ROM so FX55 doesn't write over code.
+        // The font is where DXYN gets a sprite that isn't blank from
+        const std::vector<uint16_t> registerSetup{
+            0x6001, 0x6102, 0x6203, 0x6304, 0x6405, 0x6506, 0x6607, 0x6708,
+            0x6809, 0x690A, 0x6A0B, 0x6B0C, 0x6C0D, 0x6D0E, 0x6E0F, 0x6F10,
+            0xA800
+        };
+
+        const std::vector<OpcodeBenchmark> benchmarks{
+            { .name = "00E0", .body = { 0x00E0 } },
+            // Jumps over a subroutine that returns straight away, then calls it over and over
+            { .name = "2NNN_00EE", .setup = { 0x1204, 0x00EE }, .body = { 0x2202 } },
+            { .name = "3XNN", .setup = registerSetup, .body = { 0x3001 } },
+            { .name = "6XNN", .body = { 0x6A42 } },
+            { .name = "7XNN", .body = { 0x7A01 } },
+            { .name = "8XY4", .setup = registerSetup, .body = { 0x8124 } },
+            { .name = "8XY6", .setup = registerSetup, .body = { 0x8126 } },
+            { .name = "ANNN", .body = { 0xA123 } },
+            { .name = "CXNN", .body = { 0xC0FF } },
+            { .name = "DXYN", .setup = registerSetup, .body = { 0xA050, 0xD125 } },
+            { .name = "EX9E", .setup = registerSetup, .body = { 0xE09E } },
+            { .name = "FX07", .body = { 0xF007 } },
+            { .name = "FX1E", .setup = { 0x6001 }, .body = { 0xF01E } },
+            { .name = "FX29", .setup = registerSetup, .body = { 0xF529 } },
+            { .name = "FX33", .setup = registerSetup, .body = { 0xFF33 } },
+            { .name = "FX55", .setup = registerSetup, .body = { 0xFF55 } },
+            { .name = "FX65", .setup = registerSetup, .body = { 0xFF65 } },
+        };
+
+        for (const OpcodeBenchmark& benchmark : benchmarks)
+        {
+            runOpcodeBenchmark(runner, std::format("fde/{}", benchmark.name), benchmark);
+        }
+    }
+
+    void benchmarkDrawSprite(BenchmarkRunner& runner)
+    {
+        // 15 rows of the font, drawn at a byte aligned position, an unaligned one, one that is clipped at the bottom right
+        // corner and the same one with the screen wrap quirk on
+        const std::vector<uint16_t> spriteSetup{ 0xA050, 0x6000, 0x6100, 0x6205, 0x6303, 0x643C, 0x651C };
+
+        const std::vector<std::pair<std::string_view, OpcodeBenchmark>> benchmarks{
+            { "aligned", { .name = "sprite_aligned", .setup = spriteSetup, .body = { 0xD01F } } },
+            { "unaligned", { .name = "sprite_unaligned", .setup = spriteSetup, .body = { 0xD23F } } },
+            { "clipped", { .name = "sprite_clipped", .setup = spriteSetup, .body = { 0xD45F } } },
+            { "wrapped", { .name = "sprite_wrapped", .setup = spriteSetup, .body = { 0xD45F }, .wrapScreen = true } },
+        };
+
+        for (const auto& [position, benchmark] : benchmarks)
+        {
+            runOpcodeBenchmark(runner, std::format("drawSprite/{}", position), benchmark);
+        }
+    }
+
+    // A whole ROM rather than one instruction, so that what each engine does between instructions (block lookups,
+    // budget checks, falling back to the interpreter) is counted too. The ROM is copied next to chip8_bench by the build,
+    // and chip8_add_aot_roms() links its AotProgram in
+    constexpr std::string_view s_engineBenchmarkRom{ "roms/Particle Demo [zeroZshadow, 2008].ch8" };
+
+    void benchmarkExecutionEngines(BenchmarkRunner& runner)
+    {
+        if (!runner.isSelected("executeInstructions/"))
+        {
+            return;
+        }
+
+        if (!std::filesystem::exists(s_engineBenchmarkRom))
+        {
+            std::cerr << std::format("chip8_bench: skipping engine benchmarks: {} not found\n", s_engineBenchmarkRom);
+            return;
+        }
+
+        using ExecutionEngine = Chip8::ExecutionEngine;
+        const std::vector<std::pair<std::string_view, ExecutionEngine>> engines{
+            { "interpreter", ExecutionEngine::interpreter },
+            { "blocks", ExecutionEngine::basicBlockCache },
+            { "jit", ExecutionEngine::jit },
+            { "aot", ExecutionEngine::aheadOfTime },
+        };
+
+        // Far more than a frame at normal speed, so the time of one frame is mostly instructions
+        constexpr int instructionsPerFrame{ 1000 };
+        constexpr int framesPerBatch{ 200 };
+
+        for (const auto& [engineName, engine] : engines)
+        {
+            const std::string name{ std::format("executeInstructions/{}", engineName) };
+            if (!runner.isSelected(name))
+            {
+                continue;
+            }
+
+            Chip8 chip{};
+            loadQuietly(chip, s_engineBenchmarkRom);
+            chip.seedRandom(1);
+            chip.setExecutionEngine(engine);
+
+            // Either of these would just time the interpreter again
+            if (chip.getExecutionEngine() != engine || (engine == ExecutionEngine::aheadOfTime && !chip.hasAotProgram()))
+            {
+                std::cerr << std::format("chip8_bench: skipping {}: engine not available in this build\n", name);
+                continue;
+            }
+
+            runner.run(name, framesPerBatch, [&chip] {
+                chip.decrementTimers();
+                chip.executeInstructions(instructionsPerFrame);
+                chip.setPrevFrameInputs();
+            });
+        }
+    }
+
+    void benchmarkLoadFile(BenchmarkRunner& runner)
+    {
+        if (!runner.isSelected("loadFile"))
+        {
+            return;
+        }
+
+        const std::vector<uint16_t> largestRom(
+            (Chip8::InitialConfig::bitsOfMemory - Chip8::InitialConfig::programStartAddress) / 2, 0x1200);
+        const std::filesystem::path romPath{ writeTemporaryRom("load", largestRom) };
+
+        constexpr int loadsPerBatch{ 200 };
+        runner.run("loadFile/3584_bytes", loadsPerBatch, [&romPath] {
+            Chip8 chip{};
+            loadQuietly(chip, romPath);
+        });
+    }
+
+    // A screen with something on every row, so that run length drawing has some runs to draw
+    Chip8 makeBusyScreenChip()
+    {
+        std::vector<uint16_t> drawEveryRow{ 0xA000, 0x6000, 0x6100 };
+        for (int y{ 0 }; y < Chip8::InitialConfig::numPixelsVertically; y += 5)
+        {
+            for (int x{ 0 }; x < Chip8::InitialConfig::numPixelsHorizontally; x += 7)
+            {
+                drawEveryRow.insert(drawEveryRow.end(), { Utility::toU16(0x6000 | x), Utility::toU16(0x6100 | y), 0xD015 });
+            }
+        }
+        drawEveryRow.push_back(Utility::toU16(0x1000 | (Chip8::InitialConfig::programStartAddress + 2 * drawEveryRow.size())));
+
+        Chip8 chip{};
+        loadQuietly(chip, writeTemporaryRom("busy_screen", drawEveryRow));
+        chip.executeInstructions(Utility::toInt(drawEveryRow.size()));
+        return chip;
+    }
+
+    void benchmarkSaveState(BenchmarkRunner& runner)
+    {
+        if (!runner.isSelected("saveState"))
+        {
+            return;
+        }
+
+        Chip8 chip{ makeBusyScreenChip() };
+        const Chip8::SaveState earlierState{ chip.saveState() };
+
+        // Moves the PC, registers and screen on, so that restoring earlierState has something to undo
+        chip.executeInstructions(50);
+        const Chip8::SaveState laterState{ chip.saveState() };
+
+        constexpr int statesPerBatch{ 10000 };
+        runner.run("saveState/snapshot_and_restore", statesPerBatch, [&chip] {
+            const Chip8::SaveState state{ chip.saveState() };
+            chip.loadState(state);
+        });
+
+        bool restoreEarlier{ true };
+        runner.run("saveState/restore_changed", statesPerBatch, [&] {
+            chip.loadState(restoreEarlier ? earlierState : laterState);
+            restoreEarlier = !restoreEarlier;
+        });
+    }
+
+    void benchmarkRewind(BenchmarkRunner& runner)
+    {
+        if (!runner.isSelected("rewind"))
+        {
+            return;
+        }
+
+        Chip8 chip{ makeBusyScreenChip() };
+        std::vector<Chip8::SaveState> frames{};
+        for (int frame{ 0 }; frame < RewindBuffer::s_defaultKeyframeInterval; ++frame)
+        {
+            chip.executeInstructions(12);
+            frames.push_back(chip.saveState());
+        }
+
+        // Big enough that nothing is evicted, which is the usual case until the history has filled up
+        RewindBuffer rewindBuffer{ 64 * 1024 * 1024 };
+        std::size_t nextFrame{ 0 };
+
+        constexpr int framesPerBatch{ 1000 };
+        runner.run("rewind/push", framesPerBatch, [&] {
+            rewindBuffer.push(frames[nextFrame]);
+            nextFrame = (nextFrame + 1) % frames.size();
+        });
+
+        // Includes stepping back over a keyframe once every s_defaultKeyframeInterval frames
+        Chip8::SaveState state{};
+        runner.run("rewind/step_back", framesPerBatch, [&] {
+            if (!rewindBuffer.stepBack(state))
+            {
+                for (const Chip8::SaveState& frame : frames)
+                {
+                    rewindBuffer.push(frame);
+                }
+            }
+        });
+    }
+
+    void benchmarkRenderer(BenchmarkRunner& runner)
+    {
+        if (!runner.isSelected("renderer/") && !runner.isSelected("imgui/"))
+        {
+            return;
+        }
+
+        SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+        SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+
+        auto displaySettings{ std::make_shared<DisplaySettings>() };
+        std::unique_ptr<Renderer> renderer{};
+        try
+        {
+            renderer = std::make_unique<Renderer>(displaySettings);
+        }
+        catch (const std::runtime_error& exception)
+        {
+            std::cerr << "chip8_bench: skipping renderer benchmarks: " << exception.what() << '\n';
+            return;
+        }
+
+        Chip8 chip{ makeBusyScreenChip() };
+        const Chip8::ScreenBuffer& screen{ chip.getScreenBuffer() };
+        constexpr uint32_t allRowsDirty{ ~uint32_t{ 0 } };
+
+        constexpr int framesPerBatch{ 100 };
+        for (const bool useStreamingTexture : { true, false })
+        {
+            displaySettings->useStreamingTexture = useStreamingTexture;
+            const std::string_view path{ useStreamingTexture ? "streaming" : "rects" };
+
+            runner.run(std::format("renderer/{}/all_rows_dirty", path), framesPerBatch, [&] {
+                renderer->clearDisplay();
+                renderer->drawChipScreenBufferToFrame(screen, allRowsDirty);
+                renderer->render();
+            });
+
+            runner.run(std::format("renderer/{}/unchanged", path), framesPerBatch, [&] {
+                renderer->clearDisplay();
+                renderer->drawChipScreenBufferToFrame(screen, 0);
+                renderer->render();
+            });
+        }
+
+        if (!runner.isSelected("imgui/"))
+        {
+            return;
+        }
+
+        ImguiRenderer imguiRenderer{ renderer->getWindow(), renderer->getRenderer(), displaySettings, 1.0f };
+        EmulatorSnapshot snapshot{};
+        snapshot.chip = chip.saveState();
+        snapshot.targetNumInstrPerSecond = chip.getTargetNumInstrPerSecond();
+        snapshot.executionEngine = chip.getExecutionEngine();
+
+        // Whatever the windows ask for is thrown away, there's no emulation thread to send it to
+        std::vector<EmulatorCommand> commands{};
+        const FrameInfo frameInfo{};
+
+        ImguiRenderer::WindowTimes totalWindowTimes{};
+        int numImguiFrames{ 0 };
+        runner.run("imgui/all_windows", framesPerBatch, [&] {
+            imguiRenderer.drawAllImguiWindows(displaySettings, *renderer, snapshot, commands, frameInfo, true);
+            commands.clear();
+            renderer->render();
+
+            const ImguiRenderer::WindowTimes& windowTimes{ imguiRenderer.getLastFrameWindowTimes() };
+            std::ranges::transform(totalWindowTimes, windowTimes, totalWindowTimes.begin(), std::plus{});
+            ++numImguiFrames;
+        });
+
+        for (std::size_t i{ 0 }; i < totalWindowTimes.size(); ++i)
+        {
+            const auto window{ static_cast<ImguiRenderer::Window>(i) };
+            const double averageNs{ 1000.0 * totalWindowTimes[window] / numImguiFrames };
+            runner.record(std::format("imgui/{}", ImguiRenderer::getWindowName(window)), averageNs);
+        }
+    }
+
+    void writeJson(const std::string& path, const std::vector<BenchmarkResult>& results)
+    {
+        std::ofstream jsonFile{ path };
+        jsonFile << "{\n  \"benchmarks\": [\n";
+        for (std::size_t i{ 0 }; i < results.size(); ++i)
+        {
+            jsonFile << std::format("    {{ \"name\": \"{}\", \"nsPerOp\": {:.2f} }}{}\n",
+                results[i].name, results[i].nsPerOp, i + 1 < results.size() ? "," : "");
+        }
+        jsonFile << "  ]\n}\n";
+
+        if (!jsonFile)
+        {
+            throw FileInputException("Error writing benchmark results. Path: " + path);
+        }
+    }
+
+    // Only needs to understand what writeJson() produces
+    std::map<std::string, double> readBaseline(const std::string& path)
+    {
+        std::ifstream jsonFile{ path };
+        if (!jsonFile)
+        {
+            throw FileInputException("Error opening benchmark baseline. Path: " + path);
+        }
+
+        const std::regex resultPattern{ R"re("name":\s*"([^"]+)",\s*"nsPerOp":\s*([0-9.eE+-]+))re" };
+
+        std::map<std::string, double> baseline{};
+        std::string line{};
+        while (std::getline(jsonFile, line))
+        {
+            std::smatch match{};
+            if (std::regex_search(line, match, resultPattern))
+            {
+                baseline[match[1].str()] = std::stod(match[2].str());
+            }
+        }
+        return baseline;
+    }
+
+    // Returns the number of results that regressed or have nothing to compare against
+    int compareAgainstBaseline(const std::vector<BenchmarkResult>& results, const std::map<std::string, double>& baseline,
+        const double tolerance)
+    {
+        std::cout << std::format("\nCompared against baseline (tolerance {:.0f}%):\n", tolerance * 100.0);
+
+        int numFailures{ 0 };
+        for (const BenchmarkResult& result : results)
+        {
+            const auto baselineResult{ baseline.find(result.name) };
+            if (baselineResult == baseline.end())
+            {
+                std::cout << std::format("  {:<48} NO BASELINE\n", result.name);
+                ++numFailures;
+                continue;
+            }
+
+            const double change{ result.nsPerOp / baselineResult->second - 1.0 };
+            const bool isRegression{ change > tolerance };
+            numFailures += isRegression;
+
+            std::cout << std::format("  {:<48} {:>+7.1f}%{}\n", result.name, change * 100.0, isRegression ? "  REGRESSION" : "");
+        }
+        return numFailures;
+    }
+
+    std::optional<Options> parseOptions(const int argc, char* args[])
+    {
+        Options options{};
+        for (int i{ 1 }; i < argc; i += 2)
+        {
+            if (i + 1 >= argc)
+            {
+                return std::nullopt;
+            }
+
+            const std::string_view flag{ args[i] };
+            const std::string value{ args[i + 1] };
+
+            if (flag == "--json")
+            {
+                options.jsonPath = value;
+            }
+            else if (flag == "--baseline")
+            {
+                options.baselinePath = value;
+            }
+            else if (flag == "--tolerance")
+            {
+                options.tolerance = std::stod(value);
+            }
+            else if (flag == "--filter")
+            {
+                options.filter = value;
+            }
+            else
+            {
+                return std::nullopt;
+            }
+        }
+        return options;
+    }
+}
+
+int main(int argc, char* args[])
+{
+    std::optional<Options> options{};
+    try
+    {
+        options = parseOptions(argc, args);
+    }
+    catch (const std::logic_error&)
+    {
+        // std::stod on something that isn't a number
+    }
+
+    if (!options)
+    {
+        std::cerr << "Usage: chip8_bench [--json results.json] [--baseline baseline.json] [--tolerance 0.25] [--filter prefix]\n";
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        BenchmarkRunner runner{ options->filter };
+
+        benchmarkOpcodeFamilies(runner);
+        benchmarkDrawSprite(runner);
+        benchmarkExecutionEngines(runner);
+        benchmarkLoadFile(runner);
+        benchmarkSaveState(runner);
+        benchmarkRewind(runner);
+        benchmarkRenderer(runner);
+
+        if (!options->jsonPath.empty())
+        {
+            writeJson(options->jsonPath, runner.getResults());
+        }
+
+        if (!options->baselinePath.empty())
+        {
+            const int numFailures{ compareAgainstBaseline(runner.getResults(), readBaseline(options->baselinePath),
+                options->tolerance) };
+            if (numFailures > 0)
+            {
+                std::cerr << std::format("chip8_bench: {} benchmark(s) regressed or have no baseline\n", numFailures);
+                return EXIT_FAILURE;
+            }
+        }
+
+        return EXIT_SUCCESS;
+    }
+    catch (const std::runtime_error& exception)
+    {
+        std::cerr << "chip8_bench: " << exception.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,396 @@
+#include <iostream>
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <optional>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "chip8.h"
+#include "inputmovie.h"
+#include "exceptions/fileinputexception.h"
+
+// Usage: chip8_headless <rom.ch8> [--frames N] [--ips N] [--engine interpreter|blocks|jit|aot] [--fusion on|off]
+//                      [--input script.txt] [--seed N] [--record movie.c8m] [--movie movie.c8m]
+// Runs a ROM with nothing but the Chip8 core, so it works on machines without a display or audio device, then prints how
+// fast it ran, hashes of the final screen and memory and the final register state. With --seed, ROMs that use CXNN come
+// out the same on every run too. Every engine prints the same state for the same run, which tests/compareengines.cmake
+// relies on. --fusion off runs the basic block cache without its superinstructions. --engine jit fails on builds without
+// the JIT, and --engine aot fails unless an AOT program for the ROM was linked in with chip8_add_aot_roms().
+//
+// --record writes the run out as an InputMovie. --movie replays one instead of running the ROM from its start: the
+// movie's keys, seed and instructions per frame replace --input, --seed and --ips, and --frames defaults to the length of
+// the movie. The ROM is still loaded first so that an AOT program linked in for it is picked up. Replaying the same movie
+// on two builds runs exactly the same workload on both.
+//
+// Each line of an input script is "<frame> <down|up> <key>", with the key as a single hex digit, e.g. "120 down 5".
+// Changes take effect at the start of that frame, before any of its instructions run. Blank lines and lines starting
+// with # are ignored.
+
+namespace
+{
+    using KeyInputs = Chip8::KeyInputs;
+    using ExecutionEngine = Chip8::ExecutionEngine;
+
+    // Same frame rate the emulator targets by default, which is also the rate the timers count down at
+    constexpr int s_framesPerSecond{ 60 };
+
+    struct KeyEvent
+    {
+        int frame{};
+        KeyInputs key{};
+        bool isDown{};
+    };
+
+    struct Options
+    {
+        std::string romPath{};
+        std::optional<int> numFrames{};
+        std::optional<int> instructionsPerSecond{};
+        std::optional<ExecutionEngine> engine{};
+        bool isFusionEnabled{ true };
+        std::string inputScriptPath{};
+        std::optional<uint64_t> randomSeed{};
+        std::string recordPath{};
+        std::string moviePath{};
+    };
+
+    constexpr int s_defaultNumFrames{ 600 };
+
+    void printUsage()
+    {
+        std::cerr << "Usage: chip8_headless <rom.ch8> [--frames N] [--ips N] [--engine interpreter|blocks|jit|aot] "
+                     "[--fusion on|off] [--input script.txt] [--seed N] [--record movie.c8m] [--movie movie.c8m]\n";
+    }
+
+    std::optional<ExecutionEngine> parseEngine(const std::string_view name)
+    {
+        if (name == "interpreter") { return ExecutionEngine::interpreter; }
+        if (name == "blocks")      { return ExecutionEngine::basicBlockCache; }
+        if (name == "jit")         { return ExecutionEngine::jit; }
+        if (name == "aot")         { return ExecutionEngine::aheadOfTime; }
+        return std::nullopt;
+    }
+
+    std::optional<Options> parseOptions(const int argc, char* args[])
+    {
+        if (argc < 2)
+        {
+            return std::nullopt;
+        }
+
+        Options options{ .romPath = args[1] };
+        for (int i{ 2 }; i + 1 < argc; i += 2)
+        {
+            const std::string_view flag{ args[i] };
+            const std::string value{ args[i + 1] };
+
+            if (flag == "--frames")
+            {
+                options.numFrames = std::stoi(value);
+            }
+            else if (flag == "--ips")
+            {
+                options.instructionsPerSecond = std::stoi(value);
+            }
+            else if (flag == "--engine")
+            {
+                options.engine = parseEngine(value);
+                if (!options.engine)
+                {
+                    return std::nullopt;
+                }
+            }
+            else if (flag == "--fusion")
+            {
+                if (value != "on" && value != "off")
+                {
+                    return std::nullopt;
+                }
+                options.isFusionEnabled = value == "on";
+            }
+            else if (flag == "--input")
+            {
+                options.inputScriptPath = value;
+            }
+            else if (flag == "--seed")
+            {
+                options.randomSeed = std::stoull(value);
+            }
+            else if (flag == "--record")
+            {
+                options.recordPath = value;
+            }
+            else if (flag == "--movie")
+            {
+                options.moviePath = value;
+            }
+            else
+            {
+                return std::nullopt;
+            }
+        }
+
+        // Every flag needs a value
+        if (argc % 2 != 0)
+        {
+            return std::nullopt;
+        }
+
+        // A replayed run would just be a copy of the movie being replayed
+        if (!options.recordPath.empty() && !options.moviePath.empty())
+        {
+            return std::nullopt;
+        }
+
+        return options;
+    }
+
+    std::vector<KeyEvent> readInputScript(const std::string& path)
+    {
+        std::ifstream script{ path };
+        if (!script)
+        {
+            throw FileInputException("Error opening input script. Path: " + path);
+        }
+
+        std::vector<KeyEvent> events{};
+        std::string line{};
+        for (int lineNumber{ 1 }; std::getline(script, line); ++lineNumber)
+        {
+            if (line.empty() || line.front() == '#')
+            {
+                continue;
+            }
+
+            std::istringstream fields{ line };
+            int frame{};
+            std::string action{};
+            int keyValue{};
+            fields >> frame >> action >> std::hex >> keyValue;
+
+            const bool isValidKey{ keyValue >= 0 && keyValue < Utility::toInt(KeyInputs::MAX_VALUE) };
+            if (!fields || (action != "down" && action != "up") || !isValidKey)
+            {
+                throw FileInputException(std::format("Malformed input script line {}: {}", lineNumber, line));
+            }
+
+            events.push_back(KeyEvent{ .frame = frame, .key = static_cast<KeyInputs>(keyValue), .isDown = action == "down" });
+        }
+
+        std::ranges::stable_sort(events, {}, &KeyEvent::frame);
+        return events;
+    }
+
+    // FNV-1a over the rows of the screen, so two runs can be compared without dumping the whole framebuffer
+    uint64_t hashScreen(const Chip8::ScreenBuffer& screen)
+    {
+        uint64_t hash{ 0xCBF29CE484222325 };
+        for (const uint64_t row : screen)
+        {
+            for (int byte{ 7 }; byte >= 0; --byte)
+            {
+                hash ^= (row >> (byte * 8)) & 0xFF;
+                hash *= 0x100000001B3;
+            }
+        }
+        return hash;
+    }
+
+    // Same for memory, which is where a ROM that writes over its own code would go wrong
+    uint64_t hashMemory(const std::span<const uint8_t> memory)
+    {
+        uint64_t hash{ 0xCBF29CE484222325 };
+        for (const uint8_t byte : memory)
+        {
+            hash ^= byte;
+            hash *= 0x100000001B3;
+        }
+        return hash;
+    }
+
+    void printMachineState(const Chip8& chip)
+    {
+        std::cout << std::format("Framebuffer hash: 0x{:016X}\n", hashScreen(chip.getScreenBuffer()));
+        std::cout << std::format("Memory hash: 0x{:016X}\n", hashMemory(chip.getMemoryContents()));
+        std::cout << std::format("PC: 0x{:04X}  I: 0x{:04X}  DT: {}  ST: {}\n",
+            chip.getPCAddress(), chip.getIndexRegisterContents(), chip.getDelayTimer(), chip.getSoundTimer());
+
+        const std::span<const uint8_t> registers{ chip.getRegisterContents() };
+        for (std::size_t i{ 0 }; i < registers.size(); ++i)
+        {
+            std::cout << std::format("V{:X}: 0x{:02X}{}", i, registers[i], i % 8 == 7 ? "\n" : "  ");
+        }
+
+        std::cout << "Stack:";
+        for (const uint16_t returnAddress : chip.getStackContents())
+        {
+            std::cout << std::format(" 0x{:04X}", returnAddress);
+        }
+        std::cout << '\n';
+    }
+}
+
+int main(int argc, char* args[])
+{
+    std::optional<Options> options{};
+    try
+    {
+        options = parseOptions(argc, args);
+    }
+    catch (const std::logic_error&)
+    {
+        // std::stoi on something that isn't a number
+    }
+
+    if (!options)
+    {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    Chip8 chip{};
+    std::vector<KeyEvent> keyEvents{};
+    std::optional<InputMoviePlayer> moviePlayer{};
+    try
+    {
+        chip.loadFile(options->romPath);
+        if (!options->inputScriptPath.empty())
+        {
+            keyEvents = readInputScript(options->inputScriptPath);
+        }
+        if (!options->moviePath.empty())
+        {
+            moviePlayer.emplace(InputMovie::read(options->moviePath), chip);
+        }
+    }
+    catch (const std::runtime_error& exception)
+    {
+        std::cerr << "chip8_headless: " << exception.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (options->instructionsPerSecond)
+    {
+        chip.setTargetNumInstrPerSecond(*options->instructionsPerSecond);
+    }
+    if (options->engine)
+    {
+        chip.setExecutionEngine(*options->engine);
+
+        // Otherwise the interpreter would quietly run instead, and be reported as the engine that was asked for
+        if (chip.getExecutionEngine() != *options->engine)
+        {
+            std::cerr << "chip8_headless: this build has no JIT\n";
+            return EXIT_FAILURE;
+        }
+        if (*options->engine == ExecutionEngine::aheadOfTime && !chip.hasAotProgram())
+        {
+            std::cerr << "chip8_headless: no AOT program was linked in for this ROM\n";
+            return EXIT_FAILURE;
+        }
+    }
+    chip.setSuperinstructionsEnabled(options->isFusionEnabled);
+
+    // A movie brings its own generator state
+    std::optional<InputMovie> recording{};
+    if (!options->recordPath.empty())
+    {
+        recording = InputMovie::startRecording(chip, options->randomSeed.value_or(std::random_device{}()));
+    }
+    else if (options->randomSeed && !moviePlayer)
+    {
+        chip.seedRandom(*options->randomSeed);
+    }
+
+    const int numFramesToRun{ options->numFrames.value_or(
+        moviePlayer ? Utility::toInt(moviePlayer->getMovie().getNumFrames()) : s_defaultNumFrames) };
+
+    // Worked out the same way as Emulator::calculateNumInstructionsNeededForFrame
+    const int targetInstructionsPerSecond{ chip.getTargetNumInstrPerSecond() };
+    const int instructionsPerFrame{ targetInstructionsPerSecond <= 0 ? 0 : std::max(targetInstructionsPerSecond / s_framesPerSecond, 1) };
+
+    auto nextKeyEvent{ keyEvents.begin() };
+    int numFramesRun{ 0 };
+    bool stoppedEarly{ false };
+
+    // A movie's start state has already executed some instructions
+    const uint64_t numInstructionsBeforeRun{ chip.getRuntimeMetaData().numInstructionsExecuted };
+    const uint64_t numInstructionsSkippedBeforeRun{ chip.getRuntimeMetaData().numInstructionsSkippedIdle };
+    const auto startTime{ std::chrono::steady_clock::now() };
+    try
+    {
+        for (; numFramesRun < numFramesToRun; ++numFramesRun)
+        {
+            if (moviePlayer)
+            {
+                if (moviePlayer->isFinished())
+                {
+                    break;
+                }
+
+                moviePlayer->runFrame(chip);
+                continue;
+            }
+
+            for (; nextKeyEvent != keyEvents.end() && nextKeyEvent->frame <= numFramesRun; ++nextKeyEvent)
+            {
+                if (nextKeyEvent->isDown)
+                {
+                    chip.setKeyDown(nextKeyEvent->key);
+                }
+                else
+                {
+                    chip.setKeyUp(nextKeyEvent->key);
+                }
+            }
+
+            if (recording)
+            {
+                recording->recordFrame(chip, instructionsPerFrame);
+            }
+
+            // Same order as Emulator::emulateFrame
+            chip.decrementTimers();
+            chip.executeInstructions(instructionsPerFrame);
+            chip.setPrevFrameInputs();
+        }
+    }
+    catch (const std::runtime_error& exception)
+    {
+        std::cerr << std::format("chip8_headless: ROM stopped during frame {}: {}\n", numFramesRun, exception.what());
+        stoppedEarly = true;
+    }
+    const std::chrono::duration<double> elapsed{ std::chrono::steady_clock::now() - startTime };
+
+    if (recording)
+    {
+        try
+        {
+            recording->write(options->recordPath);
+        }
+        catch (const FileInputException& exception)
+        {
+            std::cerr << "chip8_headless: " << exception.what() << std::endl;
+            stoppedEarly = true;
+        }
+    }
+
+    const uint64_t numInstructionsExecuted{ chip.getRuntimeMetaData().numInstructionsExecuted - numInstructionsBeforeRun };
+    const uint64_t numInstructionsSkipped{ chip.getRuntimeMetaData().numInstructionsSkippedIdle - numInstructionsSkippedBeforeRun };
+    const double seconds{ elapsed.count() };
+
+    // Skipped instructions were never run, so they don't count towards the throughput
+    std::cout << std::format("Frames: {}\n", numFramesRun);
+    std::cout << std::format("Instructions executed: {}\n", numInstructionsExecuted);
+    std::cout << std::format("Instructions skipped while idle: {}\n", numInstructionsSkipped);
+    std::cout << std::format("Instructions/sec: {:.0f}\n", seconds > 0.0 ? static_cast<double>(numInstructionsExecuted) / seconds : 0.0);
+    printMachineState(chip);
+
+    return stoppedEarly ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,176 @@
+#include <iostream>
+#include <format>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "chip8.h"
+#include "opcodedecoder.h"
+
+// Usage: chip8_profile <frames> <instructions per frame> <rom.ch8>...
+// Runs every ROM on the interpreter, without any input, and reports which opcode pairs and triples execute most often
+// across all of them. This is what the superinstructions in OpcodeDecoder::Operation were picked from.
+// Only instructions that follow each other in memory count as a sequence, since those are the only ones a basic block
+// can fuse.
+
+namespace
+{
+    using OpcodeDecoder::Operation;
+
+    constexpr std::size_t s_numSequencesToShow{ 15 };
+
+    struct ExecutedInstruction
+    {
+        Operation operation{ Operation::invalid };
+        uint16_t address{};
+    };
+
+    struct SequenceCounts
+    {
+        // Keyed by the operations packed together, one byte each
+        std::unordered_map<uint32_t, uint64_t> pairs{};
+        std::unordered_map<uint32_t, uint64_t> triples{};
+        uint64_t numPairs{ 0 };
+        uint64_t numTriples{ 0 };
+    };
+
+    uint32_t packSequence(const std::vector<Operation>& operations)
+    {
+        uint32_t key{ 0 };
+        for (const Operation operation : operations)
+        {
+            key = (key << 8) | Utility::toU32(operation);
+        }
+        return key;
+    }
+
+    std::string describeSequence(uint32_t key, const std::size_t length)
+    {
+        std::vector<std::string_view> names(length);
+        for (std::size_t i{ length }; i > 0; --i)
+        {
+            names[i - 1] = OpcodeDecoder::getOperationName(static_cast<Operation>(key & 0xFF));
+            key >>= 8;
+        }
+
+        std::string description{};
+        for (const std::string_view name : names)
+        {
+            description += description.empty() ? "" : " -> ";
+            description += name;
+        }
+        return description;
+    }
+
+    void profileRom(const std::string& romPath, const int numFrames, const int instructionsPerFrame, SequenceCounts& counts)
+    {
+        Chip8 chip{};
+        chip.loadFile(romPath);
+
+        // The last three instructions executed, newest last
+        std::vector<ExecutedInstruction> history{};
+
+        for (int frame{ 0 }; frame < numFrames; ++frame)
+        {
+            for (int i{ 0 }; i < instructionsPerFrame; ++i)
+            {
+                const uint16_t address{ chip.getPCAddress() };
+                const Operation operation{ OpcodeDecoder::lookup(chip.getOpcodeAt(address)).operation };
+
+                chip.performFDECycle();
+
+                // Waiting for a key or spinning on a jump to itself, nothing else will run until the next frame
+                if (chip.getPCAddress() == address && (operation == Operation::opFX0A || operation == Operation::op1NNN))
+                {
+                    history.clear();
+                    break;
+                }
+
+                if (!history.empty() && Utility::toU16(history.back().address + 2) != address)
+                {
+                    history.clear();
+                }
+
+                history.push_back(ExecutedInstruction{ .operation = operation, .address = address });
+                if (history.size() > 3)
+                {
+                    history.erase(history.begin());
+                }
+
+                const std::size_t numInHistory{ history.size() };
+                if (numInHistory >= 2)
+                {
+                    ++counts.pairs[packSequence({ history[numInHistory - 2].operation, history[numInHistory - 1].operation })];
+                    ++counts.numPairs;
+                }
+                if (numInHistory == 3)
+                {
+                    ++counts.triples[packSequence({ history[0].operation, history[1].operation, history[2].operation })];
+                    ++counts.numTriples;
+                }
+            }
+
+            chip.decrementTimers();
+        }
+    }
+
+    void printHottest(const std::string_view title, const std::unordered_map<uint32_t, uint64_t>& sequences,
+        const uint64_t total, const std::size_t length)
+    {
+        std::vector<std::pair<uint32_t, uint64_t>> sorted{ sequences.begin(), sequences.end() };
+        std::ranges::sort(sorted, std::ranges::greater{}, &std::pair<uint32_t, uint64_t>::second);
+
+        std::cout << std::format("\n{} ({} executed)\n", title, total);
+        for (std::size_t rank{ 0 }; rank < std::min(s_numSequencesToShow, sorted.size()); ++rank)
+        {
+            const auto& [key, count]{ sorted[rank] };
+            const double percentage{ 100.0 * static_cast<double>(count) / static_cast<double>(total) };
+            std::cout << std::format("{:>3}. {:<28} {:>12} {:>6.2f}%\n", rank + 1, describeSequence(key, length), count, percentage);
+        }
+    }
+}
+
+int main(int argc, char* args[])
+{
+    int numFrames{ 0 };
+    int instructionsPerFrame{ 0 };
+    try
+    {
+        if (argc >= 4)
+        {
+            numFrames = std::stoi(args[1]);
+            instructionsPerFrame = std::stoi(args[2]);
+        }
+    }
+    catch (const std::logic_error&)
+    {
+        // std::stoi on something that isn't a number
+    }
+
+    if (numFrames <= 0 || instructionsPerFrame <= 0)
+    {
+        std::cerr << "Usage: chip8_profile <frames> <instructions per frame> <rom.ch8>...\n";
+        return EXIT_FAILURE;
+    }
+
+    SequenceCounts counts{};
+    for (int i{ 3 }; i < argc; ++i)
+    {
+        try
+        {
+            profileRom(args[i], numFrames, instructionsPerFrame, counts);
+        }
+        catch (const std::runtime_error& exception)
+        {
+            // Whatever ran before the error still counts
+            std::cerr << "chip8_profile: stopped " << args[i] << " early: " << exception.what() << '\n';
+        }
+    }
+
+    printHottest("Hottest opcode pairs", counts.pairs, counts.numPairs, 2);
+    printHottest("Hottest opcode triples", counts.triples, counts.numTriples, 3);
+
+    return EXIT_SUCCESS;
+}